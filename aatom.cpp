@@ -0,0 +1,260 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "aatom.h"
+
+#include <string.h>
+#include <new>
+
+using namespace alt;
+
+const atomEntry atom::emptyEntry = {0,0,0,{0}};
+
+atom::atom(const string &str)
+{
+    *this = atomTable::global().intern(str);
+}
+
+atom::atom(const char *str)
+{
+    *this = atomTable::global().intern(str,alt::utils::strlen(str));
+}
+
+atom::atom(const char *str, int size)
+{
+    *this = atomTable::global().intern(str,size);
+}
+
+bool atom::find(const char *str, int size, atom &rv)
+{
+    return atomTable::global().find(str,size,rv);
+}
+
+atom atom::byId(uint32 id)
+{
+    return atomTable::global().byId(id);
+}
+
+string atom::str() const
+{
+    string rv(entry->size,false);
+    ::memcpy(rv(),entry->text,entry->size);
+    return rv;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+atomTable::atomTable(int chunk_size)
+{
+    chunkSize = chunk_size<256 ? 256 : chunk_size;
+    chunk = nullptr;
+    chunkUsed = chunkSize;
+    arenaBytes = 0;
+    count.store(1,std::memory_order_relaxed);
+    for(int i=0;i<32;i++)
+        pages[i].store(nullptr,std::memory_order_relaxed);
+    table.store(newSlots(64,nullptr),std::memory_order_release);
+}
+
+atomTable::~atomTable()
+{
+    slots *tab = table.load(std::memory_order_relaxed);
+    while(tab)
+    {
+        slots *prev = tab->prev;
+        ::operator delete(tab);
+        tab = prev;
+    }
+    for(int i=0;i<32;i++)
+        delete []pages[i].load(std::memory_order_relaxed);
+    for(int i=0;i<chunks.size();i++)
+        delete []chunks[i];
+}
+
+atomTable& atomTable::global()
+{
+    static atomTable *table = new atomTable();
+    return *table;
+}
+
+uint64 atomTable::hashOf(const char *str, int size)
+{
+    uint64 rv = 0x9E3779B97F4A7C15ull ^ uint64(size);
+    int i=0;
+    for(;i+8<=size;i+=8)
+    {
+        uint64 word;
+        ::memcpy(&word,str+i,8);
+        rv = (rv^word)*0xFF51AFD7ED558CCDull;
+        rv ^= rv>>32;
+    }
+    uint64 tail = 0;
+    ::memcpy(&tail,str+i,size-i);
+    rv = (rv^tail)*0xC4CEB9FE1A85EC53ull;
+    rv ^= rv>>29;
+    return rv;
+}
+
+atomTable::slots* atomTable::newSlots(uint32 count, slots *prev)
+{
+    uintz bytes = sizeof(slots)+sizeof(std::atomic<atomEntry*>)*(count-1);
+    slots *rv = (slots*)::operator new(bytes);
+    rv->mask = count-1;
+    rv->prev = prev;
+    for(uint32 i=0;i<count;i++)
+        new(&rv->slot[i]) std::atomic<atomEntry*>(nullptr);
+    return rv;
+}
+
+const atomEntry* atomTable::lookup(const slots *tab, const char *str, int size, uint64 hash) const
+{
+    for(uint32 i=uint32(hash)&tab->mask;;i=(i+1)&tab->mask)
+    {
+        const atomEntry *entry = tab->slot[i].load(std::memory_order_acquire);
+        if(!entry)
+            return nullptr;
+        if(entry->hash==hash && entry->size==size && !::memcmp(entry->text,str,size))
+            return entry;
+    }
+}
+
+atomEntry* atomTable::allocEntry(int size)
+{
+    int need = int((offsetof(atomEntry,text)+size+1+7)&~uintz(7));
+    if(need>chunkSize/4)
+    {
+        //длинный текст - отдельным блоком, чтобы не выбрасывать остаток текущего куска
+        char *block = new char[need];
+        chunks.append(block);
+        arenaBytes += need;
+        return (atomEntry*)block;
+    }
+    if(chunkUsed+need>chunkSize)
+    {
+        chunk = new char[chunkSize];
+        chunks.append(chunk);
+        arenaBytes += chunkSize;
+        chunkUsed = 0;
+    }
+    atomEntry *rv = (atomEntry*)(chunk+chunkUsed);
+    chunkUsed += need;
+    return rv;
+}
+
+bool atomTable::find(const char *str, int size, atom &rv) const
+{
+    if(size<=0)
+    {
+        rv = atom();
+        return true;
+    }
+    const atomEntry *entry = lookup(table.load(std::memory_order_acquire),str,size,hashOf(str,size));
+    if(!entry)
+        return false;
+    rv = atom(entry);
+    return true;
+}
+
+atom atomTable::intern(const char *str, int size)
+{
+    if(size<=0)
+        return atom();
+
+    uint64 hash = hashOf(str,size);
+    const atomEntry *found = lookup(table.load(std::memory_order_acquire),str,size,hash);
+    if(found)
+        return atom(found);
+
+    lockGuard<mutex> guard(lock);
+
+    slots *tab = table.load(std::memory_order_relaxed);
+    found = lookup(tab,str,size,hash);
+    if(found)
+        return atom(found);
+
+    uint32 id = count.load(std::memory_order_relaxed);
+    if(id*2>tab->mask)
+    {
+        //заполнение до половины: новая таблица вдвое больше, старая остается для текущих читателей
+        slots *next = newSlots((tab->mask+1)*2,tab);
+        for(uint32 i=0;i<=tab->mask;i++)
+        {
+            atomEntry *entry = tab->slot[i].load(std::memory_order_relaxed);
+            if(!entry)
+                continue;
+            uint32 j = uint32(entry->hash)&next->mask;
+            while(next->slot[j].load(std::memory_order_relaxed))
+                j = (j+1)&next->mask;
+            next->slot[j].store(entry,std::memory_order_relaxed);
+        }
+        table.store(next,std::memory_order_release);
+        tab = next;
+    }
+
+    atomEntry *entry = allocEntry(size);
+    entry->hash = hash;
+    entry->id = id;
+    entry->size = size;
+    ::memcpy(entry->text,str,size);
+    entry->text[size] = 0;
+
+    int page = int(alt::imath::bsr32(id))-1;
+    atomEntry **list = pages[page].load(std::memory_order_relaxed);
+    if(!list)
+    {
+        list = new atomEntry*[uintz(1)<<page];
+        pages[page].store(list,std::memory_order_release);
+    }
+    list[id-(uint32(1)<<page)] = entry;
+    count.store(id+1,std::memory_order_release);
+
+    uint32 i = uint32(hash)&tab->mask;
+    while(tab->slot[i].load(std::memory_order_relaxed))
+        i = (i+1)&tab->mask;
+    tab->slot[i].store(entry,std::memory_order_release);
+
+    return atom(entry);
+}
+
+atom atomTable::byId(uint32 id) const
+{
+    if(!id || id>=count.load(std::memory_order_acquire))
+        return atom();
+    int page = int(alt::imath::bsr32(id))-1;
+    return atom(pages[page].load(std::memory_order_acquire)[id-(uint32(1)<<page)]);
+}
+
+uintz atomTable::memoryUsage() const
+{
+    lockGuard<mutex> guard(lock);
+    uintz rv = arenaBytes;
+    for(const slots *tab = table.load(std::memory_order_relaxed);tab;tab=tab->prev)
+        rv += sizeof(slots)+sizeof(std::atomic<atomEntry*>)*tab->mask;
+    uint32 ids = count.load(std::memory_order_relaxed);
+    for(int i=0;i<32 && (uint32(1)<<i)<ids;i++)
+        rv += sizeof(atomEntry*)<<i;
+    return rv;
+}
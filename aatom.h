@@ -0,0 +1,135 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AATOM_H
+#define AATOM_H
+
+#include "atypes.h"
+#include "astring.h"
+#include "athread.h"
+
+#include <atomic>
+
+// Интернирование строк: одинаковый текст хранится один раз, атом - указатель на запись таблицы.
+// Сравнение и хэш атомов - O(1), текст живет в арене таблицы до ее разрушения.
+// Поиск идет без блокировки по открытой адресации, добавление - под мьютексом таблицы.
+
+namespace alt {
+
+    struct atomEntry
+    {
+        uint64 hash;
+        uint32 id;
+        int size;
+        char text[1]; //с завершающим нулем
+    };
+
+    class atomTable;
+
+    class atom
+    {
+    public:
+        atom() : entry(&emptyEntry) {}    //пустая строка, id 0
+        explicit atom(const string &str); //атомы глобальной таблицы
+        explicit atom(const char *str);
+        atom(const char *str, int size);
+
+        //поиск без добавления
+        static bool find(const char *str, int size, atom &rv);
+        static bool find(const string &str, atom &rv) {return find(str(),str.size(),rv);}
+        static atom byId(uint32 id); //пустой атом для неизвестного id
+
+        uint32 id() const {return entry->id;}
+        const char* data() const {return entry->text;}
+        int size() const {return entry->size;}
+        bool isEmpty() const {return !entry->size;}
+        string str() const;
+
+        bool operator==(const atom &val) const {return entry==val.entry;}
+        bool operator!=(const atom &val) const {return entry!=val.entry;}
+        //порядок создания, а не алфавитный
+        bool operator<(const atom &val) const {return entry->id<val.entry->id;}
+
+    private:
+        friend class atomTable;
+        explicit atom(const atomEntry *val) : entry(val) {}
+
+        const atomEntry *entry;
+        static const atomEntry emptyEntry;
+    };
+
+    __inline uint32 aHash(const atom &key){ return key.id(); }
+
+    //атомы разных таблиц не равны даже при одинаковом тексте
+    class atomTable
+    {
+    public:
+        atomTable(int chunk_size = 64*1024);
+        ~atomTable();
+
+        atomTable(const atomTable &val) = delete;
+        atomTable& operator=(const atomTable &val) = delete;
+
+        atom intern(const char *str, int size);
+        atom intern(const string &str) {return intern(str(),str.size());}
+        bool find(const char *str, int size, atom &rv) const;
+        atom byId(uint32 id) const;
+
+        int size() const {return int(count.load(std::memory_order_acquire))-1;}
+        uintz memoryUsage() const;
+
+        //не разрушается до завершения процесса: атомы могут жить в статических объектах
+        static atomTable& global();
+
+    private:
+
+        struct slots
+        {
+            uint32 mask;
+            slots *prev; //старые таблицы могут читаться без блокировки, освобождаются вместе с atomTable
+            std::atomic<atomEntry*> slot[1];
+        };
+
+        static uint64 hashOf(const char *str, int size);
+        static slots* newSlots(uint32 count, slots *prev);
+        const atomEntry* lookup(const slots *tab, const char *str, int size, uint64 hash) const;
+        atomEntry* allocEntry(int size);
+
+        std::atomic<slots*> table;
+        std::atomic<uint32> count; //следующий id; id 0 - пустой атом
+        std::atomic<atomEntry**> pages[32]; //страница k хранит id из [2^k, 2^(k+1))
+
+        mutable mutex lock;
+        int chunkSize;
+        char *chunk;
+        int chunkUsed;
+        array<char*> chunks;
+        uintz arenaBytes;
+    };
+
+} // namespace alt
+
+#endif // AATOM_H
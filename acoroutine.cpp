@@ -0,0 +1,466 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "acoroutine.h"
+#include "atime.h"
+#include "atimer.h"
+
+#if defined(__linux)
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+    #include <errno.h>
+#elif defined(__APPLE__)
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#else
+    #include <winsock2.h>
+#endif
+
+#ifdef ENABLE_BUGEATER
+    #include <assert.h>
+#endif
+
+using namespace alt;
+
+static thread_local eventLoop *_current_loop = nullptr;
+
+namespace {
+
+    //ожидающие дескриптора: по одному на чтение и запись
+    struct fdEntry
+    {
+        coro::waitAwaiter *reader;
+        timerId reader_timer;
+        coro::waitAwaiter *writer;
+        timerId writer_timer;
+    };
+
+    struct loopInternal
+    {
+        hash<int64,fdEntry> fds;
+
+        //сроки ожиданий с точностью до миллисекунды - как и таймаут опроса
+        timerWheel timers;
+
+#if defined(__linux)
+        int epfd = -1;
+        int wakefd = -1;
+        epoll_event events[64];
+#elif defined(__APPLE__)
+        int wake[2] = {-1,-1};
+        array<pollfd> polls;
+#else
+        array<WSAPOLLFD> polls;
+#endif
+    };
+
+}
+
+eventLoop::eventLoop()
+{
+    loopInternal *hand = new loopInternal;
+    internal = hand;
+
+#if defined(__linux)
+    hand->epfd = epoll_create1(EPOLL_CLOEXEC);
+    hand->wakefd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = hand->wakefd;
+    epoll_ctl(hand->epfd,EPOLL_CTL_ADD,hand->wakefd,&ev);
+#elif defined(__APPLE__)
+    if(!pipe(hand->wake))
+    {
+        fcntl(hand->wake[0],F_SETFL,O_NONBLOCK);
+        fcntl(hand->wake[1],F_SETFL,O_NONBLOCK);
+    }
+#endif
+}
+
+eventLoop::~eventLoop()
+{
+    loopInternal *hand = (loopInternal*)internal;
+
+    //задача уничтожает вложенные задачи сама
+    for(int i=0;i<spawned.size();i++)
+        spawned[i].h.destroy();
+    spawned.clear();
+
+#if defined(__linux)
+    close(hand->wakefd);
+    close(hand->epfd);
+#elif defined(__APPLE__)
+    if(hand->wake[0]>=0)
+    {
+        close(hand->wake[0]);
+        close(hand->wake[1]);
+    }
+#endif
+    delete hand;
+}
+
+eventLoop* eventLoop::current()
+{
+    return _current_loop;
+}
+
+void eventLoop::spawn(task<void> &&val)
+{
+    std::coroutine_handle<task<void>::promise_type> h = val.release();
+    if(!h)
+        return;
+    h.promise().detached = this;
+    h.promise().spawn_index = spawned.size();
+    spawned.append({&h.promise(),h});
+    ready.append(h);
+}
+
+void eventLoop::finished(coro::promiseBase *promise)
+{
+    int ind = promise->spawn_index;
+    if(ind!=spawned.size()-1)
+    {
+        spawned[ind] = spawned.last();
+        spawned[ind].promise->spawn_index = ind;
+    }
+    spawned.pop();
+}
+
+static void _wake_loop(loopInternal *hand)
+{
+#if defined(__linux)
+    uint64 one = 1;
+    if(write(hand->wakefd,&one,sizeof(one))<0) {}
+#elif defined(__APPLE__)
+    char one = 1;
+    if(write(hand->wake[1],&one,1)<0) {}
+#else
+    //WSAPoll не ждет произвольных событий; цикл опрашивает очередь с шагом 1 мс
+    (void)hand;
+#endif
+}
+
+void eventLoop::post(std::coroutine_handle<> h)
+{
+    if(_current_loop==this)
+    {
+        ready.append(h);
+        return;
+    }
+    remote_lock.lock();
+    remote.append(h);
+    _wake_loop((loopInternal*)internal);
+    remote_lock.unlock();
+}
+
+void eventLoop::postExpected(std::coroutine_handle<> h)
+{
+    if(_current_loop==this)
+    {
+        ready.append(h);
+        remote_expected.fetch_sub(1,std::memory_order_relaxed);
+        return;
+    }
+    remote_lock.lock();
+    remote.append(h);
+    remote_expected.fetch_sub(1,std::memory_order_relaxed);
+    _wake_loop((loopInternal*)internal);
+    remote_lock.unlock();
+}
+
+void eventLoop::stop()
+{
+    stopped.store(true,std::memory_order_relaxed);
+    remote_lock.lock();
+    _wake_loop((loopInternal*)internal);
+    remote_lock.unlock();
+}
+
+void eventLoop::run()
+{
+    while(!stopped.load(std::memory_order_relaxed) && spawned.size())
+        runOnce();
+    stopped.store(false,std::memory_order_relaxed);
+}
+
+//взвести интерес к дескриптору; false - дескриптор не поддерживает ожидание
+static bool _arm_fd(loopInternal *hand, int64 fd, const fdEntry &entry)
+{
+#if defined(__linux)
+    epoll_event ev;
+    ev.events = EPOLLONESHOT;
+    if(entry.reader)
+        ev.events |= EPOLLIN;
+    if(entry.writer)
+        ev.events |= EPOLLOUT;
+    ev.data.fd = int(fd);
+    //дескриптор мог остаться в epoll от прошлого ожидания или быть закрыт с тех пор
+    if(!epoll_ctl(hand->epfd,EPOLL_CTL_MOD,int(fd),&ev))
+        return true;
+    if(errno!=ENOENT)
+        return false;
+    if(!epoll_ctl(hand->epfd,EPOLL_CTL_ADD,int(fd),&ev))
+        return true;
+    if(errno==EEXIST)
+        return !epoll_ctl(hand->epfd,EPOLL_CTL_MOD,int(fd),&ev);
+    return false;
+#else
+    //опрос собирается заново на каждой итерации
+    (void)hand; (void)fd; (void)entry;
+    return true;
+#endif
+}
+
+void eventLoop::addWait(coro::waitAwaiter *waiter, std::coroutine_handle<> h)
+{
+    loopInternal *hand = (loopInternal*)internal;
+
+    waiter->handle = h.address();
+    timerId timer = 0;
+    if(waiter->timeout_us>=0)
+    {
+        //срок колеса считается от последнего advance(), а до этой точки итерация
+        //могла долго выполнять другие задачи; истекшие таймеры только попадут в ready
+        hand->timers.advance();
+        timer = hand->timers.schedule(waiter->timeout_us,[waiter]() { waiter->loop->timedOut(waiter); });
+    }
+    if(waiter->fd<0)
+        return;
+
+    fdEntry &entry = hand->fds[waiter->fd];
+    if(waiter->write)
+    {
+#ifdef ENABLE_BUGEATER
+        assert(!entry.writer);
+#endif
+        entry.writer = waiter;
+        entry.writer_timer = timer;
+    }
+    else
+    {
+#ifdef ENABLE_BUGEATER
+        assert(!entry.reader);
+#endif
+        entry.reader = waiter;
+        entry.reader_timer = timer;
+    }
+
+    if(!_arm_fd(hand,waiter->fd,entry))
+    {
+        //обычные файлы и прочее, что epoll не принимает, считаем всегда готовыми
+        if(waiter->write)
+            entry.writer = nullptr;
+        else
+            entry.reader = nullptr;
+        if(!entry.reader && !entry.writer)
+            hand->fds.remove(waiter->fd);
+        if(timer)
+            hand->timers.cancel(timer);
+        waiter->result = true;
+        ready.append(h);
+    }
+}
+
+//разбудить ожидающих дескриптора по событиям
+static void _fd_event(loopInternal *hand, array<std::coroutine_handle<>> &ready, int64 fd, bool readable, bool writable)
+{
+    int ind = hand->fds.indexOf(fd);
+    if(ind<0)
+        return;
+    fdEntry &entry = hand->fds.value_ref(ind);
+    if(readable && entry.reader)
+    {
+        entry.reader->result = true;
+        ready.append(std::coroutine_handle<>::from_address(entry.reader->handle));
+        if(entry.reader_timer)
+            hand->timers.cancel(entry.reader_timer);
+        entry.reader = nullptr;
+    }
+    if(writable && entry.writer)
+    {
+        entry.writer->result = true;
+        ready.append(std::coroutine_handle<>::from_address(entry.writer->handle));
+        if(entry.writer_timer)
+            hand->timers.cancel(entry.writer_timer);
+        entry.writer = nullptr;
+    }
+    if(!entry.reader && !entry.writer)
+        hand->fds.remove(fd);
+#if defined(__linux)
+    else
+        _arm_fd(hand,fd,entry); //oneshot снят, оставшийся ждет дальше
+#endif
+}
+
+bool eventLoop::runOnce(int64 timeout_us)
+{
+    loopInternal *hand = (loopInternal*)internal;
+    eventLoop *prev = _current_loop;
+    _current_loop = this;
+
+    remote_lock.lock();
+    for(int i=0;i<remote.size();i++)
+        ready.append(remote[i]);
+    remote.clear();
+    remote_lock.unlock();
+
+    //возобновленные сейчас задачи могут снова наполнить ready - их очередь на следующей итерации
+    if(ready.size())
+    {
+        array<std::coroutine_handle<>> batch = ready;
+        ready.clear();
+        for(int i=0;i<batch.size();i++)
+            batch[i].resume();
+    }
+
+    if(!ready.size() && !spawned.size() && !hand->timers.size() && !hand->fds.size()
+            && !remote_expected.load(std::memory_order_relaxed))
+    {
+        remote_lock.lock();
+        bool idle = !remote.size();
+        remote_lock.unlock();
+        if(idle)
+        {
+            _current_loop = prev;
+            return false;
+        }
+    }
+
+    //сколько можно спать
+    int64 wait_us = timeout_us;
+    if(ready.size() || stopped.load(std::memory_order_relaxed))
+        wait_us = 0;
+    int64 left = hand->timers.untilNext();
+    if(left>=0 && (wait_us<0 || left<wait_us))
+        wait_us = left;
+#if !defined(__linux) && !defined(__APPLE__)
+    if(remote_expected.load(std::memory_order_relaxed) && (wait_us<0 || wait_us>1000))
+        wait_us = 1000;
+#endif
+    //округляем вверх, чтобы не крутиться вхолостую перед сроком таймера
+    int wait_ms = wait_us<0 ? -1 : int((wait_us+999)/1000);
+
+#if defined(__linux)
+    int count = epoll_wait(hand->epfd,hand->events,64,wait_ms);
+    for(int i=0;i<count;i++)
+    {
+        epoll_event &ev = hand->events[i];
+        if(ev.data.fd==hand->wakefd)
+        {
+            uint64 tmp;
+            if(read(hand->wakefd,&tmp,sizeof(tmp))<0) {}
+            continue;
+        }
+        bool fail = ev.events&(EPOLLERR|EPOLLHUP);
+        _fd_event(hand,ready,ev.data.fd,fail || (ev.events&EPOLLIN),fail || (ev.events&EPOLLOUT));
+    }
+#else
+    hand->polls.clear();
+  #if defined(__APPLE__)
+    if(hand->wake[0]>=0)
+        hand->polls.append({hand->wake[0],POLLIN,0});
+  #endif
+    for(int i=0;i<hand->fds.size();i++)
+    {
+        const fdEntry &entry = hand->fds.value(i);
+        short events = (entry.reader ? POLLIN : 0) | (entry.writer ? POLLOUT : 0);
+  #if defined(__APPLE__)
+        hand->polls.append({int(hand->fds.key(i)),events,0});
+  #else
+        hand->polls.append({SOCKET(hand->fds.key(i)),events,0});
+  #endif
+    }
+    int count = 0;
+    if(hand->polls.size())
+    {
+  #if defined(__APPLE__)
+        count = poll(hand->polls(),hand->polls.size(),wait_ms);
+  #else
+        count = WSAPoll(hand->polls(),hand->polls.size(),wait_ms);
+  #endif
+    }
+    else if(wait_ms)
+    {
+        alt::sleep(wait_ms<0 ? 1000 : wait_ms*1000);
+    }
+    for(int i=0;i<hand->polls.size() && count>0;i++)
+    {
+        short revents = hand->polls[i].revents;
+        if(!revents)
+            continue;
+  #if defined(__APPLE__)
+        if(hand->polls[i].fd==hand->wake[0])
+        {
+            char tmp[64];
+            while(read(hand->wake[0],tmp,sizeof(tmp))>0) {}
+            continue;
+        }
+  #endif
+        bool fail = revents&(POLLERR|POLLHUP|POLLNVAL);
+        _fd_event(hand,ready,int64(hand->polls[i].fd),fail || (revents&POLLIN),fail || (revents&POLLOUT));
+    }
+#endif
+
+    //истекшие таймеры
+    hand->timers.advance();
+
+    _current_loop = prev;
+    return true;
+}
+
+void eventLoop::timedOut(coro::waitAwaiter *waiter)
+{
+    loopInternal *hand = (loopInternal*)internal;
+    if(waiter->fd>=0)
+    {
+        int ind = hand->fds.indexOf(waiter->fd);
+        if(ind>=0)
+        {
+            fdEntry &entry = hand->fds.value_ref(ind);
+            if(entry.reader==waiter)
+                entry.reader = nullptr;
+            if(entry.writer==waiter)
+                entry.writer = nullptr;
+            //взведенный oneshot без ожидающих просто игнорируется при срабатывании
+            if(!entry.reader && !entry.writer)
+                hand->fds.remove(waiter->fd);
+        }
+    }
+    waiter->result = false;
+    ready.append(std::coroutine_handle<>::from_address(waiter->handle));
+}
+
+void coro::waitAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    loop->addWait(this,h);
+}
+
+void coro::yieldAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    loop->post(h);
+}
@@ -0,0 +1,476 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ACOROUTINE_H
+#define ACOROUTINE_H
+
+#include "atypes.h"
+#include "at_array.h"
+#include "at_hash.h"
+#include "athread.h"
+#include "athreadpool.h"
+#include "anetwork.h"
+#include "afile.h"
+
+#include <coroutine>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <stdlib.h>
+
+// Сопрограммы C++20: ленивая задача task<T>, однопоточный цикл событий eventLoop
+// и ожидания готовности сокета, таймеров и выноса работы в threadPool.
+// Один поток цикла обслуживает любое число соединений прямолинейным кодом:
+//
+//     task<void> echo(peer *p)
+//     {
+//         char buff[4096];
+//         for(;;)
+//         {
+//             retCode n = co_await recvAsync(*p,buff,sizeof(buff),5000000);
+//             if(n.error() || !n.get()) break;
+//             co_await sendAllAsync(*p,buff,n.get());
+//         }
+//         delete p;
+//     }
+//
+// Исключения в библиотеке не используются: исключение внутри сопрограммы завершает процесс.
+
+namespace alt {
+
+    class eventLoop;
+    template <class T> class task;
+
+    namespace coro {
+
+        struct promiseBase
+        {
+            std::coroutine_handle<> continuation;
+            eventLoop *detached = nullptr;  //задача запущена через spawn и принадлежит циклу
+            int spawn_index = -1;
+
+            void unhandled_exception() noexcept
+            {
+                abort();
+            }
+        };
+
+        struct finalAwaiter
+        {
+            bool await_ready() noexcept {return false;}
+
+            template <class P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept;
+
+            void await_resume() noexcept {}
+        };
+
+        template <class T>
+        struct promiseValue : promiseBase
+        {
+            std::optional<T> value;
+
+            template <class V>
+            void return_value(V &&val)
+            {
+                value.emplace(std::forward<V>(val));
+            }
+
+            T take()
+            {
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct promiseValue<void> : promiseBase
+        {
+            void return_void() noexcept {}
+            void take() {}
+        };
+
+    } // namespace coro
+
+    //ленивая задача: начинает выполняться, когда ее ждут (co_await) или отдают циклу
+    template <class T = void>
+    class task
+    {
+    public:
+
+        struct promise_type : coro::promiseValue<T>
+        {
+            task get_return_object()
+            {
+                return task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept {return {};}
+            coro::finalAwaiter final_suspend() noexcept {return {};}
+        };
+
+        task() {}
+        task(task &&val) : h(val.h) {val.h = nullptr;}
+        ~task()
+        {
+            if(h)
+                h.destroy();
+        }
+
+        task& operator=(task &&val)
+        {
+            if(this!=&val)
+            {
+                if(h)
+                    h.destroy();
+                h = val.h;
+                val.h = nullptr;
+            }
+            return *this;
+        }
+
+        task(const task &val) = delete;
+        task& operator=(const task &val) = delete;
+
+        bool isValid() const {return bool(h);}
+        bool isDone() const {return !h || h.done();}
+
+        bool await_ready() const noexcept {return isDone();}
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            h.promise().continuation = awaiting;
+            return h;
+        }
+
+        T await_resume()
+        {
+            return h.promise().take();
+        }
+
+    private:
+        friend class eventLoop;
+
+        explicit task(std::coroutine_handle<promise_type> val) : h(val) {}
+
+        std::coroutine_handle<promise_type> release()
+        {
+            std::coroutine_handle<promise_type> rv = h;
+            h = nullptr;
+            return rv;
+        }
+
+        std::coroutine_handle<promise_type> h;
+    };
+
+    namespace coro {
+
+        //ожидание таймера или готовности дескриптора
+        struct waitAwaiter
+        {
+            eventLoop *loop;
+            int64 fd;           //-1 - только таймер
+            bool write;
+            int64 timeout_us;   //<0 - без ограничения
+            bool result = false;
+            void *handle = nullptr;
+
+            bool await_ready() const noexcept {return !timeout_us && fd<0;}
+            void await_suspend(std::coroutine_handle<> h);
+            bool await_resume() const noexcept {return fd<0 || result;}
+        };
+
+        //передать цикл другим готовым задачам
+        struct yieldAwaiter
+        {
+            eventLoop *loop;
+
+            bool await_ready() const noexcept {return false;}
+            void await_suspend(std::coroutine_handle<> h);
+            void await_resume() const noexcept {}
+        };
+
+        template <class F>
+        struct offloadAwaiter
+        {
+            using result_type = std::invoke_result_t<F&>;
+            using storage_type = std::conditional_t<std::is_void<result_type>::value,char,result_type>;
+
+            F fun;
+            threadPool *pool;
+            std::optional<storage_type> value;
+
+            bool await_ready() const noexcept {return false;}
+            void await_suspend(std::coroutine_handle<> h);
+
+            result_type await_resume()
+            {
+                if constexpr (!std::is_void<result_type>::value)
+                    return std::move(*value);
+            }
+        };
+
+    } // namespace coro
+
+    class eventLoop
+    {
+    public:
+        eventLoop();
+        //незавершенные задачи уничтожаются
+        ~eventLoop();
+
+        eventLoop(const eventLoop &val) = delete;
+        eventLoop& operator=(const eventLoop &val) = delete;
+
+        //цикл, выполняющийся в вызывающем потоке, или nullptr
+        static eventLoop* current();
+
+        //отдать задачу циклу; она стартует на ближайшей итерации
+        void spawn(task<void> &&val);
+
+        //крутить цикл, пока есть задачи и не вызван stop()
+        void run();
+
+        //одна итерация: готовые задачи, затем ожидание событий не дольше timeout_us (<0 - без ограничения);
+        //false, если делать больше нечего
+        bool runOnce(int64 timeout_us = -1);
+
+        //выполнить задачу до завершения и вернуть результат
+        template <class T>
+        T runUntil(task<T> &&val)
+        {
+            task<T> hold = std::move(val);
+            post(hold.h);
+            while(!hold.isDone())
+                runOnce();
+            return hold.await_resume();
+        }
+
+        //потокобезопасно
+        void stop();
+
+        int taskCount() const {return spawned.size();}
+
+        //возобновить h в потоке цикла; можно звать из любого потока
+        void post(std::coroutine_handle<> h);
+
+        coro::waitAwaiter sleep(uint64 us) {return {this,-1,false,int64(us)};}
+        coro::waitAwaiter readable(int64 fd, int64 timeout_us = -1) {return {this,fd,false,timeout_us};}
+        coro::waitAwaiter writable(int64 fd, int64 timeout_us = -1) {return {this,fd,true,timeout_us};}
+        coro::yieldAwaiter yield() {return {this};}
+
+    private:
+        friend struct coro::finalAwaiter;
+        friend struct coro::waitAwaiter;
+        template <class F> friend struct coro::offloadAwaiter;
+
+        struct spawnedTask
+        {
+            coro::promiseBase *promise;
+            std::coroutine_handle<> h;
+        };
+
+        void finished(coro::promiseBase *promise);
+        void addWait(coro::waitAwaiter *waiter, std::coroutine_handle<> h);
+        void timedOut(coro::waitAwaiter *waiter);
+        void expectPost() {remote_expected.fetch_add(1,std::memory_order_relaxed);}
+        void postExpected(std::coroutine_handle<> h);
+
+        array<spawnedTask> spawned;
+        array<std::coroutine_handle<>> ready;
+        std::atomic<bool> stopped = false;
+
+        mutex remote_lock;
+        array<std::coroutine_handle<>> remote;
+        std::atomic<int> remote_expected = 0;
+
+        void *internal;
+    };
+
+    template <class P>
+    std::coroutine_handle<> coro::finalAwaiter::await_suspend(std::coroutine_handle<P> h) noexcept
+    {
+        promiseBase &promise = h.promise();
+        if(promise.continuation)
+            return promise.continuation;
+        if(promise.detached)
+        {
+            promise.detached->finished(&promise);
+            h.destroy();
+        }
+        return std::noop_coroutine();
+    }
+
+    template <class F>
+    void coro::offloadAwaiter<F>::await_suspend(std::coroutine_handle<> h)
+    {
+        eventLoop *loop = eventLoop::current();
+        if(loop)
+            loop->expectPost();
+        pool->submit([this,h,loop]()
+        {
+            if constexpr (std::is_void<result_type>::value)
+            {
+                fun();
+                value.emplace(0);
+            }
+            else
+            {
+                value.emplace(fun());
+            }
+            //вне цикла продолжаем прямо в рабочем пула
+            if(loop)
+                loop->postExpected(h);
+            else
+                h.resume();
+        });
+    }
+
+    //выполнить fun в пуле, продолжить в потоке цикла
+    template <class F>
+    coro::offloadAwaiter<std::decay_t<F>> offload(F &&fun, threadPool *pool = nullptr)
+    {
+        return {std::forward<F>(fun),pool ? pool : &threadPool::global(),{}};
+    }
+
+    __inline coro::waitAwaiter sleepAsync(uint64 us)
+    {
+        return eventLoop::current()->sleep(us);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////
+    // Сетевые операции; S - connection или peer. Сокет должен быть неблокирующим:
+    // готовность к записи не обещает места под весь буфер, и блокирующий send остановил бы
+    // весь цикл. acceptAsync и connectAsync переводят свои сокеты сами. Таймаут - код -1001.
+
+    //хотя бы часть данных; 0 - соединение закрыто
+    template <class S>
+    task<retCode> recvAsync(S &sock, void *data, int size, int64 timeout_us = -1)
+    {
+        bool ready = co_await eventLoop::current()->readable(sock.nativeHandle(),timeout_us);
+        if(!ready)
+            co_return retCode(-1001);
+        co_return sock.recv(data,size);
+    }
+
+    //не меньше minimal_size байт (по умолчанию size); при закрытии - сколько успели принять
+    template <class S>
+    task<retCode> recvAllAsync(S &sock, void *data, int size, int64 timeout_us = -1, int minimal_size = -1)
+    {
+        eventLoop *loop = eventLoop::current();
+        uint64 deadline = timeout_us>=0 ? time::uStamp()+timeout_us : 0;
+        int count = minimal_size<0 ? size : minimal_size, done = 0;
+        while(done<count)
+        {
+            int64 left = -1;
+            if(timeout_us>=0)
+            {
+                uint64 curr = time::uStamp();
+                left = curr<deadline ? deadline-curr : 0;
+            }
+            bool ready = co_await loop->readable(sock.nativeHandle(),left);
+            if(!ready)
+                co_return retCode(-1001);
+            retCode code = sock.recv((uint8*)data+done,size-done);
+            if(code.error())
+                co_return code;
+            if(!code.get())
+                break;
+            done += code.get();
+        }
+        co_return retCode(done);
+    }
+
+    template <class S>
+    task<retCode> sendAllAsync(S &sock, const void *data, int size, int64 timeout_us = -1)
+    {
+        eventLoop *loop = eventLoop::current();
+        uint64 deadline = timeout_us>=0 ? time::uStamp()+timeout_us : 0;
+        int done = 0;
+        while(done<size)
+        {
+            int64 left = -1;
+            if(timeout_us>=0)
+            {
+                uint64 curr = time::uStamp();
+                left = curr<deadline ? deadline-curr : 0;
+            }
+            bool ready = co_await loop->writable(sock.nativeHandle(),left);
+            if(!ready)
+                co_return retCode(-1001);
+            retCode code = sock.send((const uint8*)data+done,size-done);
+            if(code.error())
+                co_return code;
+            done += code.get();
+        }
+        co_return retCode(done);
+    }
+
+    //1 - соединено, иначе ошибка; сокет переводится в неблокирующий режим
+    __inline task<retCode> connectAsync(connection &conn, int64 timeout_us = -1)
+    {
+        conn.setBlocking(false);
+        retCode code = conn.connect();
+        if(code.error() || code.get()==1)
+            co_return code;
+        bool ready = co_await eventLoop::current()->writable(conn.nativeHandle(),timeout_us);
+        if(!ready)
+        {
+            conn.disconnect();
+            co_return retCode(-1001);
+        }
+        co_return conn.status();
+    }
+
+    //nullptr по таймауту или ошибке (см. server::lastError)
+    __inline task<peer*> acceptAsync(server &srv, int64 timeout_us = -1)
+    {
+        if(srv.nativeHandle()<0)
+            co_return nullptr;
+        bool ready = co_await eventLoop::current()->readable(srv.nativeHandle(),timeout_us);
+        if(!ready)
+            co_return nullptr;
+        peer *rv = srv.tryAccept();
+        if(rv && rv->setBlocking(false).error())
+        {
+            delete rv;
+            co_return nullptr;
+        }
+        co_return rv;
+    }
+
+    //файловые операции готовности не сообщают и выполняются в пуле
+    __inline task<int> fileReadAsync(fileProto &file, void *data, int size, threadPool *pool = nullptr)
+    {
+        co_return co_await offload([&file,data,size]() { return file.read(data,size); },pool);
+    }
+
+    __inline task<int> fileWriteAsync(fileProto &file, const void *data, int size, threadPool *pool = nullptr)
+    {
+        co_return co_await offload([&file,data,size]() { return file.write(data,size); },pool);
+    }
+
+} // namespace alt
+
+#endif // ACOROUTINE_H
@@ -0,0 +1,308 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "aepoch.h"
+
+#include <assert.h>
+
+using namespace alt;
+
+namespace alt {
+
+    struct epochRetired
+    {
+        void *ptr;
+        void (*deleter)(void*);
+        uint64 epoch;
+    };
+
+    struct epochRecord
+    {
+        //(эпоха<<1) | признак нахождения в секции
+        std::atomic<uint64> state = 0;
+        std::atomic<bool> used = false;
+        epochRecord *next = nullptr;
+
+        //дальше - только поток-владелец
+        int nesting = 0;
+        int since_collect = 0;
+        alt::array<epochRetired> limbo; //по неубыванию эпохи
+    };
+
+    struct epochCore
+    {
+        std::atomic<uint64> epoch = 2;
+        std::atomic<epochRecord*> records = nullptr; //только добавление
+        std::atomic<int64> pending = 0;
+        std::atomic<int> refs = 1;                  //домен и потоки с записями
+
+        mutex orphans_lock;
+        alt::array<epochRetired> orphans;           //от завершившихся потоков
+
+        ~epochCore()
+        {
+            epochRecord *rec = records.load(std::memory_order_acquire);
+            while(rec)
+            {
+                epochRecord *next = rec->next;
+                delete rec;
+                rec = next;
+            }
+        }
+
+        void unref()
+        {
+            if(refs.fetch_sub(1,std::memory_order_acq_rel)==1)
+                delete this;
+        }
+
+        //освободить начало списка, которое уже никто не видит
+        int reclaim(alt::array<epochRetired> &list)
+        {
+            uint64 safe = epoch.load(std::memory_order_acquire);
+            int count = 0;
+            while(count<list.size() && list[count].epoch+2<=safe)
+            {
+                list[count].deleter(list[count].ptr);
+                count++;
+            }
+            if(count)
+            {
+                list.cut(0,count);
+                pending.fetch_sub(count,std::memory_order_relaxed);
+            }
+            return count;
+        }
+
+        void reclaimAll(alt::array<epochRetired> &list)
+        {
+            for(int i=0;i<list.size();i++)
+                list[i].deleter(list[i].ptr);
+            pending.fetch_sub(list.size(),std::memory_order_relaxed);
+            list.clear();
+        }
+    };
+
+} // namespace alt
+
+namespace {
+
+    struct epochThreadSlot
+    {
+        epochCore *core;
+        epochRecord *rec;
+    };
+
+    //записи потока во всех доменах; при завершении потока отложенное уходит в домен
+    struct epochThreadRecords
+    {
+        epochThreadSlot last = {nullptr,nullptr};
+        alt::array<epochThreadSlot> list;
+
+        ~epochThreadRecords()
+        {
+            for(int i=0;i<list.size();i++)
+            {
+                epochCore *core = list[i].core;
+                epochRecord *rec = list[i].rec;
+                if(rec->limbo.size())
+                {
+                    core->orphans_lock.lock();
+                    core->orphans.append(rec->limbo);
+                    core->orphans_lock.unlock();
+                    rec->limbo.clear();
+                }
+                rec->nesting = 0;
+                rec->since_collect = 0;
+                rec->state.store(0,std::memory_order_release);
+                rec->used.store(false,std::memory_order_release);
+                core->unref();
+            }
+        }
+    };
+
+    thread_local epochThreadRecords epochThreadData;
+
+}
+
+epochDomain::epochDomain()
+{
+    core = new epochCore;
+}
+
+epochDomain::~epochDomain()
+{
+    epochRecord *rec = core->records.load(std::memory_order_acquire);
+    for(;rec;rec=rec->next)
+        core->reclaimAll(rec->limbo);
+    core->orphans_lock.lock();
+    core->reclaimAll(core->orphans);
+    core->orphans_lock.unlock();
+    core->unref();
+}
+
+epochDomain& epochDomain::global()
+{
+    //не разрушается при выходе: рабочие глобального пула могут еще вызывать retire()
+    static epochDomain *domain = new epochDomain();
+    return *domain;
+}
+
+epochRecord* epochDomain::record()
+{
+    epochThreadRecords &data = epochThreadData;
+    if(data.last.core==core)
+        return data.last.rec;
+
+    for(int i=0;i<data.list.size();i++)
+    {
+        if(data.list[i].core==core)
+        {
+            data.last = data.list[i];
+            return data.last.rec;
+        }
+    }
+
+    //свободная запись завершившегося потока или новая
+    epochRecord *rec = core->records.load(std::memory_order_acquire);
+    for(;rec;rec=rec->next)
+    {
+        bool expected = false;
+        if(!rec->used.load(std::memory_order_relaxed)
+                && rec->used.compare_exchange_strong(expected,true,std::memory_order_acquire))
+            break;
+    }
+    if(!rec)
+    {
+        rec = new epochRecord;
+        rec->used.store(true,std::memory_order_relaxed);
+        epochRecord *head = core->records.load(std::memory_order_relaxed);
+        do
+        {
+            rec->next = head;
+        }
+        while(!core->records.compare_exchange_weak(head,rec,std::memory_order_release,std::memory_order_relaxed));
+    }
+
+    core->refs.fetch_add(1,std::memory_order_relaxed);
+    epochThreadSlot slot = {core,rec};
+    data.list.append(slot);
+    data.last = slot;
+    return rec;
+}
+
+void epochDomain::enter()
+{
+    epochRecord *rec = record();
+    if(rec->nesting++)
+        return;
+    uint64 e = core->epoch.load(std::memory_order_relaxed);
+    rec->state.store((e<<1)|1,std::memory_order_relaxed);
+    //объявление эпохи должно стать видимым до чтения защищаемых указателей
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void epochDomain::leave()
+{
+    epochRecord *rec = record();
+#ifdef ENABLE_BUGEATER
+    assert(rec->nesting>0);
+#endif
+    if(--rec->nesting)
+        return;
+    rec->state.store(0,std::memory_order_release);
+}
+
+void epochDomain::retire(void *ptr, void (*deleter)(void*))
+{
+    if(!ptr)
+        return;
+
+    epochRecord *rec = record();
+    epochRetired el;
+    el.ptr = ptr;
+    el.deleter = deleter;
+    el.epoch = core->epoch.load(std::memory_order_acquire);
+    rec->limbo.append(el);
+    core->pending.fetch_add(1,std::memory_order_relaxed);
+
+    if(++rec->since_collect>=collectPeriod)
+        collect();
+}
+
+bool epochDomain::tryAdvance()
+{
+    uint64 e = core->epoch.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for(epochRecord *rec=core->records.load(std::memory_order_acquire);rec;rec=rec->next)
+    {
+        uint64 st = rec->state.load(std::memory_order_acquire);
+        if((st&1) && (st>>1)!=e)
+            return false;
+    }
+    return core->epoch.compare_exchange_strong(e,e+1,std::memory_order_acq_rel);
+}
+
+int epochDomain::collect()
+{
+    epochRecord *rec = record();
+    rec->since_collect = 0;
+
+    tryAdvance();
+    int rv = core->reclaim(rec->limbo);
+
+    if(core->orphans_lock.trylock())
+    {
+        rv += core->reclaim(core->orphans);
+        core->orphans_lock.unlock();
+    }
+    return rv;
+}
+
+void epochDomain::synchronize()
+{
+    epochRecord *rec = record();
+    for(;;)
+    {
+        collect();
+        core->orphans_lock.lock();
+        bool orphans = core->orphans.size()>0;
+        core->orphans_lock.unlock();
+        if(!rec->limbo.size() && !orphans)
+            return;
+        alt::sleep(0);
+    }
+}
+
+uint64 epochDomain::epoch() const
+{
+    return core->epoch.load(std::memory_order_relaxed);
+}
+
+int64 epochDomain::pendingCount() const
+{
+    return core->pending.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,118 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AEPOCH_H
+#define AEPOCH_H
+
+#include "atypes.h"
+#include "at_array.h"
+#include "athread.h"
+
+#include <atomic>
+
+// Отложенное освобождение памяти по эпохам для структур без блокировок.
+// Читатель входит в критическую секцию (epochGuard), объявляя текущую эпоху.
+// Снятый со структуры объект передается в retire() и освобождается, когда глобальная
+// эпоха продвинется на две ступени: к этому моменту все, кто мог его видеть, вышли.
+// Эпоха продвигается, только если каждый поток в секции уже видел текущую.
+
+namespace alt {
+
+    struct epochCore;
+    struct epochRecord;
+
+    class epochDomain
+    {
+    public:
+        epochDomain();
+        //к моменту разрушения ни один поток не должен быть в секции или вызывать retire()
+        ~epochDomain();
+
+        epochDomain(const epochDomain &val) = delete;
+        epochDomain& operator=(const epochDomain &val) = delete;
+
+        //не разрушается до завершения процесса: рабочие глобального пула переживают статические объекты
+        static epochDomain& global();
+
+        //вложенные входы допустимы
+        void enter();
+        void leave();
+
+        //освободить ptr, когда его не сможет видеть ни один читатель;
+        //вызывается после того, как объект снят со структуры
+        void retire(void *ptr, void (*deleter)(void*));
+
+        template <class T>
+        void retire(T *ptr)
+        {
+            retire((void*)ptr,[](void *p){ delete (T*)p; });
+        }
+
+        //попробовать сдвинуть эпоху и освободить готовое; вызывается и сам
+        //через каждые collectPeriod вызовов retire() в потоке; число освобожденных
+        int collect();
+
+        //освободить все отложенное этим потоком и завершившимися потоками;
+        //ждет выхода остальных из секций, поэтому вызывать только вне секции
+        void synchronize();
+
+        uint64 epoch() const;
+
+        //ожидают освобождения во всех потоках
+        int64 pendingCount() const;
+
+        static const int collectPeriod = 64;
+
+    private:
+
+        epochRecord* record();
+        bool tryAdvance();
+
+        epochCore *core;
+    };
+
+    class epochGuard
+    {
+    public:
+        epochGuard(epochDomain &domain = epochDomain::global()) : domain(domain)
+        {
+            domain.enter();
+        }
+        ~epochGuard()
+        {
+            domain.leave();
+        }
+
+        epochGuard(const epochGuard &val) = delete;
+        epochGuard& operator=(const epochGuard &val) = delete;
+
+    private:
+        epochDomain &domain;
+    };
+
+} // namespace alt
+
+#endif // AEPOCH_H
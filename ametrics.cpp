@@ -0,0 +1,531 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "ametrics.h"
+#include "afile.h"
+#include "anetwork.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+using namespace alt;
+
+static string _metrics_json_escape(const string &str)
+{
+    string rv(str.size()+8,true);
+    for(int i=0;i<str.size();i++)
+    {
+        char c = str[i];
+        if(c=='"' || c=='\\')
+        {
+            rv.append('\\');
+            rv.append(c);
+        }
+        else if(uint8(c)<0x20)
+        {
+            rv += string::print("\\u%04x",int(c));
+        }
+        else
+        {
+            rv.append(c);
+        }
+    }
+    return rv;
+}
+
+//имена Prometheus: [a-zA-Z_:][a-zA-Z0-9_:]*
+static string _metrics_prometheus_name(const string &name)
+{
+    string rv(name.size()+1,true);
+    for(int i=0;i<name.size();i++)
+    {
+        char c = name[i];
+        bool ok = (c>='a' && c<='z') || (c>='A' && c<='Z') || c=='_' || c==':' || (i && c>='0' && c<='9');
+        if(!i && c>='0' && c<='9')
+            rv.append('_');
+        rv.append(ok || (c>='0' && c<='9') ? c : '_');
+    }
+    return rv;
+}
+
+static string _metrics_number(real val)
+{
+    if(val==real(int64(val)))
+        return string::fromInt(int64(val));
+    return string::print("%.9g",val);
+}
+
+//запись во временный файл и переименование, чтобы читатель не увидел половину
+static bool _metrics_write_file(const string &fname, const string &data)
+{
+    string tmp = fname + ".tmp";
+    {
+        alt::file hand(tmp);
+        if(!hand.create())
+            return false;
+        bool ok = hand.write(data(),data.size()) == data.size();
+        hand.close();
+        if(!ok)
+            return false;
+    }
+    if(alt::file::rename(tmp,fname))
+        return true;
+    alt::file::remove(fname);
+    return alt::file::rename(tmp,fname);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+string metricsTextSink::format(const metricsSnapshot &snap)
+{
+    string rv(1024,true);
+    string stamp = "[" + alt::time(snap.stamp).toString() + "] ";
+    for(int i=0;i<snap.values.size();i++)
+    {
+        const metricValue &val = snap.values[i];
+        rv += stamp + val.name + ": ";
+        if(val.type==metricValue::HISTOGRAM)
+            rv += val.window.toString();
+        else
+            rv += _metrics_number(val.value);
+        rv += "\n";
+    }
+    return rv;
+}
+
+void metricsTextSink::write(const metricsSnapshot &snap)
+{
+    string text = format(snap);
+    if(fname.isEmpty())
+    {
+        fwrite(text(),1,text.size(),stdout);
+        fflush(stdout);
+        return;
+    }
+
+    alt::file hand(fname);
+    if(!hand.open(alt::fileProto::OWriteOnly|alt::fileProto::OAppend))
+        return;
+    hand.write(text(),text.size());
+    hand.close();
+}
+
+string metricsJsonSink::format(const metricsSnapshot &snap)
+{
+    string rv(1024,true);
+    rv += "{\"timestamp\":" + string::fromInt(int64(snap.stamp)) +
+          ",\"period\":" + string::fromInt(int64(snap.period)) + ",\"metrics\":[";
+    for(int i=0;i<snap.values.size();i++)
+    {
+        const metricValue &val = snap.values[i];
+        if(i) rv += ",";
+        rv += "{\"name\":\"" + _metrics_json_escape(val.name) + "\"";
+        switch(val.type)
+        {
+        case metricValue::COUNTER:
+            rv += ",\"type\":\"counter\",\"value\":" + _metrics_number(val.value);
+            break;
+        case metricValue::GAUGE:
+            rv += ",\"type\":\"gauge\",\"value\":" + _metrics_number(val.value);
+            break;
+        case metricValue::HISTOGRAM:
+            rv += ",\"type\":\"histogram\",\"unit\":\"ns\""
+                  ",\"count\":" + string::fromInt(int64(val.total.count())) +
+                  ",\"sum\":" + string::fromInt(int64(val.total.sum())) +
+                  ",\"window\":{\"count\":" + string::fromInt(int64(val.window.count())) +
+                  ",\"min\":" + string::fromInt(int64(val.window.min())) +
+                  ",\"p50\":" + string::fromInt(int64(val.window.percentile(50.0))) +
+                  ",\"p90\":" + string::fromInt(int64(val.window.percentile(90.0))) +
+                  ",\"p99\":" + string::fromInt(int64(val.window.percentile(99.0))) +
+                  ",\"p999\":" + string::fromInt(int64(val.window.percentile(99.9))) +
+                  ",\"max\":" + string::fromInt(int64(val.window.max())) + "}";
+            break;
+        }
+        rv += "}";
+    }
+    rv += "]}\n";
+    return rv;
+}
+
+void metricsJsonSink::write(const metricsSnapshot &snap)
+{
+    _metrics_write_file(fname,format(snap));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+metricsPrometheusSink::metricsPrometheusSink(const string &fname)
+    : fname(fname)
+{
+}
+
+metricsPrometheusSink::metricsPrometheusSink(int port)
+{
+    //флаг blocking у alt::server включает неблокирующий режим
+    server *hand = new server(connection::TCP,port,true);
+    if(hand->enable().error())
+    {
+        delete hand;
+        return;
+    }
+    listener = hand;
+}
+
+metricsPrometheusSink::~metricsPrometheusSink()
+{
+    if(listener)
+        delete (server*)listener;
+}
+
+bool metricsPrometheusSink::isValid() const
+{
+    return listener || !fname.isEmpty();
+}
+
+string metricsPrometheusSink::format(const metricsSnapshot &snap)
+{
+    string rv(2048,true);
+    for(int i=0;i<snap.values.size();i++)
+    {
+        const metricValue &val = snap.values[i];
+        string name = _metrics_prometheus_name(val.name);
+        if(!val.help.isEmpty())
+            rv += "# HELP " + name + " " + val.help + "\n";
+
+        switch(val.type)
+        {
+        case metricValue::COUNTER:
+            rv += "# TYPE " + name + " counter\n" + name + " " + _metrics_number(val.value) + "\n";
+            break;
+        case metricValue::GAUGE:
+            rv += "# TYPE " + name + " gauge\n" + name + " " + _metrics_number(val.value) + "\n";
+            break;
+        case metricValue::HISTOGRAM:
+            {
+                static const real quantiles[] = {0.5, 0.9, 0.99, 0.999};
+                rv += "# TYPE " + name + " summary\n";
+                for(int j=0;j<4;j++)
+                {
+                    //квантили по периоду отчета, пустой период - NaN
+                    rv += name + "{quantile=\"" + _metrics_number(quantiles[j]) + "\"} ";
+                    if(val.window.count())
+                        rv += string::print("%.9g",real(val.window.percentile(quantiles[j]*100.0))*1e-9) + "\n";
+                    else
+                        rv += "NaN\n";
+                }
+                rv += name + "_sum " + string::print("%.9g",real(val.total.sum())*1e-9) + "\n";
+                rv += name + "_count " + string::fromInt(int64(val.total.count())) + "\n";
+            }
+            break;
+        }
+    }
+    return rv;
+}
+
+void metricsPrometheusSink::write(const metricsSnapshot &snap)
+{
+    string text = format(snap);
+    if(!fname.isEmpty())
+        _metrics_write_file(fname,text);
+
+    mutex.lock();
+    last = text;
+    mutex.unlock();
+}
+
+void metricsPrometheusSink::poll()
+{
+    if(!listener)
+        return;
+
+    //на каждое подключение - последний снимок, содержимое запроса не разбирается
+    while(peer *client = ((server*)listener)->tryAccept())
+    {
+        char request[1024];
+        if(client->waitData(100).value()>0)
+            client->recv(request,sizeof(request));
+
+        mutex.lock();
+        string body = last;
+        mutex.unlock();
+
+        string reply = "HTTP/1.0 200 OK\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: " + string::fromInt(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n" + body;
+
+        int sent = 0;
+        uint64 deadline = alt::time::uStamp()+1000000;
+        while(sent<reply.size() && alt::time::uStamp()<deadline)
+        {
+            retCode rc = client->send(reply()+sent,reply.size()-sent);
+            if(rc.error())
+                break;
+            if(!rc.value())
+                alt::sleep(1000);
+            sent += rc.value();
+        }
+        delete client;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void _metrics_entry_free(metricsRegistry::entry *el)
+{
+    delete el->counter;
+    delete el->gauge;
+    delete el->histogram;
+    delete el;
+}
+
+metricsRegistry::metricsRegistry()
+{
+}
+
+metricsRegistry::~metricsRegistry()
+{
+    stopReporter();
+    clearSinks();
+
+    for(int i=0;i<entries.size();i++)
+        _metrics_entry_free(entries.value(i));
+    for(int i=0;i<orphans.size();i++)
+        _metrics_entry_free(orphans[i]);
+}
+
+metricsRegistry& metricsRegistry::global()
+{
+    static metricsRegistry registry;
+    return registry;
+}
+
+metricsRegistry::entry& metricsRegistry::find(const string &name, metricValue::Type type, const string &help)
+{
+    static const char *suffix[] = {"_counter", "_gauge", "_histogram"};
+
+    mutex.lock();
+    string key = name;
+    int ind = entries.indexOf(key);
+    entry *el = ind>=0 ? entries.value(ind) : nullptr;
+
+    //одно имя с разными типами - ошибка вызывающего, такая метрика регистрируется
+    //под именем с суффиксом типа и попадает в отчеты под ним
+#ifdef ENABLE_BUGEATER
+    assert(!el || el->type==type);
+#endif
+    while(el && el->type!=type)
+    {
+        key += suffix[type];
+        ind = entries.indexOf(key);
+        el = ind>=0 ? entries.value(ind) : nullptr;
+    }
+    if(!el)
+    {
+        el = new entry;
+        el->type = type;
+        switch(type)
+        {
+        case metricValue::COUNTER: el->counter = new metricCounter; break;
+        case metricValue::GAUGE: el->gauge = new metricGauge; break;
+        case metricValue::HISTOGRAM: el->histogram = new latencyRecorder(key); break;
+        }
+        entries.insert(key,el);
+        order.append(key);
+    }
+    if(!help.isEmpty())
+        el->help = help;
+    mutex.unlock();
+
+    return *el;
+}
+
+metricCounter& metricsRegistry::counter(const string &name, const string &help)
+{
+    return *find(name,metricValue::COUNTER,help).counter;
+}
+
+metricGauge& metricsRegistry::gauge(const string &name, const string &help)
+{
+    return *find(name,metricValue::GAUGE,help).gauge;
+}
+
+latencyRecorder& metricsRegistry::histogram(const string &name, const string &help)
+{
+    return *find(name,metricValue::HISTOGRAM,help).histogram;
+}
+
+void metricsRegistry::probe(const string &name, std::function<real()> fun, const string &help)
+{
+    entry &el = find(name,metricValue::GAUGE,help);
+    mutex.lock();
+    el.probe = fun;
+    mutex.unlock();
+}
+
+void metricsRegistry::remove(const string &name)
+{
+    mutex.lock();
+    int ind = entries.indexOf(name);
+    if(ind>=0)
+    {
+        entry *el = entries.value(ind);
+        entries.remove(name);
+        for(int i=0;i<order.size();i++)
+        {
+            if(order[i]==name)
+            {
+                order.cut(i);
+                break;
+            }
+        }
+        //на объекты могут ссылаться вызывающие и profiling::attach, освобождаются вместе с реестром
+        el->probe = nullptr;
+        orphans.append(el);
+    }
+    mutex.unlock();
+}
+
+metricsSnapshot metricsRegistry::snapshot()
+{
+    metricsSnapshot rv;
+    array<int> probed;
+    array<std::function<real()>> probes;
+
+    mutex.lock();
+    rv.stamp = alt::time::uStamp();
+    rv.period = last_snapshot ? rv.stamp-last_snapshot : 0;
+    last_snapshot = rv.stamp;
+
+    rv.values.resize(order.size());
+    for(int i=0;i<order.size();i++)
+    {
+        entry *el = entries[order[i]];
+        metricValue &val = rv.values[i];
+        val.name = order[i];
+        val.help = el->help;
+        val.type = el->type;
+        switch(el->type)
+        {
+        case metricValue::COUNTER:
+            val.value = real(el->counter->value());
+            break;
+        case metricValue::GAUGE:
+            if(el->probe)
+            {
+                probed.append(i);
+                probes.append(el->probe);
+            }
+            else
+            {
+                val.value = el->gauge->value();
+            }
+            break;
+        case metricValue::HISTOGRAM:
+            val.window = el->histogram->interval();
+            val.total = el->histogram->total();
+            break;
+        }
+    }
+    mutex.unlock();
+
+    //датчики - код пользователя, он может сам обращаться к реестру
+    for(int i=0;i<probes.size();i++)
+        rv.values[probed[i]].value = probes[i]();
+
+    return rv;
+}
+
+void metricsRegistry::addSink(metricsSink *sink)
+{
+    if(!sink)
+        return;
+    sink_mutex.lock();
+    sinks.append(sink);
+    sink_mutex.unlock();
+}
+
+void metricsRegistry::clearSinks()
+{
+    sink_mutex.lock();
+    for(int i=0;i<sinks.size();i++)
+        delete sinks[i];
+    sinks.clear();
+    sink_mutex.unlock();
+}
+
+void metricsRegistry::report()
+{
+    metricsSnapshot snap = snapshot();
+    sink_mutex.lock();
+    for(int i=0;i<sinks.size();i++)
+        sinks[i]->write(snap);
+    sink_mutex.unlock();
+}
+
+int metricsRegistry::reporterTick(void *data)
+{
+    (void)data;
+
+    uint64 now = alt::time::uStamp();
+    if(now>=next_report)
+    {
+        report();
+        next_report = now + report_period.load(std::memory_order_relaxed);
+    }
+
+    sink_mutex.lock();
+    for(int i=0;i<sinks.size();i++)
+        sinks[i]->poll();
+    sink_mutex.unlock();
+
+    //короткие паузы, чтобы остановка и опрос приемников не ждали целый период
+    now = alt::time::uStamp();
+    uint64 rest = next_report>now ? next_report-now : 0;
+    return int(rest<20000 ? rest : 20000);
+}
+
+bool metricsRegistry::startReporter(int interval_ms)
+{
+    if(interval_ms<=0)
+        return false;
+    stopReporter();
+
+    report_period.store(uint64(interval_ms)*1000,std::memory_order_relaxed);
+    next_report = alt::time::uStamp() + uint64(interval_ms)*1000;
+
+    reporter = new thread(delegate<int,void*>(this,&metricsRegistry::reporterTick));
+    return reporter->run(nullptr,true);
+}
+
+void metricsRegistry::stopReporter()
+{
+    if(!reporter)
+        return;
+    reporter->wait();
+    delete reporter;
+    reporter = nullptr;
+}
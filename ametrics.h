@@ -0,0 +1,270 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AMETRICS_H
+#define AMETRICS_H
+
+#include "at_profiling.h"
+#include "at_hash.h"
+#include "athread.h"
+
+#include <functional>
+
+// Общий реестр метрик процесса: счетчики, датчики, гистограммы задержек и таймеры profiling.
+// Горячий путь (add/set/record) не берет блокировок, снимок собирается фоновым потоком
+// с заданным периодом и раздается приемникам: текстовый лог, JSON, формат Prometheus.
+
+namespace alt {
+
+    //счетчик, разнесенный по полосам кеша, чтобы потоки не делили одну линию
+    class metricCounter
+    {
+    public:
+        enum
+        {
+            STRIPES = 16
+        };
+
+        void add(int64 val = 1)
+        {
+            cells[stripe()].value.fetch_add(val,std::memory_order_relaxed);
+        }
+
+        int64 value() const
+        {
+            int64 rv = 0;
+            for(int i=0;i<STRIPES;i++)
+                rv += cells[i].value.load(std::memory_order_relaxed);
+            return rv;
+        }
+
+        void reset()
+        {
+            for(int i=0;i<STRIPES;i++)
+                cells[i].value.store(0,std::memory_order_relaxed);
+        }
+
+    private:
+
+        struct alignas(64) cell
+        {
+            std::atomic<int64> value = 0;
+        };
+
+        static int stripe()
+        {
+            static std::atomic<int> next(0);
+            static thread_local int index = next.fetch_add(1,std::memory_order_relaxed) & (STRIPES-1);
+            return index;
+        }
+
+        cell cells[STRIPES];
+    };
+
+    class metricGauge
+    {
+    public:
+        void set(real val)
+        {
+            current.store(val,std::memory_order_relaxed);
+        }
+
+        void add(real val)
+        {
+            current.fetch_add(val,std::memory_order_relaxed);
+        }
+
+        real value() const
+        {
+            return current.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<real> current = 0.0;
+    };
+
+    struct metricValue
+    {
+        enum Type
+        {
+            COUNTER,
+            GAUGE,
+            HISTOGRAM
+        };
+
+        string name;
+        string help;
+        Type type = COUNTER;
+
+        real value = 0.0;           //счетчик или датчик
+        latencyHistogram total;     //гистограмма (нс) с момента создания
+        latencyHistogram window;    //гистограмма (нс) за период отчета
+    };
+
+    struct metricsSnapshot
+    {
+        uint64 stamp = 0; //time::uStamp()
+        uint64 period = 0; //мкс с прошлого снимка
+        array<metricValue> values;
+    };
+
+    class metricsSink
+    {
+    public:
+        virtual ~metricsSink(){}
+
+        virtual void write(const metricsSnapshot &snap) = 0;
+
+        //вызывается фоновым потоком между отчетами
+        virtual void poll(){}
+    };
+
+    //построчный лог, пустое имя - stdout
+    class metricsTextSink : public metricsSink
+    {
+    public:
+        metricsTextSink(const string &fname = string()) : fname(fname) {}
+
+        void write(const metricsSnapshot &snap) override;
+
+        static string format(const metricsSnapshot &snap);
+
+    private:
+        string fname;
+    };
+
+    //файл с последним снимком, перезаписывается целиком
+    class metricsJsonSink : public metricsSink
+    {
+    public:
+        metricsJsonSink(const string &fname) : fname(fname) {}
+
+        void write(const metricsSnapshot &snap) override;
+
+        static string format(const metricsSnapshot &snap);
+
+    private:
+        string fname;
+    };
+
+    //текстовый формат Prometheus: файл (для textfile collector) или HTTP-порт для опроса,
+    //гистограммы выдаются как summary в секундах
+    class metricsPrometheusSink : public metricsSink
+    {
+    public:
+        metricsPrometheusSink(const string &fname);
+        metricsPrometheusSink(int port);
+        ~metricsPrometheusSink();
+
+        bool isValid() const;
+
+        void write(const metricsSnapshot &snap) override;
+        void poll() override;
+
+        static string format(const metricsSnapshot &snap);
+
+    private:
+        string fname;
+        void *listener = nullptr;
+        semaphore mutex;
+        string last;
+    };
+
+    class metricsRegistry : public delegateBase
+    {
+    public:
+        metricsRegistry();
+        ~metricsRegistry();
+
+        metricsRegistry(const metricsRegistry &val) = delete;
+        metricsRegistry& operator=(const metricsRegistry &val) = delete;
+
+        static metricsRegistry& global();
+
+        //объекты живут до разрушения реестра, ссылку стоит сохранить у себя;
+        //имя, уже занятое метрикой другого типа, получает суффикс _counter, _gauge или _histogram
+        metricCounter& counter(const string &name, const string &help = string());
+        metricGauge& gauge(const string &name, const string &help = string());
+        latencyRecorder& histogram(const string &name, const string &help = string());
+
+        //датчик, значение которого запрашивается при снятии снимка (в фоновом потоке)
+        void probe(const string &name, std::function<real()> fun, const string &help = string());
+
+        template<typename T>
+        void attach(profiling<T> &prof, const string &name, const string &help = string())
+        {
+            prof.attach(&histogram(name,help));
+        }
+
+        //метрика исчезает из отчетов, но объект живет до разрушения реестра, поэтому
+        //сохраненные ссылки и подключенные profiling остаются рабочими (и пишут в никуда);
+        //повторная регистрация имени создает новый объект
+        void remove(const string &name);
+
+        metricsSnapshot snapshot();
+
+        //реестр становится владельцем приемника
+        void addSink(metricsSink *sink);
+        void clearSinks();
+
+        //снимок во все приемники прямо сейчас
+        void report();
+
+        bool startReporter(int interval_ms);
+        void stopReporter();
+
+        struct entry
+        {
+            metricValue::Type type;
+            string help;
+            metricCounter *counter = nullptr;
+            metricGauge *gauge = nullptr;
+            latencyRecorder *histogram = nullptr;
+            std::function<real()> probe;
+        };
+
+    private:
+
+        entry& find(const string &name, metricValue::Type type, const string &help);
+        int reporterTick(void *data);
+
+        semaphore mutex;
+        hash<string,entry*> entries;
+        array<string> order;
+        array<entry*> orphans; //удаленные через remove
+        uint64 last_snapshot = 0;
+
+        semaphore sink_mutex;
+        array<metricsSink*> sinks;
+
+        thread *reporter = nullptr;
+        std::atomic<uint64> report_period = 0;
+        uint64 next_report = 0;
+    };
+
+} // namespace alt
+
+#endif // AMETRICS_H
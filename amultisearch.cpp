@@ -0,0 +1,273 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "amultisearch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+    #define ALT_MULTISEARCH_SSE2
+    #include <emmintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define ALT_MULTISEARCH_NEON
+    #include <arm_neon.h>
+#endif
+
+using namespace alt;
+
+static __inline uint8 foldCase(uint8 val)
+{
+    return (val>='A' && val<='Z') ? val+('a'-'A') : val;
+}
+
+multiSearch::multiSearch()
+{
+    clear();
+}
+
+multiSearch::multiSearch(const array<string> &patterns, bool caseless)
+{
+    build(patterns,caseless);
+}
+
+void multiSearch::clear()
+{
+    caseless=false;
+    classCount=1;
+    ::memset(classes,0,sizeof(classes));
+    table.clear();
+    table.append(0);
+    outStart.clear();
+    outStart.append(0);
+    outStart.append(0);
+    outList.clear();
+    outLink.clear();
+    outLink.append(0);
+    lengths.clear();
+    startCount=0;
+}
+
+void multiSearch::build(const array<string> &patterns, bool caseless)
+{
+    clear();
+    this->caseless=caseless;
+
+    //классы байт: 0 - байты, которых нет в шаблонах
+    for(int i=0;i<patterns.size();i++)
+    {
+        const uint8 *str=(const uint8*)patterns[i]();
+        for(int k=0;k<patterns[i].size();k++)
+        {
+            uint8 sym=caseless?foldCase(str[k]):str[k];
+            if(!classes[sym])classes[sym]=uint16(classCount++);
+        }
+    }
+    if(caseless)
+    {
+        for(int sym='A';sym<='Z';sym++)
+            classes[sym]=classes[sym+('a'-'A')];
+    }
+    const int cc=classCount;
+
+    //бор шаблонов, -1 - нет перехода
+    array<int32> trie;
+    trie.resize(cc);
+    trie.fill(-1);
+    array<int32> ownCount;
+    ownCount.append(0);
+    array<int32> terminal;
+    for(int i=0;i<patterns.size();i++)
+    {
+        const uint8 *str=(const uint8*)patterns[i]();
+        int size=patterns[i].size();
+        lengths.append(size);
+        terminal.append(-1);
+        if(!size)continue;
+
+        int node=0;
+        for(int k=0;k<size;k++)
+        {
+            int32 &next=trie[node*cc+classes[str[k]]];
+            if(next<0)
+            {
+                next=ownCount.size();
+                ownCount.append(0);
+                int tail=trie.size();
+                trie.resize(tail+cc);
+                for(int c=0;c<cc;c++)trie[tail+c]=-1;
+            }
+            node=trie[node*cc+classes[str[k]]];
+        }
+        terminal[i]=node;
+        ownCount[node]++;
+    }
+    const int nodes=ownCount.size();
+
+    //собственные совпадения узлов подряд, в порядке шаблонов
+    outStart.resize(nodes+1);
+    outStart[0]=0;
+    for(int i=0;i<nodes;i++)
+        outStart[i+1]=outStart[i]+ownCount[i];
+    outList.resize(outStart[nodes]);
+    for(int i=0;i<nodes;i++)
+        ownCount[i]=outStart[i];
+    for(int i=0;i<patterns.size();i++)
+    {
+        if(terminal[i]>=0)
+            outList[ownCount[terminal[i]]++]=i;
+    }
+
+    //обход в ширину: суффиксные ссылки и достройка переходов до полного автомата;
+    //переходы суффикса уже достроены, так как он ближе к корню
+    array<int32> fail, queue;
+    fail.resize(nodes);
+    fail.fill(0);
+    outLink.resize(nodes);
+    outLink.fill(0);
+    for(int c=0;c<cc;c++)
+    {
+        int32 &next=trie[c];
+        if(next<0)next=0;
+        else queue.append(next);
+    }
+    for(int head=0;head<queue.size();head++)
+    {
+        int node=queue[head];
+        int link=fail[node];
+        outLink[node] = outStart[link+1]>outStart[link] ? link : outLink[link];
+        for(int c=0;c<cc;c++)
+        {
+            int32 &next=trie[node*cc+c];
+            if(next<0)next=trie[link*cc+c];
+            else
+            {
+                fail[next]=trie[link*cc+c];
+                queue.append(next);
+            }
+        }
+    }
+
+    //итоговая таблица: номера состояний умножены на число классов,
+    //переход в состояние с совпадениями инвертирован
+    table.resize(nodes*cc);
+    for(int i=0;i<nodes*cc;i++)
+    {
+        int32 node=trie[i];
+        bool hit = outStart[node+1]>outStart[node] || outLink[node];
+        table[i] = hit ? ~(node*cc) : node*cc;
+    }
+
+    //пропуск из корня имеет смысл, только если начальных байт мало
+    uint8 start[256];
+    ::memset(start,0,sizeof(start));
+    for(int i=0;i<patterns.size();i++)
+    {
+        if(!patterns[i].size())continue;
+        uint8 sym=uint8(patterns[i]()[0]);
+        if(caseless)
+        {
+            sym=foldCase(sym);
+            if(sym>='a' && sym<='z')start[sym-('a'-'A')]=1;
+        }
+        start[sym]=1;
+    }
+    int count=0;
+    for(int i=0;i<256;i++)
+    {
+        if(!start[i])continue;
+        if(count==4)
+        {
+            count=0;
+            break;
+        }
+        startBytes[count++]=uint8(i);
+    }
+    startCount=count;
+    for(int i=count;i<4 && count;i++)
+        startBytes[i]=startBytes[0];
+}
+
+int64 multiSearch::memoryUsage() const
+{
+    return sizeof(*this)+int64(table.size()+outStart.size()+outList.size()+outLink.size()+lengths.size())*sizeof(int32);
+}
+
+int multiSearch::skipToStart(const uint8 *data, int from, int size) const
+{
+    int i=from;
+#if defined(ALT_MULTISEARCH_SSE2)
+    const __m128i b0=_mm_set1_epi8(char(startBytes[0])), b1=_mm_set1_epi8(char(startBytes[1]));
+    const __m128i b2=_mm_set1_epi8(char(startBytes[2])), b3=_mm_set1_epi8(char(startBytes[3]));
+    for(;i+16<=size;i+=16)
+    {
+        __m128i block=_mm_loadu_si128((const __m128i*)(data+i));
+        __m128i hit=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block,b0),_mm_cmpeq_epi8(block,b1)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(block,b2),_mm_cmpeq_epi8(block,b3)));
+        uint32 mask=_mm_movemask_epi8(hit);
+        if(mask)
+        {
+        #if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long pos;
+            _BitScanForward(&pos,mask);
+            return i+int(pos);
+        #else
+            return i+__builtin_ctz(mask);
+        #endif
+        }
+    }
+#elif defined(ALT_MULTISEARCH_NEON)
+    const uint8x16_t b0=vdupq_n_u8(startBytes[0]), b1=vdupq_n_u8(startBytes[1]);
+    const uint8x16_t b2=vdupq_n_u8(startBytes[2]), b3=vdupq_n_u8(startBytes[3]);
+    for(;i+16<=size;i+=16)
+    {
+        uint8x16_t block=vld1q_u8(data+i);
+        uint8x16_t hit=vorrq_u8(vorrq_u8(vceqq_u8(block,b0),vceqq_u8(block,b1)),
+                                vorrq_u8(vceqq_u8(block,b2),vceqq_u8(block,b3)));
+        if(vmaxvq_u8(hit))break;
+    }
+#endif
+    for(;i<size;i++)
+    {
+        uint8 sym=data[i];
+        if(sym==startBytes[0] || sym==startBytes[1] || sym==startBytes[2] || sym==startBytes[3])break;
+    }
+    return i;
+}
+
+array<multiSearch::match> multiSearch::findAll(const void *data, int size) const
+{
+    array<match> rv;
+    scan(data,size,[&rv](const match &val){rv.append(val);return true;});
+    return rv;
+}
+
+bool multiSearch::contains(const void *data, int size) const
+{
+    return !scan(data,size,[](const match&){return false;});
+}
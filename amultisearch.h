@@ -0,0 +1,218 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AMULTISEARCH_H
+#define AMULTISEARCH_H
+
+#include "atypes.h"
+#include "astring.h"
+#include "abyte_array.h"
+#include "afile.h"
+
+// Поиск множества шаблонов за один проход (автомат Ахо-Корасик).
+// Переходы - плотная таблица по классам байт: байты, которых нет в шаблонах, образуют
+// один класс, так что строка таблицы занимает число классов, а не 256 элементов.
+// Номер состояния в таблице заранее умножен на число классов, отрицательный переход
+// (инверсия) ведет в состояние с совпадениями. После build() автомат только читается
+// и может использоваться из нескольких потоков одновременно.
+
+namespace alt {
+
+    class multiSearch
+    {
+    public:
+
+        struct match
+        {
+            int pattern;  //индекс шаблона в исходном списке
+            int64 offset; //смещение начала совпадения
+        };
+
+        multiSearch();
+        //caseless - без учета регистра латинских букв (ASCII)
+        explicit multiSearch(const array<string> &patterns, bool caseless=false);
+
+        //пустые шаблоны сохраняют свой индекс, но не находятся
+        void build(const array<string> &patterns, bool caseless=false);
+        void clear();
+
+        int patternCount() const {return lengths.size();}
+        int patternSize(int index) const {return lengths[index];}
+        int stateCount() const {return outStart.size()-1;}
+        bool isCaseless() const {return caseless;}
+        int64 memoryUsage() const;
+
+        //onMatch(const match&) возвращает false для остановки поиска;
+        //совпадения выдаются в порядке их конца, все, включая перекрывающиеся
+        template<typename F>
+        bool scan(const void *data, int size, F onMatch) const
+        {
+            int32 state=0;
+            int64 position=0;
+            return run(state,position,(const uint8*)data,size,onMatch);
+        }
+
+        array<match> findAll(const void *data, int size) const;
+        array<match> findAll(const string &text) const {return findAll(text(),text.size());}
+        array<match> findAll(const byteArray &data) const {return findAll(data(),data.size());}
+
+        bool contains(const void *data, int size) const;
+        bool contains(const string &text) const {return contains(text(),text.size());}
+        bool contains(const byteArray &data) const {return contains(data(),data.size());}
+
+        //поиск по кускам потока: состояние автомата и смещение переносятся между вызовами,
+        //так что совпадения на границе кусков не теряются
+        class cursor
+        {
+        public:
+            explicit cursor(const multiSearch &owner) : owner(&owner) {reset();}
+
+            void reset() {state=0;position=0;}
+            int64 pos() const {return position;}
+
+            template<typename F>
+            bool feed(const void *data, int size, F onMatch)
+            {
+                return owner->run(state,position,(const uint8*)data,size,onMatch);
+            }
+            array<match> feed(const void *data, int size)
+            {
+                array<match> rv;
+                feed(data,size,[&rv](const match &val){rv.append(val);return true;});
+                return rv;
+            }
+
+        private:
+            const multiSearch *owner;
+            int32 state;
+            int64 position;
+        };
+
+        //поиск в файле или потоке от текущей позиции до конца, кусками по chunk байт;
+        //смещения отсчитываются от начальной позиции, возвращает число просмотренных байт
+        //или -1 при ошибке чтения
+        template<typename F>
+        int64 scan(fileProto *hand, F onMatch, int chunk=0x100000) const
+        {
+            cursor cur(*this);
+            uint8 *buff=new uint8[chunk];
+            int64 rv=0;
+            for(;;)
+            {
+                int readed=hand->read(buff,chunk);
+                if(readed<0)
+                {
+                    rv=-1;
+                    break;
+                }
+                if(!readed)break;
+                bool next=cur.feed(buff,readed,onMatch);
+                rv=cur.pos();
+                if(!next)break;
+            }
+            delete []buff;
+            return rv;
+        }
+        array<match> findAll(fileProto *hand, int chunk=0x100000) const
+        {
+            array<match> rv;
+            scan(hand,[&rv](const match &val){rv.append(val);return true;},chunk);
+            return rv;
+        }
+
+    private:
+
+        template<typename F>
+        bool run(int32 &state, int64 &position, const uint8 *data, int size, F &onMatch) const
+        {
+            const int32 *next=table();
+            int32 s=state;
+            int i=0;
+            while(i<size)
+            {
+                //из корня - сразу к ближайшему байту, с которого начинается шаблон
+                if(startCount && !s)
+                {
+                    i=skipToStart(data,i,size);
+                    if(i>=size)break;
+                }
+                int32 t=next[s+classes[data[i++]]];
+                if(t>=0)
+                {
+                    s=t;
+                    continue;
+                }
+                s=~t;
+                if(!report(s,position+i,onMatch))
+                {
+                    state=s;
+                    position+=i;
+                    return false;
+                }
+            }
+            state=s;
+            position+=size;
+            return true;
+        }
+
+        template<typename F>
+        bool report(int32 s, int64 end, F &onMatch) const
+        {
+            //собственные совпадения состояния, затем по цепочке суффиксов с совпадениями
+            int32 node=s/classCount;
+            do
+            {
+                for(int k=outStart[node];k<outStart[node+1];k++)
+                {
+                    match val;
+                    val.pattern=outList[k];
+                    val.offset=end-lengths[val.pattern];
+                    if(!onMatch(val))return false;
+                }
+                node=outLink[node];
+            }
+            while(node);
+            return true;
+        }
+
+        int skipToStart(const uint8 *data, int from, int size) const;
+
+        bool caseless;
+        int classCount;
+        uint16 classes[256];
+        array<int32> table;    //переходы [состояние*classCount+класс]
+        array<int32> outStart; //совпадения состояния: outList[outStart[i]..outStart[i+1])
+        array<int32> outList;
+        array<int32> outLink;  //ближайший суффикс с совпадениями, 0 - нет
+        array<int32> lengths;
+        //байты начала шаблонов для быстрого пропуска из корня (если их не больше 4)
+        int startCount;
+        uint8 startBytes[4];
+    };
+
+} //namespace alt
+
+#endif // AMULTISEARCH_H
@@ -285,14 +285,27 @@ retCode connection::status()
     delay.tv_sec=0;
     delay.tv_usec=0;
 
-    if(select(0,NULL,&w,&e,&delay)==SOCKET_ERROR)
+    if(select(int(hand->sock)+1,NULL,&w,&e,&delay)==SOCKET_ERROR)
     {
         disconnect();
         hand->last_error=errSelect();
         return hand->last_error;
     }
-    if(FD_ISSET(hand->sock, &w))
+    if(FD_ISSET(hand->sock, &w) || FD_ISSET(hand->sock, &e))
     {
+        //сёкет готов и в случае отказа - итог подключения в SO_ERROR
+        int err=0;
+#if defined(__linux) || defined(__APPLE__)
+        socklen_t len=sizeof(err);
+#else
+        int len=sizeof(err);
+#endif
+        if(getsockopt(hand->sock,SOL_SOCKET,SO_ERROR,(char*)&err,&len)==SOCKET_ERROR || err)
+        {
+            disconnect();
+            hand->last_error=errConnect();
+            return hand->last_error;
+        }
         hand->initLevel=4;
     }
 
@@ -306,6 +319,29 @@ retCode connection::lastError()
     return hand->last_error;
 }
 
+int64 connection::nativeHandle()
+{
+    ASocketInternal *hand=(ASocketInternal*)internal;
+    if(hand->initLevel<2)return -1;
+    return int64(hand->sock);
+}
+
+retCode connection::setBlocking(bool blocking)
+{
+    ASocketInternal *hand=(ASocketInternal*)internal;
+    if(hand->initLevel>1)
+    {
+        unsigned long tmp=blocking?0:1;
+        if(ioctlsocket(hand->sock,FIONBIO,&tmp)==SOCKET_ERROR)
+        {
+            hand->last_error=errSocketUnblock();
+            return hand->last_error;
+        }
+    }
+    hand->blocking=blocking;
+    return 1;
+}
+
 retCode connection::disconnect()
 {
     ASocketInternal *hand=(ASocketInternal*)internal;
@@ -793,6 +829,13 @@ retCode server::lastError()
     return hand->last_error;
 }
 
+int64 server::nativeHandle()
+{
+    AServerInternal *hand=(AServerInternal*)internal;
+    if(hand->initLevel<2)return -1;
+    return int64(hand->msock);
+}
+
 //////////////////////////////////////////////////////////////////////
 peer::peer(void *iDatum)
 {
@@ -809,6 +852,7 @@ peer::~peer()
         shutdown(hand->sock,SD_BOTH);
         closesocket(hand->sock);
     }
+    delete hand;
 }
 
 retCode peer::send(const void *data, int size)
@@ -916,3 +960,24 @@ retCode peer::lastError()
     APeerInternal *hand=(APeerInternal*)internal;
     return hand->last_error;
 }
+
+int64 peer::nativeHandle()
+{
+    APeerInternal *hand=(APeerInternal*)internal;
+    if(!hand->initLevel)return -1;
+    return int64(hand->sock);
+}
+
+retCode peer::setBlocking(bool blocking)
+{
+    APeerInternal *hand=(APeerInternal*)internal;
+    if(!hand->initLevel)return hand->last_error;
+    unsigned long tmp=blocking?0:1;
+    if(ioctlsocket(hand->sock,FIONBIO,&tmp)==SOCKET_ERROR)
+    {
+        hand->last_error=errSocketUnblock();
+        return hand->last_error;
+    }
+    hand->blocking=blocking;
+    return 1;
+}
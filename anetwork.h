@@ -74,6 +74,10 @@ namespace alt {
         retCode recvAll(void *data, int size, int timeout_us, int minimal_size=-1);
         retCode waitData(int time_ms);
 
+        //////////////////////////////////////////////////////////////////////
+        int64 nativeHandle(); //дескриптор сёкета для внешнего ожидания готовности, -1 если не создан
+        retCode setBlocking(bool blocking); //до connect() - запоминается, после - переключает сёкет
+
         //////////////////////////////////////////////////////////////////////
         static bool isIP(const string &addr);
         static string toIP(const string &addr);
@@ -107,6 +111,10 @@ namespace alt {
         retCode status();
         retCode lastError();
 
+        //////////////////////////////////////////////////////////////////////
+        int64 nativeHandle();
+        retCode setBlocking(bool blocking);
+
     private:
         void *internal;
     };
@@ -129,6 +137,7 @@ namespace alt {
 
         //////////////////////////////////////////////////////////////////////
         retCode lastError();
+        int64 nativeHandle();
 
     private:
 
@@ -31,7 +31,7 @@ using namespace alt;
 object::object()
 {
     m_parent = nullptr;
-    m_name="root";
+    m_name=atom("root");
 }
 
 object::~object()
@@ -73,7 +73,7 @@ object::object(const object &val)
 object::object(const string &name)
 {
     m_parent=nullptr;
-    m_name=name;
+    m_name=atom(name);
 }
 
 object& object::operator=(const object &val)
@@ -83,7 +83,7 @@ object& object::operator=(const object &val)
     if(!m_parent)m_name=val.m_name;
 
     array<array<object*> > list=val.m_items.values();
-    array<string> listk=val.m_items.keys();
+    array<atom> listk=val.m_items.keys();
     for(int i=0;i<list.size();i++)
     {
         m_items.insert(listk[i],array<object*>());
@@ -97,7 +97,7 @@ object& object::operator=(const object &val)
     }
 
     array<variant> atvlist = val.m_attributes.values();
-    array<string> atklist = val.m_attributes.keys();
+    array<atom> atklist = val.m_attributes.keys();
     for(int i=0;i<atvlist.size();i++)
     {
         //!!!deep copy needed???
@@ -155,7 +155,7 @@ void object::clear()
     m_items.clear();
 }
 
-void object::remAttr(const string &name)
+void object::remAttr(const atom &name)
 {
     if(m_name.isEmpty() || name.isEmpty())
         return;
@@ -170,7 +170,7 @@ void object::remAttr(const string &name)
     m_attributes.remove(name);
 }
 
-void object::setAttr(const string &name, const variant &val)
+void object::setAttr(const atom &name, const variant &val)
 {
     if(m_name.isEmpty() || name.isEmpty())
         return;
@@ -197,18 +197,45 @@ bool object::checkAttributes(const hash<string, variant> &list)
 
     for(int i=0;i<list.size();i++)
     {
-        if(list.keys()[i].isEmpty())
+        if(!checkAttr(list.keys()[i],list.values()[i]))
             return false;
-        if(!m_attributes.contains(list.keys()[i]))
-            return false;
-        const variant& a=attr(list.keys()[i]);
-        const variant& que=list.values()[i];
-
-        if(a!=que)return false;
     }
     return true;
 }
 
+hash<string, variant> object::attributes()
+{
+    hash<string, variant> rv;
+    if(m_name.isEmpty())
+        return rv;
+    for(int i=0;i<m_attr_order.size();i++)
+        rv.insert(m_attr_order[i].str(),m_attributes[m_attr_order[i]]);
+    return rv;
+}
+
+array<string> object::listAttributes()
+{
+    array<string> rv;
+    if(m_name.isEmpty())
+        return rv;
+    rv.reserve(m_attr_order.size());
+    for(int i=0;i<m_attr_order.size();i++)
+        rv.append(m_attr_order[i].str());
+    return rv;
+}
+
+array<string> object::itemNames()
+{
+    array<string> rv;
+    array<atom> keys = m_items.keys();
+    for(int i=0;i<keys.size();i++)
+    {
+        if(!keys[i].isEmpty())
+            rv.append(keys[i].str());
+    }
+    return rv;
+}
+
 object* object::existedItem(const string &path, std::function<bool(object*)> check)
 {
     if(m_name.isEmpty())
@@ -223,13 +250,16 @@ object* object::existedItem(const string &path, std::function<bool(object*)> che
 
     for(int i=0;i<nodes.size();i++)
     {
-        if(!curr->m_items.contains(nodes[i]))
+        atom key;
+        if(!atom::find(nodes[i],key))
+            return nullptr;
+        if(!curr->m_items.contains(key))
         {
             return nullptr;
         }
         else
         {
-            const array<object*>& arr = curr->m_items[nodes[i]];
+            const array<object*>& arr = curr->m_items[key];
             int j=0;
             for(;j<arr.size();j++)
             {
@@ -268,22 +298,25 @@ object* object::existedItem(const string &path, uint index)
 
     for(int i=0;i<nodes.size();i++)
     {
+        atom key;
+        if(!atom::find(nodes[i],key))
+            return nullptr;
         if(i == nodes.size()-1)
         {
-            int append = index + 1 - curr->m_items[nodes[i]].size();
+            int append = index + 1 - curr->m_items[key].size();
             if(append > 0)
             {
                 return nullptr;
             }
-            curr = curr->m_items[nodes[i]][index];
+            curr = curr->m_items[key][index];
         }
-        else if(!curr->m_items.contains(nodes[i]))
+        else if(!curr->m_items.contains(key))
         {
             return nullptr;
         }
         else
         {
-            curr = curr->m_items[nodes[i]][0];
+            curr = curr->m_items[key][0];
         }
     }
 
@@ -301,30 +334,31 @@ object* object::item(const string &path, uint index)
 
     for(int i=0;i<nodes.size();i++)
     {
+        atom key(nodes[i]);
         if(i == nodes.size()-1)
         {
-            int append = index + 1 - curr->m_items[nodes[i]].size();
+            int append = index + 1 - curr->m_items[key].size();
             while(append > 0)
             {
                 object *tmp = new object(nodes[i]);
                 tmp->m_parent = curr;
-                curr->m_items[nodes[i]].append(tmp);
+                curr->m_items[key].append(tmp);
                 curr->m_item_order.append(tmp);
                 append--;
             }
-            curr = curr->m_items[nodes[i]][index];
+            curr = curr->m_items[key][index];
         }
-        else if(!curr->m_items.contains(nodes[i]))
+        else if(!curr->m_items.contains(key))
         {
             object *tmp = new object(nodes[i]);
             tmp->m_parent = curr;
-            curr->m_items[nodes[i]].append(tmp);
+            curr->m_items[key].append(tmp);
             curr->m_item_order.append(tmp);
             curr = tmp;
         }
         else
         {
-            curr = curr->m_items[nodes[i]][0];
+            curr = curr->m_items[key][0];
         }
     }
 
@@ -342,17 +376,18 @@ object* object::item(const string &path, const hash<string, variant> &with_attri
 
     for(int i=0;i<nodes.size();i++)
     {
-        if(!curr->m_items.contains(nodes[i]))
+        atom key(nodes[i]);
+        if(!curr->m_items.contains(key))
         {
             object *tmp = new object(nodes[i]);
             tmp->m_parent = curr;
-            curr->m_items[nodes[i]].append(tmp);
+            curr->m_items[key].append(tmp);
             curr->m_item_order.append(tmp);
             curr = tmp;
         }
         else
         {
-            const array<object*>& arr = curr->m_items[nodes[i]];
+            const array<object*>& arr = curr->m_items[key];
             int j=0;
             for(;j<arr.size();j++)
             {
@@ -371,7 +406,7 @@ object* object::item(const string &path, const hash<string, variant> &with_attri
             {
                 object *tmp = new object(nodes[i]);
                 tmp->m_parent = curr;
-                curr->m_items[nodes[i]].append(tmp);
+                curr->m_items[key].append(tmp);
                 curr->m_item_order.append(tmp);
                 curr = tmp;
             }
@@ -397,16 +432,19 @@ array<object*> object::listItems(const string &path)
 
     for(int i=0;i<nodes.size();i++)
     {
-        if(!curr->m_items.contains(nodes[i]))
+        atom key;
+        if(!atom::find(nodes[i],key))
+            return array<object*>();
+        if(!curr->m_items.contains(key))
         {
             return array<object*>();
         }
         else
         {
             if(i == nodes.size()-1)
-                return curr->m_items[nodes[i]];
+                return curr->m_items[key];
 
-            curr = curr->m_items[nodes[i]][0];
+            curr = curr->m_items[key][0];
         }
     }
 
@@ -420,7 +458,7 @@ object* object::addItem(const object &val)
 
     object *obj=new object(val);
     obj->m_parent=this;
-    m_items[obj->name()].append(obj);
+    m_items[obj->m_name].append(obj);
     m_item_order.append(obj);
     return obj;
 }
@@ -432,7 +470,7 @@ object* object::addItem(const string &name)
 
     object *obj=new object(name);
     obj->m_parent=this;
-    m_items[obj->name()].append(obj);
+    m_items[obj->m_name].append(obj);
     m_item_order.append(obj);
     return obj;
 }
@@ -466,32 +504,32 @@ variant object::content(const variant &defval, uint index)
 {
     if(m_name.isEmpty())
     {
-        if(!m_attributes.contains(string()))
+        if(!m_attributes.contains(atom()))
             return defval;
-        return m_attributes[string()];
+        return m_attributes[atom()];
     }
 
     uint size = 0;
-    if(m_items.contains(string()))
-        size = m_items[string()].size();
+    if(m_items.contains(atom()))
+        size = m_items[atom()].size();
 
     if(size<=index)
         return defval;
 
-    return m_items[string()][index]->m_attributes[string()];
+    return m_items[atom()][index]->m_attributes[atom()];
 }
 
 void object::setContent(const variant &val, uint index)
 {
     if(m_name.isEmpty())
     {
-        m_attributes[string()] = val;
+        m_attributes[atom()] = val;
         return;
     }
 
     uint size = 0;
-    if(m_items.contains(string()))
-        size = m_items[string()].size();
+    if(m_items.contains(atom()))
+        size = m_items[atom()].size();
 
     while(size<=index)
     {
@@ -499,35 +537,35 @@ void object::setContent(const variant &val, uint index)
         size++;
     }
 
-    m_items[string()][index]->m_attributes[string()] = val;
+    m_items[atom()][index]->m_attributes[atom()] = val;
 }
 
 void object::addContent(const variant &val)
 {
     if(m_name.isEmpty())
     {
-        m_attributes[string()] += val;
+        m_attributes[atom()] += val;
         return;
     }
 
     object *obj=new object(string());
     obj->m_parent=this;
-    m_items[string()].append(obj);
+    m_items[atom()].append(obj);
     m_item_order.append(obj);
-    obj->m_attributes[string()] = val;
+    obj->m_attributes[atom()] = val;
 }
 
 void object::remContent()
 {
     if(m_name.isEmpty())
     {
-        m_attributes[string()] = variant();
+        m_attributes[atom()] = variant();
         return;
     }
 
-    if(!m_items.contains(string()))
+    if(!m_items.contains(atom()))
         return;
-    array<object*> list = m_items[string()];
+    array<object*> list = m_items[atom()];
     for(int i=0;i<list.size();i++)
     {
         delete list[i];
@@ -28,6 +28,7 @@ SOFTWARE.
 #define AOBJECT_H
 
 #include "avariant.h"
+#include "aatom.h"
 #include <functional>
 
 namespace alt {
@@ -50,38 +51,63 @@ namespace alt {
         void moveBefore(object *node, object *before);
 
         //Attributes stuff
+        //names are interned: string overloads look the atom up, atom overloads skip even that
 
-        variant attr(const string &name, const variant &defval=variant())
-        { //will create attribute if not exists
+        variant attr(const atom &name, const variant &defval=variant()) const
+        {
             if(name.isEmpty() || m_name.isEmpty())
                 return defval;
-            if(!m_attributes.contains(name))
+            int ind=m_attributes.indexOf(name);
+            if(ind<0)
                 return defval;
-            return m_attributes[name];
+            return m_attributes.value(ind);
         }
-        bool hasAttr(const string &name) const
+        variant attr(const string &name, const variant &defval=variant()) const
+        {
+            atom key;
+            if(!atom::find(name,key))
+                return defval;
+            return attr(key,defval);
+        }
+        bool hasAttr(const atom &name) const
         {
             if(m_name.isEmpty())
                 return false;
             return m_attributes.contains(name);
         }
-        bool checkAttr(const string &name, const variant &val)
+        bool hasAttr(const string &name) const
+        {
+            atom key;
+            return atom::find(name,key) && hasAttr(key);
+        }
+        bool checkAttr(const atom &name, const variant &val) const
         {
             if(name.isEmpty() || m_name.isEmpty())
                 return false;
-            if(!m_attributes.contains(name))
+            int ind=m_attributes.indexOf(name);
+            if(ind<0)
                 return false;
-            if(m_attributes[name] == val)
-                return true;
-            return false;
+            return m_attributes.value(ind) == val;
+        }
+        bool checkAttr(const string &name, const variant &val) const
+        {
+            atom key;
+            return atom::find(name,key) && checkAttr(key,val);
+        }
+        void setAttr(const atom &name, const variant &val);
+        void setAttr(const string &name, const variant &val) {setAttr(atom(name),val);}
+        void remAttr(const atom &name);
+        void remAttr(const string &name)
+        {
+            atom key;
+            if(atom::find(name,key))
+                remAttr(key);
         }
-        void setAttr(const string &name, const variant &val);
-        void remAttr(const string &name);
 
-        hash<string, variant> attributes() { if(m_name.isEmpty()) return hash<string, variant>(); return m_attributes; }
+        hash<string, variant> attributes();
         void setAttributes(const hash<string, variant> &list);
         bool checkAttributes(const hash<string, variant> &list);
-        array<string> listAttributes() { if(m_name.isEmpty()) return array<string>(); return m_attr_order; }
+        array<string> listAttributes();
 
         //Items stuff
 
@@ -98,21 +124,17 @@ namespace alt {
         void remItems(const string &path); //for single item - just delete object
         void remItems(const string &path, std::function<bool(object*)> check);
 
-        array<string> itemNames()
-        {
-            array<string> rv = m_items.keys();
-            rv.removeValue(string());
-            return rv;
-        }
+        array<string> itemNames();
 
         //Node stuff
 
-        const string& name(){return m_name;}
+        string name() const {return m_name.str();}
+        const atom& nameAtom() const {return m_name;}
         void setName(const string &val)
         {
             if(val.isEmpty())
                 return;
-            m_name=val;
+            m_name=atom(val);
         }
 
         variant content(const variant &defval=variant(), uint index = 0);
@@ -123,12 +145,12 @@ namespace alt {
     private:
 
         object *m_parent;
-        string m_name;
-        hash<string, variant> m_attributes;
-        hash<string, array<object*> > m_items;
+        atom m_name;
+        hash<atom, variant> m_attributes;
+        hash<atom, array<object*> > m_items;
 
         //we need to keep order in documents in some cases important and useful for version control systems
-        array<string> m_attr_order;
+        array<atom> m_attr_order;
         array<object*> m_item_order;
 
     };
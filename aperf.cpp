@@ -0,0 +1,280 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "aperf.h"
+
+#if defined(linux) || defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #include <string.h>
+    #define ALT_PERF_LINUX
+#endif
+
+using namespace alt;
+
+const char* perfSample::eventName(int event)
+{
+    static const char *names[COUNT] = {"cycles","instructions","llc-misses","branch-misses","context-switches"};
+    if(event<0 || event>=COUNT)
+        return "";
+    return names[event];
+}
+
+string perfSample::toString(uint64 samples) const
+{
+    if(!valid)
+        return "perf: N/A";
+    if(!samples)
+        samples = 1;
+
+    string rv(128,true);
+    for(int i=0;i<COUNT;i++)
+    {
+        if(!has(i))
+            continue;
+        if(!rv.isEmpty())
+            rv += ", ";
+        rv += string(eventName(i)) + " = " + string::fromReal(real(value[i])/real(samples),4);
+    }
+    if(has(CYCLES) && has(INSTRUCTIONS))
+        rv += ", ipc = " + string::fromReal(ipc(),3);
+    return rv;
+}
+
+perfCounters::perfCounters(bool open_now)
+{
+    for(int i=0;i<perfSample::COUNT;i++)
+    {
+        fds[i] = -1;
+        ids[i] = 0;
+    }
+    if(open_now)
+        open();
+}
+
+perfCounters::~perfCounters()
+{
+    close();
+}
+
+#ifdef ALT_PERF_LINUX
+
+static string _perf_error_text(int err)
+{
+    if(err==EACCES || err==EPERM)
+    {
+        string rv = "permission denied";
+        FILE *hand = fopen("/proc/sys/kernel/perf_event_paranoid","r");
+        if(hand)
+        {
+            int level;
+            if(fscanf(hand,"%d",&level)==1)
+                rv += " (perf_event_paranoid = " + string::fromInt(level) + ")";
+            fclose(hand);
+        }
+        return rv;
+    }
+    if(err==ENOENT || err==EOPNOTSUPP)
+        return "not supported";
+    if(err==ENOSYS)
+        return "perf_event_open is not available";
+    return string(strerror(err));
+}
+
+bool perfCounters::open()
+{
+    close();
+
+    static const uint32 types[perfSample::COUNT] =
+    {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_SOFTWARE
+    };
+    static const uint64 configs[perfSample::COUNT] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_SW_CONTEXT_SWITCHES
+    };
+
+    for(int i=0;i<perfSample::COUNT;i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr,0,sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        //без ядра аппаратные счетчики доступны при perf_event_paranoid <= 2,
+        //переключения контекста же происходят в ядре и с exclude_kernel всегда нулевые
+        attr.exclude_kernel = types[i]==PERF_TYPE_HARDWARE;
+        attr.exclude_hv = 1;
+
+        //первое открывшееся событие становится лидером группы, вся группа читается одним вызовом
+        int fd = syscall(SYS_perf_event_open,&attr,0,-1,leader,0);
+        if(fd<0)
+        {
+            string msg = string(perfSample::eventName(i)) + ": " + _perf_error_text(errno);
+            error += error.isEmpty() ? msg : "; " + msg;
+            continue;
+        }
+
+        if(ioctl(fd,PERF_EVENT_IOC_ID,&ids[i])<0)
+        {
+            ::close(fd);
+            continue;
+        }
+
+        fds[i] = fd;
+        if(leader<0)
+            leader = fd;
+        available.valid |= 1<<i;
+    }
+
+    return isAvailable();
+}
+
+void perfCounters::close()
+{
+    //лидер закрывается последним
+    for(int i=0;i<perfSample::COUNT;i++)
+    {
+        if(fds[i]>=0 && fds[i]!=leader)
+            ::close(fds[i]);
+        fds[i] = -1;
+    }
+    if(leader>=0)
+        ::close(leader);
+    leader = -1;
+    available.valid = 0;
+    error.clear();
+    running = false;
+}
+
+perfSample perfCounters::read() const
+{
+    perfSample rv;
+    if(leader<0)
+        return rv;
+
+    uint64 buff[3+2*perfSample::COUNT];
+    if(::read(leader,buff,sizeof(buff))<(ssize_t)(3*sizeof(uint64)))
+        return rv;
+
+    uint64 nr = buff[0];
+    uint64 enabled = buff[1];
+    uint64 running_time = buff[2];
+    //группа ни разу не попала на PMU: нули - не измерение, выборка недействительна
+    if(!running_time)
+        return rv;
+    real scale = running_time<enabled ? real(enabled)/real(running_time) : 1.0;
+
+    for(uint64 j=0;j<nr && j<perfSample::COUNT;j++)
+    {
+        uint64 val = buff[3+j*2];
+        uint64 id = buff[4+j*2];
+        for(int i=0;i<perfSample::COUNT;i++)
+        {
+            if(fds[i]>=0 && ids[i]==id)
+            {
+                rv.value[i] = scale==1.0 ? val : uint64(real(val)*scale);
+                break;
+            }
+        }
+    }
+    rv.valid = available.valid;
+    return rv;
+}
+
+#else
+
+bool perfCounters::open()
+{
+    error = "perf counters are not supported on this platform";
+    return false;
+}
+
+void perfCounters::close()
+{
+    running = false;
+}
+
+perfSample perfCounters::read() const
+{
+    return perfSample();
+}
+
+#endif
+
+void perfCounters::start()
+{
+    if(!isAvailable())
+        return;
+    started = read();
+    running = true;
+}
+
+void perfCounters::stop()
+{
+    if(!running)
+        return;
+    running = false;
+
+    perfSample now = read();
+    perfSample delta;
+    delta.valid = now.valid & started.valid;
+    if(!delta.valid)
+        return;
+    for(int i=0;i<perfSample::COUNT;i++)
+        delta.value[i] = now.value[i]>started.value[i] ? now.value[i]-started.value[i] : 0;
+
+    interval_acc.add(delta);
+    total_acc.add(delta);
+    total_samples++;
+}
+
+perfSample perfCounters::interval()
+{
+    perfSample rv = interval_acc;
+    interval_acc.clear();
+    return rv;
+}
+
+void perfCounters::reset()
+{
+    interval_acc = perfSample();
+    total_acc = perfSample();
+    total_samples = 0;
+}
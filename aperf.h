@@ -0,0 +1,161 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef APERF_H
+#define APERF_H
+
+#include "atypes.h"
+#include "astring.h"
+
+// Аппаратные счетчики производительности потока через perf_event_open (Linux).
+// Если ядро или права не дают открыть событие, оно просто помечается недоступным,
+// остальные продолжают работать; на других системах все события недоступны.
+
+namespace alt {
+
+    struct perfSample
+    {
+        enum
+        {
+            CYCLES = 0,
+            INSTRUCTIONS,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            CONTEXT_SWITCHES,
+            COUNT
+        };
+
+        uint64 value[COUNT] = {0,0,0,0,0};
+        uint32 valid = 0; //маска доступных событий
+
+        bool has(int event) const
+        {
+            return valid & (1<<event);
+        }
+
+        uint64 cycles() const {return value[CYCLES];}
+        uint64 instructions() const {return value[INSTRUCTIONS];}
+        uint64 llcMisses() const {return value[LLC_MISSES];}
+        uint64 branchMisses() const {return value[BRANCH_MISSES];}
+        uint64 contextSwitches() const {return value[CONTEXT_SWITCHES];}
+
+        real ipc() const
+        {
+            if(!has(CYCLES) || !has(INSTRUCTIONS) || !value[CYCLES])
+                return 0.0;
+            return real(value[INSTRUCTIONS])/real(value[CYCLES]);
+        }
+
+        void add(const perfSample &val)
+        {
+            for(int i=0;i<COUNT;i++)
+                value[i] += val.value[i];
+            valid |= val.valid;
+        }
+
+        void clear()
+        {
+            for(int i=0;i<COUNT;i++)
+                value[i] = 0;
+        }
+
+        static const char* eventName(int event);
+
+        //значения делятся на samples (усреднение на замер)
+        string toString(uint64 samples = 1) const;
+    };
+
+    class perfCounters
+    {
+    public:
+        perfCounters(bool open_now = true);
+        ~perfCounters();
+
+        perfCounters(const perfCounters &val) = delete;
+        perfCounters& operator=(const perfCounters &val) = delete;
+
+        //счетчики вызывающего потока, только пользовательский режим
+        bool open();
+        void close();
+
+        bool isAvailable() const {return available.valid!=0;}
+        uint32 availableMask() const {return available.valid;}
+        const string& lastError() const {return error;}
+
+        //текущие значения с начала open(), с поправкой на мультиплексирование;
+        //valid==0, если группа еще ни разу не была запущена ядром
+        perfSample read() const;
+
+        //start/stop вызываются в том же потоке, что и open();
+        //интервал с недействительной выборкой на концах не учитывается
+        void start();
+        void stop();
+
+        //накопленное между start/stop с прошлого вызова, со сбросом
+        perfSample interval();
+        const perfSample& total() const {return total_acc;}
+        uint64 samples() const {return total_samples;}
+        void reset();
+
+    private:
+
+        int fds[perfSample::COUNT];
+        uint64 ids[perfSample::COUNT];
+        int leader = -1;
+        perfSample available;
+        string error;
+
+        perfSample started;
+        bool running = false;
+
+        perfSample interval_acc;
+        perfSample total_acc;
+        uint64 total_samples = 0;
+    };
+
+    class perfScope
+    {
+    public:
+        perfScope(perfCounters &counters)
+            : hand(counters)
+        {
+            hand.start();
+        }
+        ~perfScope()
+        {
+            hand.stop();
+        }
+
+        perfScope(const perfScope &val) = delete;
+        perfScope& operator=(const perfScope &val) = delete;
+
+    private:
+        perfCounters &hand;
+    };
+
+} // namespace alt
+
+#endif // APERF_H
@@ -1,5 +1,6 @@
 ﻿#include "astreamer.h"
 #include <alterlib/afile.h>
+#include <alterlib/atrace.h>
 #include <memory.h>
 
 using namespace alt;
@@ -15,7 +16,9 @@ streamer::streamer(const alt::string &fname, int buff_in, int buff_out)
     read_end = false;
     queryMode = currentMode = MODE_SLEEP;
 
-    thread = new alt::thread(alt::delegate<int,void*>(this,&streamer::run));
+    alt::threadAttributes attr;
+    attr.name = "alt.streamer";
+    thread = new alt::thread(alt::delegate<int,void*>(this,&streamer::run),attr);
     thread->run(this);
 }
 
@@ -124,6 +127,7 @@ int streamer::run(void *user)
     {        
         if(currentMode==MODE_WRITE && ring_write.Size())
         {
+            ALT_TRACE_SCOPE_CAT("io","streamer::write");
             int n=ring_write.blockSizeToRead();
             hand.write((char*)ring_write.startPoint(),n);
             ring_write.Free(n);
@@ -162,6 +166,7 @@ int streamer::run(void *user)
 
         if(currentMode==MODE_READ && ring_read.Allow() && !read_end)
         {
+            ALT_TRACE_SCOPE_CAT("io","streamer::read");
             int n=ring_read.blockSizeToWrite();
             int writed=hand.read((char*)ring_read.afterPoint(),n);
             if(writed>0)
@@ -29,6 +29,12 @@ public:
 
     alt::string fileName(){return filename;}
 
+    //привязка и приоритет потока ввода-вывода
+    bool setThreadAttributes(const alt::threadAttributes &attr)
+    {
+        return thread->setAttributes(attr);
+    }
+
     //управление потоком
     void moveTo(int64 pos);
     int64 fileSize();
@@ -27,6 +27,12 @@ SOFTWARE.
 #include "astring.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <charconv>
+
+#include "external/fmt/format.h"
 
 #include "astring_utf.h"
 #include "astring_latin.h"
@@ -55,41 +61,924 @@ static bool isspace(char val)
     return false;
 }
 
-alt::hash<uint32,uint32> gen_ttab_to_lower()
+//////////////////////////////////////////////////////////////////////////
+//поиск по блокам: SSE2 (на x86-64 есть всегда), AVX2 при поддержке процессором, NEON на ARM64
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+    #define ALT_STRING_SSE2
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define ALT_TARGET_AVX2
+    #else
+        #define ALT_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define ALT_STRING_NEON
+    #include <arm_neon.h>
+#endif
+
+static __inline uint32 lowBit32(uint32 val)
 {
-    alt::hash<uint32,uint32> rv;
-    for(uint i=0;i<sizeof(as_upper_to_lower)/(sizeof(as_upper_to_lower[0])*2);i++)
-        rv.insert(as_upper_to_lower[i*2],as_upper_to_lower[i*2+1]);
+#ifdef _MSC_VER
+    unsigned long rv;
+    _BitScanForward(&rv,val);
     return rv;
+#else
+    return __builtin_ctz(val);
+#endif
 }
 
-const static alt::hash<uint32,uint32> ttab_to_lower = gen_ttab_to_lower();
+static __inline uint32 highBit32(uint32 val)
+{
+#ifdef _MSC_VER
+    unsigned long rv;
+    _BitScanReverse(&rv,val);
+    return rv;
+#else
+    return 31-__builtin_clz(val);
+#endif
+}
 
-string string::toLower() const
+#ifdef ALT_STRING_SSE2
+static bool hasAvx2()
 {
-    string rv;
-    for(int i=0;i<size();)
+    static const bool rv = []()
+    {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info,0);
+        if(info[0]<7)return false;
+        __cpuid(info,1);
+        //OSXSAVE и сохранение состояния YMM операционной системой
+        if(!(info[2]&(1<<27)) || (_xgetbv(0)&6)!=6)return false;
+        __cpuidex(info,7,0);
+        return (info[1]&(1<<5))!=0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }();
+    return rv;
+}
+
+template<typename F>
+ALT_TARGET_AVX2
+static int scanSubstrAvx2(const char *hay, int size, const char *needle, int len, int &skip, F &hit)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[len-1]);
+    int i=0;
+    while(i+len-1+32<=size)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(hay+i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(hay+i+len-1));
+        uint32 mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a,first),_mm256_cmpeq_epi8(b,last)));
+        while(mask)
+        {
+            int pos = i+lowBit32(mask);
+            mask &= mask-1;
+            if(pos<skip || memcmp(hay+pos+1,needle+1,len-2))continue;
+            if((skip=hit(pos))<0)return -1;
+        }
+        i+=32;
+        if(i<skip)i=skip;
+    }
+    return i;
+}
+#endif
+
+//обход непересекающихся вхождений слева направо; кандидаты отбираются сразу для всего блока
+//по первому и последнему символу образца, hit(pos) возвращает позицию продолжения поиска или -1
+template<typename F>
+static void scanSubstr(const char *hay, int size, const char *needle, int len, F hit)
+{
+    if(len<=0 || size<len)return;
+    int i=0, skip=0;
+    if(len==1)
+    {
+        while(i<size)
+        {
+            const char *pnt = (const char*)memchr(hay+i,needle[0],size-i);
+            if(!pnt || (i=hit(int(pnt-hay)))<0)return;
+        }
+        return;
+    }
+
+#if defined(ALT_STRING_SSE2)
+    if(hasAvx2())
+    {
+        if((i=scanSubstrAvx2(hay,size,needle,len,skip,hit))<0)return;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[len-1]);
+    while(i+len-1+16<=size)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(hay+i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(hay+i+len-1));
+        uint32 mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a,first),_mm_cmpeq_epi8(b,last)));
+        while(mask)
+        {
+            int pos = i+lowBit32(mask);
+            mask &= mask-1;
+            if(pos<skip || memcmp(hay+pos+1,needle+1,len-2))continue;
+            if((skip=hit(pos))<0)return;
+        }
+        i+=16;
+        if(i<skip)i=skip;
+    }
+#elif defined(ALT_STRING_NEON)
+    const uint8x16_t first = vdupq_n_u8(needle[0]);
+    const uint8x16_t last = vdupq_n_u8(needle[len-1]);
+    while(i+len-1+16<=size)
+    {
+        uint8x16_t a = vld1q_u8((const uint8*)(hay+i));
+        uint8x16_t b = vld1q_u8((const uint8*)(hay+i+len-1));
+        uint8x16_t eq = vandq_u8(vceqq_u8(a,first),vceqq_u8(b,last));
+        //по 4 бита на байт
+        uint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq),4)),0);
+        while(mask)
+        {
+            int bit = __builtin_ctzll(mask);
+            int pos = i+(bit>>2);
+            mask &= ~(uint64(0xf)<<(bit&~3));
+            if(pos<skip || memcmp(hay+pos+1,needle+1,len-2))continue;
+            if((skip=hit(pos))<0)return;
+        }
+        i+=16;
+        if(i<skip)i=skip;
+    }
+#endif
+    for(;i+len<=size;i++)
+    {
+        if(i<skip)i=skip;
+        if(i+len>size)break;
+        if(hay[i]==needle[0] && hay[i+len-1]==needle[len-1] && !memcmp(hay+i+1,needle+1,len-2))
+        {
+            if((skip=hit(i))<0)return;
+        }
+    }
+}
+
+static int findSubstr(const char *hay, int size, const char *needle, int len)
+{
+    int rv=-1;
+    scanSubstr(hay,size,needle,len,[&rv](int pos){rv=pos; return -1;});
+    return rv;
+}
+
+//последнее вхождение символа не дальше from
+static int findBack(const char *buff, int from, char val)
+{
+    int i=from+1;
+#if defined(ALT_STRING_SSE2)
+    const __m128i seek = _mm_set1_epi8(val);
+    while(i>=16)
+    {
+        uint32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buff+i-16)),seek));
+        if(mask)return i-16+highBit32(mask);
+        i -= 16;
+    }
+#elif defined(ALT_STRING_NEON)
+    const uint8x16_t seek = vdupq_n_u8(val);
+    while(i>=16)
+    {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8*)(buff+i-16)),seek);
+        uint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq),4)),0);
+        if(mask)return i-16+((63-__builtin_clzll(mask))>>2);
+        i -= 16;
+    }
+#endif
+    while(--i>=0)
+    {
+        if(buff[i]==val)return i;
+    }
+    return -1;
+}
+
+//первый символ из набора: до 16 символов сравниваются блоком, больше - по таблице
+static int findOneOf(const char *buff, int from, int size, const char *set)
+{
+    int count = alt::utils::strlen(set);
+    if(!count || from>=size)return -1;
+    if(count==1)
+    {
+        const char *pnt = (const char*)memchr(buff+from,set[0],size-from);
+        return pnt ? int(pnt-buff) : -1;
+    }
+
+    int i=from;
+#if defined(ALT_STRING_SSE2) || defined(ALT_STRING_NEON)
+    if(count<=16)
+    {
+    #if defined(ALT_STRING_SSE2)
+        __m128i seek[16];
+        for(int j=0;j<count;j++)seek[j] = _mm_set1_epi8(set[j]);
+        for(;i+16<=size;i+=16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)(buff+i));
+            __m128i hit = _mm_cmpeq_epi8(block,seek[0]);
+            for(int j=1;j<count;j++)hit = _mm_or_si128(hit,_mm_cmpeq_epi8(block,seek[j]));
+            uint32 mask = _mm_movemask_epi8(hit);
+            if(mask)return i+lowBit32(mask);
+        }
+    #else
+        uint8x16_t seek[16];
+        for(int j=0;j<count;j++)seek[j] = vdupq_n_u8(set[j]);
+        for(;i+16<=size;i+=16)
+        {
+            uint8x16_t block = vld1q_u8((const uint8*)(buff+i));
+            uint8x16_t hit = vceqq_u8(block,seek[0]);
+            for(int j=1;j<count;j++)hit = vorrq_u8(hit,vceqq_u8(block,seek[j]));
+            uint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit),4)),0);
+            if(mask)return i+(__builtin_ctzll(mask)>>2);
+        }
+    #endif
+    }
+#endif
+    bool table[256] = {};
+    for(int j=0;j<count;j++)table[uint8(set[j])] = true;
+    for(;i<size;i++)
+    {
+        if(table[uint8(buff[i])])return i;
+    }
+    return -1;
+}
+
+//замена символа на месте
+static void replaceByte(char *buff, int size, char seek, char val)
+{
+    int i=0;
+#if defined(ALT_STRING_SSE2)
+    const __m128i from = _mm_set1_epi8(seek);
+    const __m128i to = _mm_set1_epi8(val);
+    for(;i+16<=size;i+=16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(buff+i));
+        __m128i hit = _mm_cmpeq_epi8(block,from);
+        if(!_mm_movemask_epi8(hit))continue;
+        _mm_storeu_si128((__m128i*)(buff+i),_mm_or_si128(_mm_and_si128(hit,to),_mm_andnot_si128(hit,block)));
+    }
+#elif defined(ALT_STRING_NEON)
+    const uint8x16_t from = vdupq_n_u8(seek);
+    const uint8x16_t to = vdupq_n_u8(val);
+    for(;i+16<=size;i+=16)
+    {
+        uint8x16_t block = vld1q_u8((const uint8*)(buff+i));
+        vst1q_u8((uint8*)(buff+i),vbslq_u8(vceqq_u8(block,from),to,block));
+    }
+#endif
+    for(;i<size;i++)
+    {
+        if(buff[i]==seek)buff[i]=val;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//UTF-8: проверка, перекодировка и смена регистра.
+//ASCII обрабатывается блоками по 16 байт, остальное - посимвольно
+
+int string::decodeUtf8(const char *str, int left, uint32 &val)
+{
+    const uint8 *s=(const uint8*)str;
+    uint8 c=s[0];
+    if(c<0x80)
+    {
+        val=c;
+        return 1;
+    }
+    //частые случаи - двух- и трехбайтные последовательности
+    if((c&0xE0)==0xC0 && left>=2 && (s[1]&0xC0)==0x80)
+    {
+        val=((c&0x1F)<<6)|(s[1]&0x3F);
+        return 2;
+    }
+    if((c&0xF0)==0xE0 && left>=3 && (s[1]&0xC0)==0x80 && (s[2]&0xC0)==0x80)
+    {
+        val=((c&0x0F)<<12)|((s[1]&0x3F)<<6)|(s[2]&0x3F);
+        return 3;
+    }
+    val=0xFFFD;
+    if((c&0xC0)==0x80)return 1;
+
+    const static int mask[]={0xC0,0xE0,0xF0,0xF8,0xFC,0xFE};
+    for(int k=0;k<5;k++)
+    {
+        if((c&mask[k+1])!=mask[k])continue;
+        if(left<=k+1)return 1;
+        uint32 tmp=(c&(~mask[k+1])&0xff)<<((k+1)*6);
+        for(int i=0;i<=k;i++)
+        {
+            if((s[i+1]&0xC0)!=0x80)return 1;
+            tmp|=(s[i+1]&0x3f)<<((k-i)*6);
+        }
+        val=tmp;
+        return k+2;
+    }
+    return 1;
+}
+
+//кодирование как в append_unicode, dst - не менее 6 байт
+static __inline int encodeUtf8(uint8 *dst, uint32 val)
+{
+    if(val<0x80)
+    {
+        dst[0]=uint8(val);
+        return 1;
+    }
+    if(val<0x800)
+    {
+        dst[0]=uint8(0xC0|(val>>6));
+        dst[1]=uint8(0x80|(val&0x3F));
+        return 2;
+    }
+    if(val&0x80000000)val=0xFFFD;
+    if(val<0x10000)
+    {
+        dst[0]=uint8(0xE0|(val>>12));
+        dst[1]=uint8(0x80|((val>>6)&0x3F));
+        dst[2]=uint8(0x80|(val&0x3F));
+        return 3;
+    }
+    const static uint8 lead[]={0xF0,0xF8,0xFC};
+    int len = val<0x200000 ? 4 : (val<0x4000000 ? 5 : 6);
+    for(int i=len-1;i>0;i--)
+    {
+        dst[i]=uint8(0x80|(val&0x3F));
+        val>>=6;
+    }
+    dst[0]=uint8(lead[len-4]|val);
+    return len;
+}
+
+static __inline int encodeUtf8Size(uint32 val)
+{
+    if(val<0x80)return 1;
+    if(val<0x800)return 2;
+    if(val<0x10000 || (val&0x80000000))return 3;
+    return val<0x200000 ? 4 : (val<0x4000000 ? 5 : 6);
+}
+
+static bool validUtf8Scalar(const uint8 *s, int size)
+{
+    int i=0;
+    while(i<size)
+    {
+        //ASCII пропускаем по 8 байт
+        if(i+8<=size)
+        {
+            uint64 word;
+            ::memcpy(&word,s+i,8);
+            if(!(word&0x8080808080808080ull))
+            {
+                i+=8;
+                continue;
+            }
+        }
+        uint8 c=s[i];
+        if(c<0x80)
+        {
+            i++;
+            continue;
+        }
+        int len;
+        if(c>=0xC2 && c<=0xDF)len=2;
+        else if((c&0xF0)==0xE0)len=3;
+        else if(c>=0xF0 && c<=0xF4)len=4;
+        else return false;
+        if(i+len>size)return false;
+        uint32 val=c&(0x7F>>len);
+        for(int k=1;k<len;k++)
+        {
+            if((s[i+k]&0xC0)!=0x80)return false;
+            val=(val<<6)|(s[i+k]&0x3F);
+        }
+        if(len==3 && (val<0x800 || (val>=0xD800 && val<=0xDFFF)))return false;
+        if(len==4 && (val<0x10000 || val>0x10FFFF))return false;
+        i+=len;
+    }
+    return true;
+}
+
+#ifdef ALT_STRING_SSE2
+//проверка по таблицам старших и младших тетрад соседних байт (Keiser, Lemire):
+//каждый бит таблиц - один из видов ошибки, ошибка есть, если бит выставлен во всех трех
+ALT_TARGET_AVX2
+static bool validUtf8Avx2(const uint8 *s, int size)
+{
+    const uint8 TOO_SHORT=1<<0, TOO_LONG=1<<1, OVERLONG_3=1<<2, TOO_LARGE=1<<3,
+                SURROGATE=1<<4, OVERLONG_2=1<<5, TOO_LARGE_1000=1<<6, OVERLONG_4=1<<6,
+                TWO_CONTS=1<<7;
+    const uint8 CARRY=TOO_SHORT|TOO_LONG|TWO_CONTS;
+
+    //первый байт пары, старшая тетрада
+    const static uint8 tabHigh1[16]=
+    {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT|OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT|OVERLONG_3|SURROGATE,
+        TOO_SHORT|TOO_LARGE|TOO_LARGE_1000|OVERLONG_4
+    };
+    //первый байт пары, младшая тетрада
+    const static uint8 tabLow1[16]=
+    {
+        CARRY|OVERLONG_3|OVERLONG_2|OVERLONG_4,
+        CARRY|OVERLONG_2,
+        CARRY, CARRY,
+        CARRY|TOO_LARGE,
+        CARRY|TOO_LARGE|TOO_LARGE_1000,
+        CARRY|TOO_LARGE|TOO_LARGE_1000, CARRY|TOO_LARGE|TOO_LARGE_1000,
+        CARRY|TOO_LARGE|TOO_LARGE_1000, CARRY|TOO_LARGE|TOO_LARGE_1000,
+        CARRY|TOO_LARGE|TOO_LARGE_1000, CARRY|TOO_LARGE|TOO_LARGE_1000,
+        CARRY|TOO_LARGE|TOO_LARGE_1000,
+        CARRY|TOO_LARGE|TOO_LARGE_1000|SURROGATE,
+        CARRY|TOO_LARGE|TOO_LARGE_1000, CARRY|TOO_LARGE|TOO_LARGE_1000
+    };
+    //второй байт пары, старшая тетрада
+    const static uint8 tabHigh2[16]=
+    {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG|OVERLONG_2|TWO_CONTS|OVERLONG_3|TOO_LARGE_1000|OVERLONG_4,
+        TOO_LONG|OVERLONG_2|TWO_CONTS|OVERLONG_3|TOO_LARGE,
+        TOO_LONG|OVERLONG_2|TWO_CONTS|SURROGATE|TOO_LARGE,
+        TOO_LONG|OVERLONG_2|TWO_CONTS|SURROGATE|TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+    };
+    //незавершенная последовательность в конце блока
+    const static uint8 tabTail[32]=
+    {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0-1, 0xE0-1, 0xC0-1
+    };
+
+    const __m256i high1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tabHigh1));
+    const __m256i low1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tabLow1));
+    const __m256i high2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tabHigh2));
+    const __m256i tail = _mm256_loadu_si256((const __m256i*)tabTail);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i third = _mm256_set1_epi8(char(0xE0-0x80));
+    const __m256i fourth = _mm256_set1_epi8(char(0xF0-0x80));
+    const __m256i top = _mm256_set1_epi8(char(0x80));
+
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    uint8 rest[32];
+    int i=0;
+    for(;;)
+    {
+        //остаток дополняется нулями, так что обрыв последовательности в конце тоже ошибка
+        bool last = i+32>size;
+        __m256i input;
+        if(!last)input = _mm256_loadu_si256((const __m256i*)(s+i));
+        else
+        {
+            ::memset(rest,0,sizeof(rest));
+            ::memcpy(rest,s+i,size-i);
+            input = _mm256_loadu_si256((const __m256i*)rest);
+        }
+
+        if(!_mm256_movemask_epi8(input))
+        {
+            error = _mm256_or_si256(error,incomplete);
+        }
+        else
+        {
+            __m256i carry = _mm256_permute2x128_si256(prev,input,0x21);
+            __m256i prev1 = _mm256_alignr_epi8(input,carry,15);
+            __m256i prev2 = _mm256_alignr_epi8(input,carry,14);
+            __m256i prev3 = _mm256_alignr_epi8(input,carry,13);
+
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(_mm256_shuffle_epi8(high1,_mm256_and_si256(_mm256_srli_epi16(prev1,4),nibble)),
+                                 _mm256_shuffle_epi8(low1,_mm256_and_si256(prev1,nibble))),
+                _mm256_shuffle_epi8(high2,_mm256_and_si256(_mm256_srli_epi16(input,4),nibble)));
+            //после трех- и четырехбайтного начала обязательны продолжения
+            __m256i must = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(prev2,third),
+                                                            _mm256_subs_epu8(prev3,fourth)),top);
+            error = _mm256_or_si256(error,_mm256_xor_si256(must,special));
+            incomplete = _mm256_subs_epu8(input,tail);
+        }
+        prev = input;
+        if(last)break;
+        i+=32;
+    }
+    return _mm256_testz_si256(error,error);
+}
+#endif
+
+bool string::isValidUtf8(const char *str, int size)
+{
+#ifdef ALT_STRING_SSE2
+    if(hasAvx2())return validUtf8Avx2((const uint8*)str,size);
+#endif
+    return validUtf8Scalar((const uint8*)str,size);
+}
+
+//UTF-8 -> UTF-16 (sizeof(T)==2) или UTF-32, dst - не менее size элементов
+template<typename T>
+static int utf8ToUnits(const uint8 *s, int size, T *dst)
+{
+    int i=0,n=0;
+    while(i<size)
     {
+    #if defined(ALT_STRING_SSE2)
+        const __m128i zero=_mm_setzero_si128();
+        for(;i+16<=size;i+=16,n+=16)
+        {
+            __m128i block=_mm_loadu_si128((const __m128i*)(s+i));
+            if(_mm_movemask_epi8(block))break;
+            __m128i lo=_mm_unpacklo_epi8(block,zero), hi=_mm_unpackhi_epi8(block,zero);
+            if constexpr(sizeof(T)==2)
+            {
+                _mm_storeu_si128((__m128i*)(dst+n),lo);
+                _mm_storeu_si128((__m128i*)(dst+n+8),hi);
+            }
+            else
+            {
+                _mm_storeu_si128((__m128i*)(dst+n),_mm_unpacklo_epi16(lo,zero));
+                _mm_storeu_si128((__m128i*)(dst+n+4),_mm_unpackhi_epi16(lo,zero));
+                _mm_storeu_si128((__m128i*)(dst+n+8),_mm_unpacklo_epi16(hi,zero));
+                _mm_storeu_si128((__m128i*)(dst+n+12),_mm_unpackhi_epi16(hi,zero));
+            }
+        }
+    #elif defined(ALT_STRING_NEON)
+        for(;i+16<=size;i+=16,n+=16)
+        {
+            uint8x16_t block=vld1q_u8(s+i);
+            if(vmaxvq_u8(block)&0x80)break;
+            uint16x8_t lo=vmovl_u8(vget_low_u8(block)), hi=vmovl_u8(vget_high_u8(block));
+            if constexpr(sizeof(T)==2)
+            {
+                vst1q_u16((uint16*)(dst+n),lo);
+                vst1q_u16((uint16*)(dst+n+8),hi);
+            }
+            else
+            {
+                vst1q_u32((uint32*)(dst+n),vmovl_u16(vget_low_u16(lo)));
+                vst1q_u32((uint32*)(dst+n+4),vmovl_u16(vget_high_u16(lo)));
+                vst1q_u32((uint32*)(dst+n+8),vmovl_u16(vget_low_u16(hi)));
+                vst1q_u32((uint32*)(dst+n+12),vmovl_u16(vget_high_u16(hi)));
+            }
+        }
+    #endif
+        //блок с не-ASCII символами разбираем посимвольно
+        int stop = i+16<size ? i+16 : size;
+        while(i<stop)
+        {
+            uint32 val=s[i];
+            if(val<0x80)i++;
+            else i+=string::decodeUtf8((const char*)s+i,size-i,val);
+            if constexpr(sizeof(T)==2)
+            {
+                if(val>0xFFFF)
+                {
+                    if(val>0x10FFFF)val=0xFFFD;
+                    else
+                    {
+                        //четырехбайтная последовательность - не меньше двух элементов на выходе
+                        val-=0x10000;
+                        dst[n++]=T(0xD800|(val>>10));
+                        val=0xDC00|(val&0x3FF);
+                    }
+                }
+            }
+            dst[n++]=T(val);
+        }
+    }
+    return n;
+}
+
+//число элементов до нуля или до size
+template<typename T>
+static int unitsLength(const T *str, int size)
+{
+    int rv=0;
+    while(rv!=size && str[rv])rv++;
+    return rv;
+}
+
+#if defined(ALT_STRING_SSE2)
+//все элементы блока меньше 0x80
+template<typename T>
+static __inline bool unitsAscii(__m128i val)
+{
+    const __m128i high = sizeof(T)==2 ? _mm_set1_epi16(short(0xFF80)) : _mm_set1_epi32(int(0xFFFFFF80));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(val,high),_mm_setzero_si128()))==0xFFFF;
+}
+#endif
+
+//длина ASCII префикса в элементах UTF-16/UTF-32, по блокам
+template<typename T>
+static int unitsAsciiPrefix(const T *src, int count)
+{
+    int i=0;
+#if defined(ALT_STRING_SSE2)
+    const int step=32/sizeof(T);
+    for(;i+step<=count;i+=step)
+    {
+        __m128i a=_mm_loadu_si128((const __m128i*)(src+i));
+        __m128i b=_mm_loadu_si128((const __m128i*)(src+i+step/2));
+        if(!unitsAscii<T>(_mm_or_si128(a,b)))break;
+    }
+#endif
+    while(i<count && uint32(src[i])<0x80)i++;
+    return i;
+}
+
+template<typename T>
+static string unitsToUtf8(const T *src, int size)
+{
+    int count=unitsLength(src,size);
+
+    //точный размер результата
+    int len=unitsAsciiPrefix(src,count);
+    int rsize=len;
+    for(int i=len;i<count;i++)
+    {
+        uint32 val=uint32(src[i]);
+        if constexpr(sizeof(T)==2)
+        {
+            if((val&0xFC00)==0xD800 && i+1<count && (uint32(src[i+1])&0xFC00)==0xDC00)
+            {
+                rsize+=4;
+                i++;
+                continue;
+            }
+        }
+        rsize+=encodeUtf8Size(val);
+    }
+
+    string rv(rsize,false);
+    uint8 *dst=(uint8*)rv();
+    int i=0,n=0;
+    while(i<count)
+    {
+    #if defined(ALT_STRING_SSE2)
+        for(;i+16<=count;i+=16,n+=16)
+        {
+            const __m128i *p=(const __m128i*)(src+i);
+            __m128i lo,hi;
+            if constexpr(sizeof(T)==2)
+            {
+                lo=_mm_loadu_si128(p);
+                hi=_mm_loadu_si128(p+1);
+                if(!unitsAscii<T>(_mm_or_si128(lo,hi)))break;
+            }
+            else
+            {
+                __m128i a=_mm_loadu_si128(p), b=_mm_loadu_si128(p+1);
+                __m128i c=_mm_loadu_si128(p+2), d=_mm_loadu_si128(p+3);
+                if(!unitsAscii<T>(_mm_or_si128(_mm_or_si128(a,b),_mm_or_si128(c,d))))break;
+                lo=_mm_packs_epi32(a,b);
+                hi=_mm_packs_epi32(c,d);
+            }
+            _mm_storeu_si128((__m128i*)(dst+n),_mm_packus_epi16(lo,hi));
+        }
+    #endif
+        int stop = i+16<count ? i+16 : count;
+        while(i<stop)
+        {
+            uint32 val=uint32(src[i++]);
+            if(val<0x80)
+            {
+                dst[n++]=uint8(val);
+                continue;
+            }
+            if constexpr(sizeof(T)==2)
+            {
+                if((val&0xFC00)==0xD800 && i<count && (uint32(src[i])&0xFC00)==0xDC00)
+                {
+                    val=0x10000+(((val&0x3FF)<<10)|(uint32(src[i++])&0x3FF));
+                }
+            }
+            n+=encodeUtf8(dst+n,val);
+        }
+    }
+    return rv;
+}
+
+string string::fromUnicode16(const charx *str, int size)
+{
+    return unitsToUtf8(str,size);
+}
+
+string string::fromUnicode32(const uint32 *str, int size)
+{
+    return unitsToUtf8(str,size);
+}
+
+string string::fromUnicode(const wchar_t *str, int size)
+{
+    return unitsToUtf8(str,size);
+}
+
+int string::unicodeSize() const
+{
+    const uint8 *s=(const uint8*)buffer();
+    int i=0,rv=0;
+    while(i<size())
+    {
+    #if defined(ALT_STRING_SSE2)
+        while(i+16<=size() && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s+i))))
+        {
+            i+=16;
+            rv+=16;
+        }
+        if(i>=size())break;
+    #endif
         uint32 val;
-        i+=unicode_at(i,val);
-        if(ttab_to_lower.contains(val))
-            rv.append_unicode(ttab_to_lower[val]);
-        else rv.append_unicode(val);
+        if(s[i]<0x80)i++;
+        else i+=decodeUtf8((const char*)s+i,size()-i,val);
+        rv++;
+    }
+    return rv;
+}
+
+template<typename T>
+static alt::array<T> utf8ToArray(const char *str, int size)
+{
+    alt::array<T> rv;
+    rv.resize(size+1);
+    int n=utf8ToUnits((const uint8*)str,size,rv());
+    rv.resize(n+1);
+    rv[n]=0;
+    return rv;
+}
+
+alt::array<charx> string::toUnicode16() const
+{
+    return utf8ToArray<charx>(buffer(),size());
+}
+
+alt::array<uint32> string::toUnicode32() const
+{
+    return utf8ToArray<uint32>(buffer(),size());
+}
+
+alt::array<wchar_t> string::toUnicode() const
+{
+    return utf8ToArray<wchar_t>(buffer(),size());
+}
+
+//двухуровневая таблица регистра: индекс блока на каждые 128 кодов BMP и блоки разностей,
+//нулевой блок общий для всех диапазонов без преобразований
+class caseTable
+{
+public:
+
+    explicit caseTable(bool upper)
+    {
+        const int count=sizeof(as_upper_to_lower)/(sizeof(as_upper_to_lower[0])*2);
+        const int from=upper?1:0;
+
+        ::memset(index,0,sizeof(index));
+        int blocks=1;
+        for(int i=0;i<count;i++)
+        {
+            uint32 val=as_upper_to_lower[i*2+from];
+            if(!index[val>>7])index[val>>7]=uint8(blocks++);
+        }
+        delta.resize(blocks*128);
+        delta.fill(0);
+        //при совпадении исходных кодов (обратное преобразование) действует первая пара
+        for(int i=count-1;i>=0;i--)
+        {
+            uint32 val=as_upper_to_lower[i*2+from];
+            delta[(index[val>>7]<<7)|(val&127)]=int32(as_upper_to_lower[i*2+1-from])-int32(val);
+        }
+        table=delta();
+    }
+
+    uint32 map(uint32 val) const
+    {
+        if(val>=0x10000)return val;
+        return uint32(int32(val)+table[(index[val>>7]<<7)|(val&127)]);
     }
+
+private:
+
+    uint8 index[0x10000>>7];
+    alt::array<int32> delta;
+    const int32 *table;
+};
+
+static const caseTable& lowerTable()
+{
+    static const caseTable rv(false);
+    return rv;
+}
+
+static const caseTable& upperTable()
+{
+    static const caseTable rv(true);
     return rv;
 }
 
+uint32 string::unicodeToLower(uint32 val)
+{
+    return lowerTable().map(val);
+}
+
+uint32 string::unicodeToUpper(uint32 val)
+{
+    return upperTable().map(val);
+}
+
+static string convertCase(const string &src, bool upper)
+{
+    const caseTable &tab=upper?upperTable():lowerTable();
+    const uint8 first=upper?'a':'A', last=upper?'z':'Z';
+    const uint8 *s=(const uint8*)src();
+    int size=src.size();
+
+    //длина почти всегда сохраняется, запас - под запись блоками
+    int cap=size+32;
+    string rv(cap,false);
+    uint8 *dst=(uint8*)rv();
+    int i=0,n=0;
+    while(i<size)
+    {
+    #if defined(ALT_STRING_SSE2)
+        const __m128i lo=_mm_set1_epi8(char(first-1)), hi=_mm_set1_epi8(char(last+1));
+        const __m128i flip=_mm_set1_epi8(0x20);
+        while(i+16<=size && n+16<=cap)
+        {
+            //байты старше 0x7F отрицательны и в диапазон не попадают
+            __m128i block=_mm_loadu_si128((const __m128i*)(s+i));
+            __m128i hit=_mm_and_si128(_mm_cmpgt_epi8(block,lo),_mm_cmplt_epi8(block,hi));
+            _mm_storeu_si128((__m128i*)(dst+n),_mm_xor_si128(block,_mm_and_si128(hit,flip)));
+            uint32 mask=_mm_movemask_epi8(block);
+            if(mask)
+            {
+                int k=lowBit32(mask);
+                i+=k;
+                n+=k;
+                break;
+            }
+            i+=16;
+            n+=16;
+        }
+    #elif defined(ALT_STRING_NEON)
+        const uint8x16_t lo=vdupq_n_u8(first), span=vdupq_n_u8(last-first), flip=vdupq_n_u8(0x20);
+        while(i+16<=size && n+16<=cap)
+        {
+            uint8x16_t block=vld1q_u8(s+i);
+            if(vmaxvq_u8(block)&0x80)break;
+            uint8x16_t hit=vcleq_u8(vsubq_u8(block,lo),span);
+            vst1q_u8(dst+n,veorq_u8(block,vandq_u8(hit,flip)));
+            i+=16;
+            n+=16;
+        }
+    #endif
+        int stop = i+16<size ? i+16 : size;
+        while(i<stop)
+        {
+            if(n+6>cap)
+            {
+                cap*=2;
+                rv.resize(cap);
+                dst=(uint8*)rv();
+            }
+            uint32 val=s[i];
+            if(val<0x80)
+            {
+                dst[n++]=uint8((val>=first && val<=last) ? val^0x20 : val);
+                i++;
+                continue;
+            }
+            i+=string::decodeUtf8((const char*)s+i,size-i,val);
+            n+=encodeUtf8(dst+n,tab.map(val));
+        }
+    }
+    rv.resize(n);
+    return rv;
+}
+
+string string::toLower() const
+{
+    return convertCase(*this,false);
+}
+
+string string::toUpper() const
+{
+    return convertCase(*this,true);
+}
+
 string string::trimmed()
 {
+    const char *buff=buffer();
     int i;
-    for(i=0;i<data->size;i++)
+    for(i=0;i<size();i++)
     {
-        if(!isspace(data->buff[i]))break;
+        if(!isspace(buff[i]))break;
     }
     int n;
-    for(n=data->size-1;n>=0;n--)
+    for(n=size()-1;n>=0;n--)
     {
-        if(!isspace(data->buff[n]) && data->buff[n])break;
+        if(!isspace(buff[n]) && buff[n])break;
     }
     if(n<i)return string();
     return mid(i,n-i+1);
@@ -107,15 +996,16 @@ string string::spec2space()
 
 string string::simplified()
 {
+    const char *buff=buffer();
     int i;
-    for(i=0;i<data->size;i++)
+    for(i=0;i<size();i++)
     {
-        if(!isspace(data->buff[i]))break;
+        if(!isspace(buff[i]))break;
     }
     int n;
-    for(n=data->size-1;n>=0;n--)
+    for(n=size()-1;n>=0;n--)
     {
-        if(!isspace(data->buff[n]))break;
+        if(!isspace(buff[n]))break;
     }
     if(n<=i)return string();
 
@@ -123,7 +1013,7 @@ string string::simplified()
     bool flag=false;
     for(int j=i;j<n+1;j++)
     {
-        if(isspace(data->buff[j]))
+        if(isspace(buff[j]))
         {
             if(flag)continue;
             rv.append(' ');
@@ -131,7 +1021,7 @@ string string::simplified()
             continue;
         }
         flag=false;
-        rv.append(data->buff[j]);
+        rv.append(buff[j]);
     }
     return rv;
 }
@@ -148,37 +1038,52 @@ string string::fromLatin(const char *str)
     return rv;
 }
 
-string::Internal string::empty={0,0,0,{0}};
-
 string& string::replace(const string &before, const string &after)
 {
-    string tmp;
-    tmp.reserve(data->size);
+    int len=before.size();
+    if(!len || size()<len)return *this;
 
-    for(int i=0;i<data->size;i++)
+    //before и after могут ссылаться на эту же строку
+    string pat=before, src=after;
+    const char *seek=pat.buffer(), *ins=src.buffer();
+    int nlen=src.size();
+
+    if(nlen==len)
     {
-        if(data->buff[i]==before.data->buff[0])
-        {
-            int j=1;
-            for(;j<before.data->size && i+j<data->size;j++)
-            {
-                if(before.data->buff[j]!=data->buff[j+i]) break;
-            }
-            if(j==before.data->size)
-            {
-                tmp+=after;
-                i+=before.data->size-1;
-            }
-            else
-            {
-                tmp.append(data->buff[i]);
-            }
-        }
-        else
+        //замена на месте, без выделения при отсутствии вхождений
+        if(findSubstr(buffer(),size(),seek,len)<0)return *this;
+        cloneInternal();
+        char *dst=buffer();
+        scanSubstr(dst,size(),seek,len,[&](int pos)
         {
-            tmp.append(data->buff[i]);
-        }
+            memcpy(dst+pos,ins,len);
+            return pos+len;
+        });
+        return *this;
     }
+
+    //подсчет вхождений, чтобы выделить результат один раз
+    int count=0;
+    const char *buff=buffer();
+    scanSubstr(buff,size(),seek,len,[&count,len](int pos)
+    {
+        count++;
+        return pos+len;
+    });
+    if(!count)return *this;
+
+    string tmp(size()+count*(nlen-len),false);
+    char *dst=tmp();
+    int done=0;
+    scanSubstr(buff,size(),seek,len,[&](int pos)
+    {
+        memcpy(dst,buff+done,pos-done);
+        dst+=pos-done;
+        memcpy(dst,ins,nlen);
+        dst+=nlen;
+        return done=pos+len;
+    });
+    memcpy(dst,buff+done,size()-done);
     *this=tmp;
     return *this;
 }
@@ -194,9 +1099,10 @@ string& string::replaceBack(const string &str, int pos)
     j=pos-n;
     if(j<0){i-=j;j=0;}
     if(pos>size()){n-=pos-size();pos=size();}
+    char *buff=buffer();
     for(;i<n;i++,j++)
     {
-            data->buff[j]=str.data->buff[i];
+            buff[j]=str.buffer()[i];
     }
     return *this;
 }
@@ -210,14 +1116,15 @@ string& string::reverse(int start, int end)
 
     if(start>end){start+=end;end=start-end;start-=end;}
     if(start<0)start=0;
-    if(end>data->size)end=data->size;
-    if(start>data->size || start==end || end<0)return *this;
+    if(end>size())end=size();
+    if(start>size() || start==end || end<0)return *this;
+    char *buff=buffer();
     n=(end-start)/2;
     for(i=0;i<n;i++)
     {
-            tmp=data->buff[i+start];
-            data->buff[i+start]=data->buff[end-i-1];
-            data->buff[end-i-1]=tmp;
+            tmp=buff[i+start];
+            buff[i+start]=buff[end-i-1];
+            buff[end-i-1]=tmp;
     }
     return *this;
 }
@@ -225,13 +1132,10 @@ string& string::reverse(int start, int end)
 
 string& string::replaceChar(char seek, char val)
 {
- int i;
-
+    int pos = seek==val ? -1 : indexOf(seek);
+    if(pos<0)return *this;
     cloneInternal();
-
-    for(i=0;i<data->size;i++)
-        if(data->buff[i]==seek)
-            data->buff[i]=val;
+    replaceByte(buffer()+pos,size()-pos,seek,val);
     return *this;
 }
 
@@ -239,11 +1143,12 @@ string& string::replaceGroup(char seek, char val, int len)
 {
     cloneInternal();
 
-    for(int i=0;i<data->size;i++)
+    char *buff=buffer();
+    for(int i=0;i<size();i++)
     {
-        if( ((unsigned char)data->buff[i])>=((unsigned char)seek)
-            && ((unsigned char)data->buff[i])<((unsigned char)(seek+len)))
-            data->buff[i]+=val-seek;
+        if( ((unsigned char)buff[i])>=((unsigned char)seek)
+            && ((unsigned char)buff[i])<((unsigned char)(seek+len)))
+            buff[i]+=val-seek;
     }
     return *this;
 }
@@ -254,13 +1159,13 @@ string& string::killCharAtBegining(char val)
  bool beg=true;
 
     cloneInternal();
+    char *buff=buffer();
     pnt=0;
-    for(i=0;i<data->size;i++)
+    for(i=0;i<size();i++)
     {
-       if(data->buff[i]!=val || !beg){data->buff[pnt++]=data->buff[i];beg=false;}
+       if(buff[i]!=val || !beg){buff[pnt++]=buff[i];beg=false;}
     }
-    data->size=pnt;
-    data->buff[pnt]=0;
+    setSize(pnt);
     return *this;
 }
 
@@ -271,76 +1176,46 @@ string& string::killChar(char val)
 
     cloneInternal();
 
-    for(i=0;i<data->size;i++)
+    char *buff=buffer();
+    for(i=0;i<size();i++)
     {
-            if(data->buff[i]!=val)data->buff[pnt++]=data->buff[i];
+            if(buff[i]!=val)buff[pnt++]=buff[i];
     }
-    data->size=pnt;
-    data->buff[pnt]=0;
+    setSize(pnt);
     return *this;
 }
 
-int string::indexOf(const string &val)
+int string::indexOf(const string &val, int from) const
 {
-    if(val.isEmpty() || !data || data->size<val.data->size)return -1;
-
-    char hash=0,shablon=0;
-    for(int i=0;i<val.data->size;i++)
-    {
-        hash^=data->buff[i];
-        shablon^=val.data->buff[i];
-    }
-
-    for(int i=0;i<data->size-val.size()+1;i++)
-    {
-        if(hash==shablon)
-        {
-            if(!alt::utils::memcmp(&data->buff[i],val.data->buff,val.data->size))
-            {
-                return i;
-            }
-        }
-        hash^=data->buff[i];
-        hash^=data->buff[i+val.data->size];
-    }
-    return -1;
+    if(from<0)from=0;
+    if(val.isEmpty() || from>size())return -1;
+    int rv=findSubstr(buffer()+from,size()-from,val.buffer(),val.size());
+    return rv<0 ? -1 : rv+from;
 }
 
 int string::countOf(char val)
 {
     int rv=0;
-    for(int i=0;i<data->size;i++)
-        if((char)data->buff[i]==val)rv++;
+    const char *buff=buffer();
+    for(int i=0;i<size();i++)
+        if((char)buff[i]==val)rv++;
     return rv;
 }
 
 int string::indexOf(char val, int from) const
 {
     if(from<0)from=0;
-    while(from<data->size)
-    {
-        if((char)data->buff[from]==val)return from;
-        from++;
-    }
-    return -1;
+    if(from>=size())return -1;
+    const char *buff=buffer();
+    const char *pnt=(const char*)memchr(buff+from,val,size()-from);
+    return pnt ? int(pnt-buff) : -1;
 }
 
 
-int string::findOneOfChar(int from, char *val) const
+int string::findOneOfChar(int from, const char *val) const
 {
- int j;
     if(from<0)from=0;
-    while(from<data->size)
-    {
-        j=0;
-        while(val[j])
-        {
-                if((char)data->buff[from]==val[j])return from;
-                j++;
-        }
-        from++;
-    }
-    return -1;
+    return findOneOf(buffer(),from,size(),val);
 }
 
 
@@ -348,9 +1223,10 @@ string string::cutPrefix(char sep)
 {
  string retval;
  int i;
-    for(i=0;i<data->size;i++)
+    const char *buff=buffer();
+    for(i=0;i<size();i++)
     {
-            if(data->buff[i]==sep)break;
+            if(buff[i]==sep)break;
     }
     retval=this->left(i);
     *this=this->right(i+1);
@@ -362,9 +1238,10 @@ string string::cutPrefix(const char *seps)
 {
  string retval;
  int i,j,n=alt::utils::strlen(seps);
-        for(i=0;i<data->size;i++)
+ const char *buff=buffer();
+        for(i=0;i<size();i++)
         {
-                for(j=0;j<n;j++)if(data->buff[i]==seps[j])break;
+                for(j=0;j<n;j++)if(buff[i]==seps[j])break;
                 if(j!=n)break;
         }
         retval=this->left(i);
@@ -373,28 +1250,22 @@ string string::cutPrefix(const char *seps)
 }
 
 
-int string::findString(int from, char *str) const
+int string::findString(int from, const char *str) const
 {
- int len=alt::utils::strlen(str);
-        if(from<0)from=0;
-        while(data->size>=from+len)
-        {
-                if(!alt::utils::memcmp(&data->buff[from],str,len))return from;
-                from++;
-        }
-        return -1;
+    int len=alt::utils::strlen(str);
+    if(from<0)from=0;
+    if(size()<from+len)return -1;
+    if(!len)return from;
+    int rv=findSubstr(buffer()+from,size()-from,str,len);
+    return rv<0 ? -1 : rv+from;
 }
 
 
 int string::findBackChar(int from, char val) const
 {
-        if(from>=data->size)from=data->size-1;
-        while(from>=0)
-        {
-                if(data->buff[from]==val)return from;
-                from--;
-        }
-        return from;
+    if(from>=size())from=size()-1;
+    if(from<0)return -1;
+    return findBack(buffer(),from,val);
 }
 
 
@@ -402,12 +1273,13 @@ string string::mid(int from, int size) const
 {
  string retval;
 
+    int cur=this->size();
     if(from<0){size+=from;from=0;}
-    if(from>=data->size || size<=0)return retval;
-    if(from+size>data->size)size=data->size-from;
+    if(from>=cur || size<=0)return retval;
+    if(from+size>cur)size=cur-from;
 
     retval.resize(size);
-    alt::utils::memcpy(retval.data->buff,&data->buff[from],size);
+    alt::utils::memcpy(retval.buffer(),&buffer()[from],size);
     return retval;
 }
 
@@ -415,23 +1287,26 @@ string string::mid(int from, int size) const
 
 string& string::operator+=(const string &Str)
 {
-    int nsiz=Str.data->size+data->size;;
-
-    if(!Str.data->size)return *this;
+    int cur=size(), add=Str.size();
+    if(!add)return *this;
+    int nsiz=cur+add;
 
-    if(data->alloc>=nsiz && data->refcount<2)
+    if(capacity()>=nsiz && !isShared())
     {
-        alt::utils::memcpy(&data->buff[data->size],Str.data->buff,Str.data->size);
-        data->size=nsiz;
-        data->buff[nsiz]=0;
+        alt::utils::memcpy(&buffer()[cur],Str.buffer(),add);
+        setSize(nsiz);
         return *this;
     }
 
-    Internal *tmp=newInternal(nsiz);
-    if(data->size)alt::utils::memcpy(tmp->buff,data->buff,data->size);
-    alt::utils::memcpy(&tmp->buff[data->size],Str.data->buff,Str.data->size);
-    deleteInternal();
-    data=tmp;
+    //при переносе собственный буфер освобождается раньше, чем скопирован источник
+    if(&Str==this)
+    {
+        string tmp(Str);
+        return (*this)+=tmp;
+    }
+
+    grow(nsiz);
+    alt::utils::memcpy(&buffer()[cur],Str.buffer(),add);
     return *this;
 }
 
@@ -441,36 +1316,46 @@ string& string::operator+=(const char *str)
     int size=alt::utils::strlen(str);
 
     if(!size)return *this;
-    int nsiz=size+data->size;
+    int cur=this->size();
+    int nsiz=size+cur;
 
-    if(data->alloc>=nsiz && data->refcount<2)
+    if(capacity()>=nsiz && !isShared())
     {
-        alt::utils::memcpy(&data->buff[data->size],str,size);
-        data->size=nsiz;
-        data->buff[nsiz]=0;
+        alt::utils::memcpy(&buffer()[cur],str,size);
+        setSize(nsiz);
         return *this;
     }
 
-    Internal *tmp=newInternal(nsiz);
-    if(data->size)alt::utils::memcpy(tmp->buff,data->buff,data->size);
-    alt::utils::memcpy(&tmp->buff[data->size],str,size);
-    deleteInternal();
-    data=tmp;
+    if(str>=buffer() && str<=buffer()+cur)
+    {
+        string tmp(str);
+        return (*this)+=tmp;
+    }
+
+    grow(nsiz);
+    alt::utils::memcpy(&buffer()[cur],str,size);
     return *this;
 }
 
 
 string& string::operator=(const string &Str)
 {
-    if(data==Str.data)return *this;
-    if((data->refcount<2) && (data->alloc >= Str.data->size) )
+    if(this==&Str)return *this;
+    if(Str.isLocal())
     {
-        alt::utils::memcpy(data->buff,Str.data->buff,Str.data->size+1);
-        data->size=Str.data->size;
+        release();
+        ::memcpy(local,Str.local,LOCAL_SIZE+2);
         return *this;
     }
-    deleteInternal();
-    data=Str.data;
+    if(!isLocal() && data==Str.data)return *this;
+    if(!isShared() && capacity()>=Str.size())
+    {
+        alt::utils::memcpy(buffer(),Str.buffer(),Str.size());
+        setSize(Str.size());
+        return *this;
+    }
+    release();
+    setInternal(Str.data);
     data->refcount++;
     return *this;
 }
@@ -480,29 +1365,29 @@ string& string::operator=(const char *str)
 {
     int size=alt::utils::strlen(str);
 
-    if(data->refcount<2 && data->alloc>=size)
+    if(!isShared() && capacity()>=size)
     {
-        alt::utils::memcpy(data->buff,str,size+1);
-        data->size=size;
+        alt::utils::memcpy(buffer(),str,size);
+        setSize(size);
         return *this;
     }
 
-    deleteInternal();
-    data=newInternal(size);
-    if(size)alt::utils::memcpy(data->buff,str,size);
+    release();
+    allocate(size);
+    if(size)alt::utils::memcpy(buffer(),str,size);
     return *this;
 }
 
 
 string string::operator+(const string &Str)  const
 {
-    if(!Str.data->size)return *this;
-    if(!data->size)return Str;
-    int nsiz=Str.data->size+data->size;
+    if(!Str.size())return *this;
+    if(!size())return Str;
+    int nsiz=Str.size()+size();
 
     string tmp(nsiz,false);
-    alt::utils::memcpy(tmp.data->buff,data->buff,data->size);
-    alt::utils::memcpy(&tmp.data->buff[data->size],Str.data->buff,Str.data->size);
+    alt::utils::memcpy(tmp.buffer(),buffer(),size());
+    alt::utils::memcpy(&tmp.buffer()[size()],Str.buffer(),Str.size());
     return tmp;
 }
 
@@ -511,12 +1396,13 @@ string string::operator+(const char *str) const
 {
     int size=alt::utils::strlen(str);
     if(!size)return *this;
-    if(!data->size)return string(str);
-    int nsiz=size+data->size;
+    if(!this->size())return string(str);
+    int cur=this->size();
+    int nsiz=size+cur;
 
     string tmp(nsiz,false);
-    alt::utils::memcpy(tmp.data->buff,data->buff,data->size);
-    alt::utils::memcpy(&tmp.data->buff[data->size],str,size);
+    alt::utils::memcpy(tmp.buffer(),buffer(),cur);
+    alt::utils::memcpy(&tmp.buffer()[cur],str,size);
     return tmp;
 }
 
@@ -525,17 +1411,258 @@ string& string::Fill(char sym, int from, int num)
 {
     cloneInternal();
 
-    if(data->size<from+num)resize(from+num);
+    if(size()<from+num)resize(from+num);
 
+    char *buff=buffer();
     for(int i=0;i<num;i++)
     {
-        data->buff[i+from]=sym;
+        buff[i+from]=sym;
     }
     globCorrection();
 
     return *this;
 }
 
+//////////////////////////////////////////////////////////////////////////
+//преобразования чисел
+
+//старшая степень десяти, точно представимая в R: 10^k точна, пока 5^k помещается в мантиссу
+template <class R>
+static constexpr int exactPow10()
+{
+    int digits = std::numeric_limits<R>::digits<63 ? std::numeric_limits<R>::digits : 63;
+    int rv=0;
+    for(uint64 p=5;rv<27 && p<(uint64(1)<<digits);p*=5)rv++;
+    return rv;
+}
+
+//предел мантиссы, которая переводится в R без округления
+template <class R>
+static constexpr uint64 exactMantissa()
+{
+    return uint64(1)<<(std::numeric_limits<R>::digits<63 ? std::numeric_limits<R>::digits : 63);
+}
+
+template <class R>
+static __inline R pow10Of(int exp)
+{
+    static const R table[28] = {1e0L,1e1L,1e2L,1e3L,1e4L,1e5L,1e6L,1e7L,1e8L,1e9L,1e10L,1e11L,1e12L,1e13L,
+                                1e14L,1e15L,1e16L,1e17L,1e18L,1e19L,1e20L,1e21L,1e22L,1e23L,1e24L,1e25L,1e26L,1e27L};
+    return table[exp];
+}
+
+#ifndef __cpp_lib_to_chars
+static void strToReal(const char *str, real32 &val){val=strtof(str,nullptr);}
+static void strToReal(const char *str, real64 &val){val=strtod(str,nullptr);}
+static void strToReal(const char *str, long double &val){val=strtold(str,nullptr);}
+#endif
+
+//точное преобразование библиотекой, знак уже отброшен
+template <class R>
+static void parseRealSlow(const char *str, int size, R &val, bool huge)
+{
+#ifdef __cpp_lib_to_chars
+    //вне диапазона from_chars значение не трогает, strtod дает бесконечность или ноль
+    if(std::from_chars(str,str+size,val).ec==std::errc::result_out_of_range)
+        val = huge ? std::numeric_limits<R>::infinity() : R(0);
+#else
+    //strtod зависит от локали: подставляем ее десятичный разделитель
+    string tmp=string::fromFix(str,size);
+    const char *point=localeconv()->decimal_point;
+    if(point && point[0]!='.')tmp.replaceChar('.',point[0]);
+    strToReal(tmp(),val);
+#endif
+}
+
+static bool matchWord(const char *str, int size, const char *word)
+{
+    int len=alt::utils::strlen(word);
+    if(size<len)return false;
+    for(int i=0;i<len;i++)
+    {
+        if((str[i]|0x20)!=word[i])return false;
+    }
+    return true;
+}
+
+//мантисса до 19 цифр и порядок; если точности типа хватает - две операции, иначе from_chars/strtod
+template <class R>
+static bool parseRealImpl(const char *str, int size, R &val)
+{
+    val=0;
+    int end=size;
+    int i=string::trimField(str,0,end);
+    if(i==end)return false;
+
+    bool neg=false;
+    if(str[i]=='-' || str[i]=='+')
+    {
+        neg = str[i]=='-';
+        i++;
+    }
+    const int start=i;
+
+    uint64 mant=0, block;
+    int digits=0, exp10=0;
+    bool any=false, truncated=false;
+
+    while(i<end && str[i]=='0'){i++;any=true;}
+    while(end-i>=8 && digits<=11 && string::parseEightDigits(str+i,block))
+    {
+        mant=mant*100000000+block;
+        digits+=8;
+        i+=8;
+        any=true;
+    }
+    for(;i<end;i++)
+    {
+        uint8 d=uint8(str[i]-'0');
+        if(d>9)break;
+        any=true;
+        if(digits<19)
+        {
+            mant=mant*10+d;
+            if(mant)digits++;
+        }
+        else
+        {
+            exp10++;
+            if(d)truncated=true;
+        }
+    }
+    if(i<end && str[i]=='.')
+    {
+        i++;
+        if(!mant)
+        {
+            while(i<end && str[i]=='0'){i++;exp10--;any=true;}
+        }
+        while(end-i>=8 && digits<=11 && string::parseEightDigits(str+i,block))
+        {
+            mant=mant*100000000+block;
+            digits+=8;
+            exp10-=8;
+            i+=8;
+            any=true;
+        }
+        for(;i<end;i++)
+        {
+            uint8 d=uint8(str[i]-'0');
+            if(d>9)break;
+            any=true;
+            if(digits<19)
+            {
+                mant=mant*10+d;
+                digits++;
+                exp10--;
+            }
+            else if(d)truncated=true;
+        }
+    }
+
+    if(!any)
+    {
+        int len=end-start;
+        if(matchWord(str+start,len,"infinity"))i=start+8;
+        else if(matchWord(str+start,len,"inf"))i=start+3;
+        else if(matchWord(str+start,len,"nan"))i=start+3;
+        else return false;
+        val = str[start+2]=='n' || str[start+2]=='N' ? std::numeric_limits<R>::quiet_NaN()
+                                                      : std::numeric_limits<R>::infinity();
+        if(neg)val=-val;
+        return i==end;
+    }
+
+    if(i<end && (str[i]|0x20)=='e')
+    {
+        int j=i+1;
+        bool eneg=false;
+        if(j<end && (str[j]=='-' || str[j]=='+'))
+        {
+            eneg = str[j]=='-';
+            j++;
+        }
+        if(j<end && uint8(str[j]-'0')<10)
+        {
+            int e=0;
+            for(;j<end && uint8(str[j]-'0')<10;j++)
+            {
+                if(e<100000)e=e*10+(str[j]-'0');
+            }
+            exp10 += eneg ? -e : e;
+            i=j;
+        }
+    }
+    const bool ok = i==end;
+
+    if(!mant)
+    {
+        val = neg ? -R(0) : R(0);
+        return ok;
+    }
+
+    constexpr int exact=exactPow10<R>();
+    constexpr uint64 limit=exactMantissa<R>();
+    if(!truncated && mant<=limit)
+    {
+        bool done=true;
+        if(exp10>=0 && exp10<=exact)val=R(mant)*pow10Of<R>(exp10);
+        else if(exp10<0 && -exp10<=exact)val=R(mant)/pow10Of<R>(-exp10);
+        else if(exp10>exact)
+        {
+            //часть порядка может уйти в мантиссу без потери точности
+            while(exp10>exact && mant<=limit/10)
+            {
+                mant*=10;
+                exp10--;
+            }
+            done = exp10<=exact;
+            if(done)val=R(mant)*pow10Of<R>(exp10);
+        }
+        else done=false;
+        if(done)
+        {
+            if(neg)val=-val;
+            return ok;
+        }
+    }
+
+    parseRealSlow(str+start,i-start,val,exp10>0);
+    if(neg)val=-val;
+    return ok;
+}
+
+bool string::parseReal(const char *str, int size, real32 &val)
+{
+    return parseRealImpl(str,size,val);
+}
+
+bool string::parseReal(const char *str, int size, real64 &val)
+{
+    return parseRealImpl(str,size,val);
+}
+
+bool string::parseReal(const char *str, int size, long double &val)
+{
+    return parseRealImpl(str,size,val);
+}
+
+string string::fromReal(real val)
+{
+    char buff[32];
+    char *end=fmt::format_to(buff,"{}",val);
+    return fromFix(buff,int(end-buff));
+}
+
+string string::fromReal(real val, int prec)
+{
+    if(prec<0)prec=6;
+    else if(prec>40)prec=40;
+    char buff[64];
+    char *end=fmt::format_to(buff,"{:.{}g}",val,prec);
+    return fromFix(buff,int(end-buff));
+}
+
 string string::print(const char *format, ... )
 {
     va_list argptr;
@@ -548,26 +1675,13 @@ string string::print(const char *format, ... )
 
     rv.resize(cnt);
     va_start(argptr, format);
-    rv.data->size=vsnprintf(rv(), rv.Allocated(), format, argptr);
+    //в буфере есть место и для завершающего нуля
+    rv.setSize(vsnprintf(rv(), rv.Allocated()+1, format, argptr));
     va_end(argptr);
 
     return rv;
 }
 
-string string::fromUnicode(const wchar_t *str, int size)
-{
-    string rv;
-    while(size && (*str))
-    {
-        if(sizeof(wchar_t)<sizeof(uint32))
-            rv.append_unicode(((uint32)(*str))& ((((uint32)1)<<(sizeof(wchar_t)*8))-1) );
-        else rv.append_unicode(*str);
-        str++;
-        if(size>0)size--;
-    }
-    return rv;
-}
-
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -30,6 +30,9 @@ SOFTWARE.
 #include "atypes.h"
 #include "at_array.h"
 #include "at_hash.h"
+#include <string.h>
+#include <limits>
+#include <type_traits>
 
 #ifdef QT_CORE_LIB
     #include <QtCore>
@@ -49,7 +52,17 @@ namespace alt {
             char buff[1]; //буффер строки
         };
 
-        Internal *data;
+        //короткая строка (до LOCAL_SIZE символов) хранится прямо в объекте без выделения памяти,
+        //длинная - в общем блоке Internal с копированием при записи
+        static const int LOCAL_SIZE = 22;
+        static const uint8 LOCAL_FLAG = 0x80;
+
+        union
+        {
+            Internal *data;
+            char local[LOCAL_SIZE+2]; //символы, завершающий ноль; последний байт - флаг и длина
+        };
+
         Internal* newInternal(int size)
         {
             Internal *rv;
@@ -62,24 +75,107 @@ namespace alt {
             return rv;
         }
 
-        void deleteInternal()
+        static void deleteInternal(Internal *val)
         {
-            data->refcount--;
-            if(data==&empty)return;
-            if( !data->refcount )
-                delete []((char*)data);
+            val->refcount--;
+            if( !val->refcount )
+                delete []((char*)val);
         }
 
-        void cloneInternal()
+        bool isLocal() const
+        {
+            return uint8(local[LOCAL_SIZE+1])&LOCAL_FLAG;
+        }
+        bool isShared() const
+        {
+            return !isLocal() && data->refcount>1;
+        }
+        int capacity() const
+        {
+            return isLocal() ? LOCAL_SIZE : data->alloc;
+        }
+
+        //буфер без отделения от других владельцев - только для чтения или после cloneInternal()
+        const char* buffer() const
+        {
+            return isLocal() ? local : data->buff;
+        }
+        char* buffer()
+        {
+            return isLocal() ? local : data->buff;
+        }
+
+        void setLocal(int size)
+        {
+            local[size]=0;
+            local[LOCAL_SIZE+1]=char(LOCAL_FLAG|size);
+        }
+        void setInternal(Internal *val)
+        {
+            data=val;
+            local[LOCAL_SIZE+1]=0;
+        }
+
+        //новое содержимое размера size, символы не заполнены
+        void allocate(int size)
+        {
+            if(size<=LOCAL_SIZE)setLocal(size);
+            else setInternal(newInternal(size));
+        }
+
+        void release()
+        {
+            if(!isLocal())deleteInternal(data);
+        }
+
+        //новый размер при единоличном владении и достаточном объеме
+        void setSize(int size)
         {
-            if( data!=(&empty) && data->refcount<2)return;
-            Internal *tmp=newInternal(data->size);
-            if(data->size)alt::utils::memcpy(tmp->buff,data->buff,data->size);
-            deleteInternal();
-            data=tmp;
+            if(isLocal())setLocal(size);
+            else
+            {
+                data->size=size;
+                data->buff[size]=0;
+            }
+        }
+
+        //перенести содержимое в собственный буфер размера size (лишнее отбрасывается)
+        void grow(int size)
+        {
+            int cur=this->size();
+            if(cur>size)cur=size;
+            if(isLocal())
+            {
+                if(size<=LOCAL_SIZE)
+                {
+                    setLocal(size);
+                    return;
+                }
+                Internal *tmp=newInternal(size);
+                ::memcpy(tmp->buff,local,cur);
+                setInternal(tmp);
+                return;
+            }
+            Internal *old=data;
+            if(size<=LOCAL_SIZE)
+            {
+                ::memcpy(local,old->buff,cur);
+                setLocal(size);
+            }
+            else
+            {
+                Internal *tmp=newInternal(size);
+                ::memcpy(tmp->buff,old->buff,cur);
+                setInternal(tmp);
+            }
+            deleteInternal(old);
         }
 
-        static Internal empty;
+        void cloneInternal()
+        {
+            if(!isShared())return;
+            grow(data->size);
+        }
 
     public:
 
@@ -88,8 +184,8 @@ namespace alt {
         {
             QByteArray tmp=str.toUtf8();
             int size=alt::utils::strlen(tmp.data());
-            data=newInternal(size);
-            if(size)alt::utils::memcpy(data->buff,tmp.data(),size);
+            allocate(size);
+            if(size)alt::utils::memcpy(buffer(),tmp.data(),size);
         }
         string& operator=(const QString &str)
         {
@@ -98,121 +194,112 @@ namespace alt {
         }
         operator QString() const
         {
-            return QString::fromUtf8(data->buff);
+            return QString::fromUtf8(buffer());
         }
 
     #endif
 
         string()
         {
-            data=&empty;
-            data->buff[0]=0;
-            data->size=0;
-            data->alloc=0;
-            data->refcount++;
+            setLocal(0);
         }
 
         string(const string &Str)
         {
+            if(Str.isLocal())
+            {
+                //блок фиксированного размера без перекрытия, флаг копируется всегда
+                ::memcpy(local,Str.local,LOCAL_SIZE+2);
+                return;
+            }
             //добвляем референс
-            data=Str.data;
+            setInternal(Str.data);
             data->refcount++;
         }
 
         string(const char *str)
         {
             int size=alt::utils::strlen(str);
-            data=newInternal(size);
-            if(size)alt::utils::memcpy(data->buff,str,size);
+            allocate(size);
+            if(size)alt::utils::memcpy(buffer(),str,size);
         }
 
         explicit string(int size, bool makeEmpty)
         {
-            data=newInternal(size);
-            if(makeEmpty)
-            {
-                data->buff[0]=0;
-                data->size=0;
-            }
+            allocate(size);
+            if(makeEmpty)setSize(0);
         }
 
         void deepCopy(const string &Str)
         {
-            *this = string(Str.data->buff);
+            *this = string(Str.buffer());
         }
 
         ~string()
         {
-            deleteInternal();
+            release();
         }
 
         string& clear()
         {
-            if(!data->size)return *this;
-            cloneInternal();
-            data->size=0;
-            data->buff[0]=0;
+            if(!size())return *this;
+            if(isShared())
+            {
+                release();
+                setLocal(0);
+                return *this;
+            }
+            setSize(0);
             return *this;
         }
 
         string& globCorrection()
         {
             //фиксим размер
-            int size=alt::utils::strlen(data->buff);
-            if(size>data->size)size=data->size;
-            data->size=size;
-            data->buff[size]=0;
+            int size=alt::utils::strlen(buffer());
+            if(size>this->size())size=this->size();
+            setSize(size);
             return *this;
         }
 
         string& resize(int size)
         {
-            if(data->size==size)return *this;
+            if(this->size()==size)return *this;
 
-            if(data->alloc<size)
+            if(capacity()<size || isShared())
             {
-                Internal *tmp=newInternal(size);
-                alt::utils::memcpy(tmp->buff,data->buff,data->size);
-                deleteInternal();
-                data=tmp;
+                grow(size);
                 return *this;
             }
 
-            cloneInternal();
-            data->size=size;
-            data->buff[size]=0;
+            setSize(size);
             return *this;
         }
 
         string& reserve(int size)
         {
-            if(data->size>=size)return *this;
-            Internal *tmp=newInternal(size);
-            alt::utils::memcpy(tmp->buff,data->buff,data->size+1);
-            tmp->size=data->size;
-            deleteInternal();
-            data=tmp;
+            if(capacity()>=size && !isShared())return *this;
+            int cur=this->size();
+            grow(size>cur ? size : cur);
+            setSize(cur);
             return *this;
         }
 
         string& append(char val)
         {
             if(!val)return *this;
-            int nsiz=data->size+1;
+            int cur=size();
 
-            if(data->alloc>=nsiz && data->refcount<2)
+            if(capacity()>cur && !isShared())
             {
-                data->buff[data->size]=val;
-                data->size=nsiz;
-                data->buff[nsiz]=0;
+                char *buff=buffer();
+                buff[cur]=val;
+                setSize(cur+1);
                 return *this;
             }
 
-            Internal *tmp=newInternal(nsiz);
-            if(data->size)alt::utils::memcpy(tmp->buff,data->buff,data->size);
-            tmp->buff[data->size]=val;
-            deleteInternal();
-            data=tmp;
+            grow(cur+1);
+            buffer()[cur]=val;
             return *this;
         }
 
@@ -225,15 +312,16 @@ namespace alt {
         string& operator=(const char *str);
 
         friend string operator+(const char *str, const string &Str);
+        friend class stringBuilder;
 
         string operator+(const string &Str) const;
         string operator+(const char *str) const;
 
         bool operator==(const string &Str) const
         {
-            if(data->size!=Str.data->size)return false;
-            if(data->size==0)return true;
-            if(!alt::utils::memcmp(data->buff,Str.data->buff,data->size))return true;
+            if(size()!=Str.size())return false;
+            if(size()==0)return true;
+            if(!alt::utils::memcmp(buffer(),Str.buffer(),size()))return true;
             return false;
         }
         bool operator!=(const string &Str) const
@@ -243,12 +331,12 @@ namespace alt {
 
         bool operator<(const string &Str) const
         {
-            if(alt::utils::strcmp((unsigned char*)data->buff,(unsigned char*)Str.data->buff)<0)return true;
+            if(alt::utils::strcmp((unsigned char*)buffer(),(unsigned char*)Str.buffer())<0)return true;
             return false;
         }
         bool operator<=(const string &Str) const
         {
-            if(alt::utils::strcmp((unsigned char*)data->buff,(unsigned char*)Str.data->buff)<=0)return true;
+            if(alt::utils::strcmp((unsigned char*)buffer(),(unsigned char*)Str.buffer())<=0)return true;
             return false;
         }
 
@@ -264,38 +352,39 @@ namespace alt {
         //получить ссылку на буфер
         const char* operator()() const
         {
-            return data->buff;
+            return buffer();
         }
         char* operator()()
         {
             cloneInternal();
-            return data->buff;
+            return buffer();
         }
 
         //работа с символами
         char& operator[](int ind)
         {
             cloneInternal();
-            return data->buff[ind];
+            return buffer()[ind];
         }
         char operator[](int ind) const
         {
-            return data->buff[ind];
+            return buffer()[ind];
         }
 
         bool isEmpty() const       //проверка на пустоту
         {
-            return !data->size;
+            return !size();
         }
 
         bool isCppName() const
         {
             if(isEmpty())return false;
-            for(int j=0;j<data->size;j++)
+            const char *buff=buffer();
+            for(int j=0;j<size();j++)
             {
-                if((data->buff[j]>='a' && data->buff[j]<='z') || (data->buff[j]>='A' && data->buff[j]<='Z') || data->buff[j]=='_')
+                if((buff[j]>='a' && buff[j]<='z') || (buff[j]>='A' && buff[j]<='Z') || buff[j]=='_')
                     continue;
-                if(j && (data->buff[j]>='0' && data->buff[j]<='9'))
+                if(j && (buff[j]>='0' && buff[j]<='9'))
                     continue;
 
                 return false;
@@ -304,43 +393,46 @@ namespace alt {
         }
 
         int size() const
-                { return data->size; }
+                { return isLocal() ? (uint8(local[LOCAL_SIZE+1])&~LOCAL_FLAG) : data->size; }
         int Allocated() const      //размер выделенной памяти
-                { return data->alloc; }
+                { return capacity(); }
 
         string trimmed();
         string simplified();
         string spec2space();
 
-        bool contains(char val)
+        bool contains(char val) const
         {
             if(indexOf(val)>=0)return true;
             return false;
         }
-        bool contains(const string &val)
+        bool contains(const string &val) const
         {
             if(indexOf(val)>=0)return true;
             return false;
         }
 
-        int indexOf(const string &val);
+        int indexOf(const string &val, int from=0) const;
         int indexOf(char val, int from=0) const; //-1 if not find
         int countOf(char val);
-        int findOneOfChar(int from, char *val) const;
-        int findString(int from, char *str) const;
+        int findOneOfChar(int from, const char *val) const;
+        int findString(int from, const char *str) const;
         int findBackChar(int from, char val) const;
         int findBackChar(char val) const {return findBackChar(size()-1,val);}
 
         string left(int size) const
             {return mid(0,size);}
         string right(int from) const
-            {return mid(from,data->size-from);}
+            {return mid(from,size()-from);}
         string mid(int from, int size) const;
 
         string cutPrefix(char sep);
         string cutPrefix(const char *seps);
 
+        //все вхождения за один проход, результат выделяется один раз
         string& replace(const string &before, const string &after);
+        string& replaceAll(const string &before, const string &after)
+            {return replace(before,after);}
 
         string& replaceBack(const string &str, int pos);
         string& replaceChar(char seek, char val);
@@ -350,8 +442,8 @@ namespace alt {
 
         //разворот строки посимвольно
         string& reverse(int start, int end);
-        string& reverse(){return reverse(0,data->size);}
-        string& reverseSuffix(int start){return reverse(start,data->size);}
+        string& reverse(){return reverse(0,size());}
+        string& reverseSuffix(int start){return reverse(start,size());}
         string& reversePrefix(int end){return reverse(0,end);}
 
         string& Fill(char sym, int from, int num);
@@ -364,34 +456,14 @@ namespace alt {
         }
 
         /////////////////////////////////////////////////////////
+        //декодирование одного символа UTF-8 из буфера длины left (left>0);
+        //некорректный байт дает 0xFFFD, возвращается число прочитанных байт
+        static int decodeUtf8(const char *str, int left, uint32 &val);
+
         int unicode_at(int posit, uint32 &val) const
         {
             if(size()<=posit)return 0;
-
-            if(!(data->buff[posit]&0x80))
-            {
-                val=data->buff[posit];
-                return 1;
-            }
-            val=0xFFFD;
-            if((data->buff[posit]&0xC0)==0x80)return 1;
-
-            const static int mask[]={0xC0,0xE0,0xF0,0xF8,0xFC,0xFE};
-            for(int k=0;k<5;k++)
-            {
-                if((data->buff[posit]&mask[k+1])!=mask[k])continue;
-                if(size()<=posit+k+1)return 1;
-                uint32 tmp=((data->buff[posit]&(~mask[k+1]))&0xff)<<((k+1)*6);
-                for(int i=0;i<=k;i++)
-                {
-                    if((data->buff[posit+i+1]&0xC0)!=0x80)return 1;
-                    if(i==k) tmp|=data->buff[posit+i+1]&0x3f;
-                    else tmp|=(data->buff[posit+i+1]&0x3f)<<((k-i)*6);
-                }
-                val=tmp;
-                return k+2;
-            }
-            return 1;
+            return decodeUtf8(buffer()+posit,size()-posit,val);
         }
 
         string& append_unicode(uint32 val)
@@ -440,137 +512,117 @@ namespace alt {
             return *this;
         }
 
-        static string fromUTF16(uint16 *str)
-        {
-            string rv;
-            while(*str)
-            {
-                rv.append_unicode(*str);
-                str++;
-            }
-            return rv;
-        }
-
-        static string fromUnicode16(charx *str, int size=-1)
+        //проверка на корректный UTF-8 (RFC 3629: без избыточных форм, суррогатов и кодов выше 0x10FFFF)
+        static bool isValidUtf8(const char *str, int size);
+        bool isValidUtf8() const
         {
-            string rv;
-            while(size && (*str))
-            {
-                rv.append_unicode(*str);
-                str++;
-                if(size>0)size--;
-            }
-            return rv;
+            return isValidUtf8(buffer(),size());
         }
 
+        //перекодировка до первого нулевого символа или size символов;
+        //суррогатные пары UTF-16 объединяются в один символ
+        static string fromUnicode16(const charx *str, int size=-1);
+        static string fromUnicode32(const uint32 *str, int size=-1);
         static string fromUnicode(const wchar_t *str, int size=-1);
-
-        int unicodeSize() const
+        static string fromUTF16(const uint16 *str)
         {
-            int k,index=0;
-            uint32 val;
-            int rv=0;
-            while((k=unicode_at(index,val))!=0)
-            {
-                rv++;
-                index+=k;
-            }
-            return rv;
+            return fromUnicode16(str);
         }
 
-        alt::array<charx> toUnicode16() const
-        {
-            int k,index=0;
-            uint32 val;
-            alt::array<charx> rv;
-            while((k=unicode_at(index,val))!=0)
-            {
-                rv.append(val);
-                index+=k;
-            }
-            rv.append(0);
-            return rv;
-        }
+        int unicodeSize() const;
 
-        alt::array<wchar_t> toUnicode() const
-        {
-            int k,index=0;
-            uint32 val;
-            alt::array<wchar_t> rv;
-            while((k=unicode_at(index,val))!=0)
-            {
-                rv.append(val);
-                index+=k;
-            }
-            rv.append(0);
-            return rv;
-        }
+        //результат завершается нулем; символы вне BMP в UTF-16 - суррогатными парами
+        alt::array<charx> toUnicode16() const;
+        alt::array<uint32> toUnicode32() const;
+        alt::array<wchar_t> toUnicode() const;
 
+        //преобразование регистра по двухуровневой таблице (только BMP)
+        static uint32 unicodeToLower(uint32 val);
+        static uint32 unicodeToUpper(uint32 val);
         string toLower() const;
+        string toUpper() const;
         static string fromLatin(const char *str);
 
         /////////////////////////////////////////////////////////
         char at(int index) const
         {
             if(size()<=index)return 0;
-            return data->buff[index];
+            return buffer()[index];
         }
         char last() const
         {
             if(!size())return 0;
-            return data->buff[data->size-1];
+            return buffer()[size()-1];
         }
 
         static string print(const char *format, ... );
 
         template <class I> bool tryInt(I &val) const
         {
-            bool ok=false;
-            if(at(0)=='#')
-            {
-                val=right(1).toInt<I>(16,&ok);
-                return ok;
-            }
-            else if(last()=='h' || last()=='H')
-            {
-                val=left(size()-1).toInt<I>(16,&ok);
-                return ok;
-            }
-            else if(at(0)=='0' && (at(1)=='x' || at(1)=='X'))
-            {
-                val=right(2).toInt<I>(16,&ok);
-                return ok;
-            }
-            else if(last()=='b' || last()=='B')
-            {
-                val=left(size()-1).toInt<I>(2,&ok);
-                return ok;
-            }
-            else if(at(0)=='0' && (at(1)=='b' || at(1)=='B'))
-            {
-                val=right(2).toInt<I>(2,&ok);
-                return ok;
-            }
-            val=toInt<I>(10,&ok);
-            return ok;
+            return parseIntLiteral(buffer(),size(),val);
         }
 
         template <class I>
         static array<I> toIntegerList(const array<string> &list, bool *ok = nullptr)
         {
             array<I> rv;
-            if(ok)
-                *ok = true;
+            rv.resize(list.size());
+            bool good=true;
             for(int i=0;i<list.size();i++)
             {
+                if(!parseIntLiteral(list[i].buffer(),list[i].size(),rv[i]))
+                    good = false;
+            }
+            if(ok)
+                *ok = good;
+            return rv;
+        }
+
+        //разбор списка прямо из текста, без промежуточных строк; пробелы вокруг значений допустимы
+        template <class I>
+        static array<I> toIntegerList(const string &text, char sep, bool *ok = nullptr)
+        {
+            array<I> rv;
+            bool good=true;
+            const char *buff=text.buffer();
+            int from=0;
+            for(;;)
+            {
+                int to=text.indexOf(sep,from);
+                int end = to<0 ? text.size() : to;
+                int beg = trimField(buff,from,end);
                 I val = 0;
-                if(!list[i].tryInt(val))
-                {
-                    if(ok)
-                        *ok = false;
-                }
+                if(!parseIntLiteral(buff+beg,end-beg,val))
+                    good = false;
+                rv.append(val);
+                if(to<0)break;
+                from=to+1;
+            }
+            if(ok)
+                *ok = good;
+            return rv;
+        }
+
+        template <class R>
+        static array<R> toRealList(const string &text, char sep, bool *ok = nullptr)
+        {
+            array<R> rv;
+            bool good=true;
+            const char *buff=text.buffer();
+            int from=0;
+            for(;;)
+            {
+                int to=text.indexOf(sep,from);
+                int end = to<0 ? text.size() : to;
+                R val = 0;
+                if(!parseReal(buff+from,end-from,val))
+                    good = false;
                 rv.append(val);
+                if(to<0)break;
+                from=to+1;
             }
+            if(ok)
+                *ok = good;
             return rv;
         }
 
@@ -587,160 +639,272 @@ namespace alt {
 
         template <class I> I toInt(int base=10, bool *ok = nullptr) const
         {
-            I rv=0;
-            bool neg=false;
-            if(ok)*ok=false;
+            I rv;
+            bool good=parseInt(buffer(),size(),rv,base);
+            if(ok)*ok=good;
+            return rv;
+        }
+
+        //разбор с экспонентой, inf и nan; при ошибке возвращается разобранная часть
+        template <class R>
+        R toReal(bool *ok = nullptr) const
+        {
+            R rv;
+            bool good=parseReal(buffer(),size(),rv);
+            if(ok)*ok=good;
+            return rv;
+        }
 
-            if(base<2)return 0;
-            if(base>36)return 0;
+        //границы поля без пробелов по краям: возвращает начало, end сдвигается к концу значения
+        static __inline int trimField(const char *buff, int from, int &end)
+        {
+            while(from<end && (buff[from]==' ' || buff[from]=='\t' || buff[from]=='\r' || buff[from]=='\n'))from++;
+            while(end>from && (buff[end-1]==' ' || buff[end-1]=='\t' || buff[end-1]=='\r' || buff[end-1]=='\n'))end--;
+            return from;
+        }
 
-            if(!data || !data->size)return 0;
-            for(int i=0;i<data->size;i++)
+        //значение символа как цифры, 255 если это не цифра
+        static __inline uint8 digitValue(char val)
+        {
+            static const uint8 table[256] =
             {
-                if(data->buff[i]>='0' && data->buff[i]<='9')
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                0,1,2,3,4,5,6,7,8,9,255,255,255,255,255,255,
+                255,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,
+                25,26,27,28,29,30,31,32,33,34,35,255,255,255,255,255,
+                255,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,
+                25,26,27,28,29,30,31,32,33,34,35,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+                255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+            };
+            return table[uint8(val)];
+        }
+
+        //восемь десятичных цифр за раз (little-endian)
+        static __inline bool parseEightDigits(const char *str, uint64 &val)
+        {
+            uint64 x;
+            ::memcpy(&x,str,8);
+            if(((x & 0xF0F0F0F0F0F0F0F0ull) | (((x + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+                    != 0x3333333333333333ull)return false;
+            x -= 0x3030303030303030ull;
+            x = x*10 + (x>>8);
+            val = (((x & 0x000000FF000000FFull) * (100 + (1000000ull<<32)))
+                   + (((x>>16) & 0x000000FF000000FFull) * (1 + (10000ull<<32)))) >> 32;
+            return true;
+        }
+
+        //разбор целого со знаком; true только если фрагмент целиком число и нет переполнения,
+        //при переполнении значение насыщается; основания 2, 8, 16 без минуса читаются как
+        //битовый шаблон во всю ширину типа ("FFFFFFFF" в int - это -1)
+        template <class I>
+        static bool parseInt(const char *str, int size, I &val, int base=10)
+        {
+            typedef typename std::make_unsigned<I>::type U;
+
+            val=0;
+            if(base<2 || base>36 || size<=0)return false;
+
+            int i=0;
+            bool neg=false;
+            if(str[0]=='-' || str[0]=='+')
+            {
+                neg = str[0]=='-';
+                i++;
+            }
+            const int from=i;
+            const bool pattern = !neg && (base==2 || base==8 || base==16);
+            const U lim = std::is_signed<I>::value && !pattern ? U(std::numeric_limits<I>::max())+U(neg)
+                                                               : std::numeric_limits<U>::max();
+            U acc=0;
+            bool over=false;
+
+            if(base==10 && sizeof(U)>=4)
+            {
+                uint64 block;
+                while(size-i>=8 && parseEightDigits(str+i,block))
                 {
-                    rv*=base;
-                    int inc=data->buff[i]-'0';
-                    if(inc>=base)
+                    if(acc>(lim-U(block))/U(100000000))
                     {
-                        if(neg)return -rv;
-                        return rv;
+                        over=true;
+                        break;
                     }
-                    rv+=inc;
+                    acc=acc*U(100000000)+U(block);
+                    i+=8;
                 }
-                else if(data->buff[i]>='a' && data->buff[i]<='z')
+            }
+            if(!over && !(base&(base-1)))
+            {
+                //двоичные основания - сдвигом, переполнение по выдвинутым битам
+                int shift=0;
+                while((1<<shift)<base)shift++;
+                const int top=int(sizeof(U))*8-shift;
+                for(;i<size;i++)
                 {
-                    rv*=base;
-                    int inc=data->buff[i]-'a'+10;
-                    if(inc>=base)
+                    uint8 d=digitValue(str[i]);
+                    if(d>=base)break;
+                    U next=U(acc<<shift)|U(d);
+                    if((acc>>top) || next>lim)
                     {
-                        if(neg)return -rv;
-                        return rv;
+                        over=true;
+                        break;
                     }
-                    rv+=inc;
+                    acc=next;
                 }
-                else if(data->buff[i]>='A' && data->buff[i]<='Z')
+            }
+            else if(!over)
+            {
+                //для основания 10 деление на константу сводится к умножению
+                const U cut = base==10 ? lim/U(10) : lim/U(base);
+                const uint8 cutDigit = uint8(lim-cut*U(base));
+                for(;i<size;i++)
                 {
-                    rv*=base;
-                    int inc=data->buff[i]-'A'+10;
-                    if(inc>=base)
+                    uint8 d=digitValue(str[i]);
+                    if(d>=base)break;
+                    if(acc>cut || (acc==cut && d>cutDigit))
                     {
-                        if(neg)return -rv;
-                        return rv;
+                        over=true;
+                        break;
                     }
-                    rv+=inc;
-                }
-                else if(data->buff[i]=='-' && !i)
-                {
-                    neg=true;
-                }
-                else if(data->buff[i]=='+' && !i)
-                {
-                    continue;
-                }
-                else
-                {
-                    if(neg)return -rv;
-                    return rv;
+                    acc=acc*U(base)+U(d);
                 }
             }
+            if(over)acc=lim;
 
-            if(ok)*ok=true;
-            if(neg)return -rv;
-            return rv;
+            val = neg ? I(U(0)-acc) : I(acc);
+            return !over && i==size && i>from;
         }
 
-        template <class R>
-        R toReal() //todo: сделать поддержку расширенных форм
+        //целое с указанием основания: #FF, FFh, 0xFF, 101b, 0b101 или десятичное
+        template <class I>
+        static bool parseIntLiteral(const char *str, int size, I &val)
         {
-            R rv=0.0, div=1.0;
-            bool neg=false;
-            bool afterpoint=false;
+            char last = size ? str[size-1] : 0;
+            if(size && str[0]=='#')
+                return parseInt(str+1,size-1,val,16);
+            if(last=='h' || last=='H')
+                return parseInt(str,size-1,val,16);
+            if(size>1 && str[0]=='0' && (str[1]=='x' || str[1]=='X'))
+                return parseInt(str+2,size-2,val,16);
+            if(last=='b' || last=='B')
+                return parseInt(str,size-1,val,2);
+            if(size>1 && str[0]=='0' && (str[1]=='b' || str[1]=='B'))
+                return parseInt(str+2,size-2,val,2);
+            return parseInt(str,size,val,10);
+        }
+
+        static bool parseReal(const char *str, int size, real32 &val);
+        static bool parseReal(const char *str, int size, real64 &val);
+        static bool parseReal(const char *str, int size, long double &val);
+
+        ///////////////////////////////////////////////////////////////////////////
+
+        //кратчайшее представление, которое читается обратно в то же значение
+        static string fromReal(real val);
+        //prec значащих цифр, как у %g
+        static string fromReal(real val, int prec);
 
-            if(!data)return 0.0;
-            for(int i=0;i<data->size;i++)
+        //запись целого с конца буфера end, возвращает начало; буфера в sizeof(I)*8+1 байт хватает всегда
+        template <class I>
+        static char* formatInt(char *end, I val, int base=10, bool upcase=true)
+        {
+            typedef typename std::make_unsigned<I>::type U;
+            static const char low[]="0123456789abcdefghijklmnopqrstuvwxyz";
+            static const char  up[]="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+            static const char pairs[]=
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+
+            if(base<2)base=2;
+            else if(base>36)base=36;
+            const char *digits = upcase ? up : low;
+
+            bool neg = val<0;
+            U acc = neg ? U(U(0)-U(val)) : U(val);
+            char *pnt=end;
+            if(base==10)
             {
-                if(data->buff[i]=='-')
+                while(acc>=100)
                 {
-                    neg=true;
+                    const char *pair=&pairs[(acc%100)*2];
+                    acc/=100;
+                    *--pnt=pair[1];
+                    *--pnt=pair[0];
                 }
-                else if(data->buff[i]>='0' && data->buff[i]<='9')
+                if(acc>=10)
                 {
-                    if(afterpoint)div*=10.0;
-                    rv*=10.0;
-                    rv+=data->buff[i]-'0';
+                    *--pnt=pairs[acc*2+1];
+                    *--pnt=pairs[acc*2];
                 }
-                else if(data->buff[i]=='.')
+                else *--pnt=char('0'+acc);
+            }
+            else if(!(base&(base-1)))
+            {
+                int shift=0;
+                while((1<<shift)<base)shift++;
+                do
                 {
-                    afterpoint=true;
+                    *--pnt=digits[acc&U(base-1)];
+                    acc>>=shift;
                 }
+                while(acc);
             }
-            rv/=div;
-            if(neg)return -rv;
-            return rv;
-        }
-
-        ///////////////////////////////////////////////////////////////////////////
-
-        static string fromReal(real val,int prec)
-        {   //todo: собственный разбор
-            string format="%."+string::fromInt(prec)+"g";
-            return print(format(),val);
+            else
+            {
+                do
+                {
+                    *--pnt=digits[acc%U(base)];
+                    acc/=U(base);
+                }
+                while(acc);
+            }
+            if(neg)*--pnt='-';
+            return pnt;
         }
 
         template <class I>
         static string fromInt(I val, int base=10, bool upcase=true)
         {
-         const static char low[]="0123456789abcdefghijklmnopqrstuvwxyz???";
-         const static char  up[]="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ???";
-         string retval;
-         const char *pnt;
-
-                if(!val)return "0";
-                if(base<2)base=2;
-                else if(base>36)base=36;
-                if(upcase)pnt=up;
-                else pnt=low;
-                if(val<0)
-                {
-                        retval.append('-');
-                        retval.append(pnt[-(val%base)]);
-                        val/=base;
-                        val=-val;
-                        if(val==0)return retval;
-                }
-                while(val)
-                {
-                        retval.append(pnt[val%base]);
-                        val/=base;
-                }
-                if(retval[0]=='-')retval.reverseSuffix(1);
-                else retval.reverse();
-                return retval;
+            char buff[sizeof(I)*8+1];
+            char *end=buff+sizeof(buff);
+            char *pnt=formatInt(end,val,base,upcase);
+            string rv(int(end-pnt),false);
+            ::memcpy(rv.buffer(),pnt,end-pnt);
+            return rv;
         }
 
+        //дополнение до fix символов заполнителем sym; для '0' знак ставится перед нулями
         template <class I>
         static string fromIntFormat(I val, int fix, int base=10, char sym='0', bool upcase=true)
         {
-         string retval,tmp;
-         int i,lim,j;
-
-                if(fix<=0)fix=1;
-                retval.Fill('0',0,fix);
-
-                tmp=fromInt(val,base,upcase);
-
-                if(tmp.size()>=fix)return tmp;
-
-                if(tmp[0]=='-')lim=1;
-                else lim=0;
-                for(j=retval.size()-1,i=tmp.size()-1;i>=lim;i--,j--)
-                {
-                        retval[j]=tmp[i];
-                }
-                if(lim)retval[0]='-';
-
-                return retval;
+            char buff[sizeof(I)*8+1];
+            char *end=buff+sizeof(buff);
+            char *pnt=formatInt(end,val,base,upcase);
+            int len=int(end-pnt);
+
+            if(fix<=0)fix=1;
+            if(len>=fix)fix=len;
+            string rv(fix,false);
+            char *dst=rv.buffer();
+            int pad=fix-len;
+            if(pad && *pnt=='-' && sym=='0')
+            {
+                *dst++='-';
+                pnt++;
+                len--;
+            }
+            ::memset(dst,sym,pad);
+            ::memcpy(dst+pad,pnt,len);
+            return rv;
         }
 
         static string fromFix(const char* fix, int max_size);
@@ -748,19 +912,18 @@ namespace alt {
         alt::array<string> split(char sym, bool scip_empty=false) const
         {
             alt::array<string> rv;
-            if(!data)return rv;
-
+            const char *buff=buffer();
             int curr=0;
-            for(int i=0;i<data->size;i++)
+            for(int i=0;i<size();i++)
             {
-                if(data->buff[i]==sym)
+                if(buff[i]==sym)
                 {
                     if(!scip_empty || i!=curr)
-                        rv.append(fromFix(&data->buff[curr],i-curr));
+                        rv.append(fromFix(&buff[curr],i-curr));
                     curr=i+1;
                 }
             }
-            if(curr<data->size || !scip_empty)
+            if(curr<size() || !scip_empty)
             {
                 rv.append(right(curr));
             }
@@ -841,6 +1004,47 @@ namespace alt {
 
     };
 
+    //участок чужого буфера без владения: действителен, пока жив владелец данных
+    class stringRef
+    {
+    public:
+        stringRef() : ptr(""), len(0) {}
+        stringRef(const char *str, int size) : ptr(str), len(size) {}
+        stringRef(const string &str) : ptr(str()), len(str.size()) {}
+
+        const char* data() const {return ptr;}
+        int size() const {return len;}
+        bool isEmpty() const {return !len;}
+        char operator[](int index) const {return ptr[index];}
+
+        stringRef mid(int from, int count) const
+        {
+            if(from>len)from=len;
+            if(count>len-from)count=len-from;
+            return stringRef(ptr+from,count);
+        }
+
+        string str() const
+        {
+            string rv(len,false);
+            if(len)::memcpy(rv(),ptr,len);
+            return rv;
+        }
+
+        bool operator==(const stringRef &val) const
+        {
+            return len==val.len && (!len || !::memcmp(ptr,val.ptr,len));
+        }
+        bool operator!=(const stringRef &val) const
+        {
+            return !((*this)==val);
+        }
+
+    private:
+        const char *ptr;
+        int len;
+    };
+
 ///////////////////////////////////////////////////////////////////////////////
 // Утилиты
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,251 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ASTRING_BUILDER_H
+#define ASTRING_BUILDER_H
+
+#include "astring.h"
+#include "avariant.h"
+#include "at_dim.h"
+#include "amath_vec.h"
+#include "atime.h"
+
+#include "external/fmt/format.h"
+
+#include <utility>
+
+// Сборка строки в одном растущем буфере вместо цепочек operator+.
+// Форматирование в стиле fmt пишет прямо в буфер, finish() отдает его в alt::string без копирования.
+
+namespace alt {
+
+    class stringBuilder
+    {
+    public:
+        explicit stringBuilder(int reserve_size = 0)
+        {
+            if(reserve_size>0)
+                reserve(reserve_size);
+        }
+
+        int size() const {return text.size();}
+        bool isEmpty() const {return !text.size();}
+        int capacity() const {return text.capacity();}
+
+        void reserve(int size)
+        {
+            if(size<=text.capacity() && !text.isShared())
+                return;
+            int cur = text.size();
+            if(size<cur)size = cur;
+            text.grow(size);
+            text.setSize(cur);
+        }
+
+        void clear() {text.clear();}
+
+        stringBuilder& append(char val)
+        {
+            int cur = text.size();
+            ensure(1);
+            text.buffer()[cur] = val;
+            text.setSize(cur+1);
+            return *this;
+        }
+
+        stringBuilder& append(const char *str, int size)
+        {
+            if(size<=0)
+                return *this;
+            int cur = text.size();
+            ensure(size);
+            ::memcpy(text.buffer()+cur,str,size);
+            text.setSize(cur+size);
+            return *this;
+        }
+
+        stringBuilder& append(const char *str) {return append(str,alt::utils::strlen(str));}
+        stringBuilder& append(const string &str) {return append(str(),str.size());}
+
+        stringBuilder& fill(char sym, int count)
+        {
+            if(count<=0)
+                return *this;
+            int cur = text.size();
+            ensure(count);
+            ::memset(text.buffer()+cur,sym,count);
+            text.setSize(cur+count);
+            return *this;
+        }
+
+        //формат проверяется при компиляции: builder.format("{} = {:.3f}", name, value)
+        template <typename... Args>
+        stringBuilder& format(fmt::format_string<Args...> pattern, Args&&... args)
+        {
+            sink out(*this);
+            fmt::format_to(fmt::appender(out),pattern,std::forward<Args>(args)...);
+            return *this;
+        }
+
+        stringBuilder& operator<<(char val) {return append(val);}
+        stringBuilder& operator<<(const char *val) {return append(val);}
+        stringBuilder& operator<<(const string &val) {return append(val);}
+        template <class T>
+        stringBuilder& operator<<(const T &val) {return format("{}",val);}
+
+        //текущее содержимое без передачи буфера
+        const string& str() const {return text;}
+
+        //буфер уходит в результат, построитель становится пустым
+        string finish()
+        {
+            string rv = text;
+            text = string();
+            return rv;
+        }
+
+    private:
+
+        //буфер fmt поверх строки построителя: пишет на место и растит ее при нехватке
+        class sink : public fmt::detail::buffer<char>
+        {
+        public:
+            sink(stringBuilder &val) : fmt::detail::buffer<char>(grow), owner(val)
+            {
+                owner.ensure(0);
+                set(owner.text.buffer(),owner.text.capacity());
+                try_resize(owner.text.size());
+            }
+            ~sink()
+            {
+                owner.text.setSize(int(size()));
+            }
+
+        private:
+            static void grow(fmt::detail::buffer<char> &buf, size_t need)
+            {
+                sink &self = static_cast<sink&>(buf);
+                self.owner.text.setSize(int(buf.size()));
+                self.owner.ensure(int(need-buf.size()));
+                self.set(self.owner.text.buffer(),self.owner.text.capacity());
+            }
+
+            stringBuilder &owner;
+        };
+
+        //место еще под extra символов, объем растет геометрически
+        void ensure(int extra)
+        {
+            int need = text.size()+extra;
+            if(need<=text.capacity() && !text.isShared())
+                return;
+            int cap = text.capacity()*2;
+            reserve(need>cap ? need : cap);
+        }
+
+        string text;
+    };
+
+    template <typename... Args>
+    string format(fmt::format_string<Args...> pattern, Args&&... args)
+    {
+        stringBuilder rv;
+        rv.format(pattern,std::forward<Args>(args)...);
+        return rv.finish();
+    }
+
+} // namespace alt
+
+//////////////////////////////////////////////////////////////////////////
+//форматирование типов alt
+
+template <>
+struct fmt::formatter<alt::string> : fmt::formatter<fmt::string_view>
+{
+    auto format(const alt::string &val, fmt::format_context &ctx) const
+    {
+        return fmt::formatter<fmt::string_view>::format(fmt::string_view(val(),val.size()),ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<alt::variant> : fmt::formatter<alt::string>
+{
+    auto format(const alt::variant &val, fmt::format_context &ctx) const
+    {
+        return fmt::formatter<alt::string>::format(val.toString(),ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<alt::time> : fmt::formatter<alt::string>
+{
+    auto format(const alt::time &val, fmt::format_context &ctx) const
+    {
+        alt::time tmp = val;
+        return fmt::formatter<alt::string>::format(tmp.toString(),ctx);
+    }
+};
+
+//спецификатор относится к каждой компоненте: "{:.2f}" для vec3d<double> дает (1.00, 2.00, 3.00)
+template <class T>
+struct fmt::formatter<alt::vec3d<T>> : fmt::formatter<T>
+{
+    auto format(const alt::vec3d<T> &val, fmt::format_context &ctx) const
+    {
+        auto out = ctx.out();
+        *out++ = '(';
+        ctx.advance_to(out);
+        out = fmt::formatter<T>::format(val.x,ctx);
+        *out++ = ','; *out++ = ' ';
+        ctx.advance_to(out);
+        out = fmt::formatter<T>::format(val.y,ctx);
+        *out++ = ','; *out++ = ' ';
+        ctx.advance_to(out);
+        out = fmt::formatter<T>::format(val.z,ctx);
+        *out++ = ')';
+        return out;
+    }
+};
+
+//размеры через 'x', как dimensions::toString()
+template <class T>
+struct fmt::formatter<alt::dimensions<T>> : fmt::formatter<T>
+{
+    auto format(const alt::dimensions<T> &val, fmt::format_context &ctx) const
+    {
+        auto out = ctx.out();
+        for(T i=0;i<val.size();i++)
+        {
+            if(i)*out++ = 'x';
+            ctx.advance_to(out);
+            out = fmt::formatter<T>::format(val[i],ctx);
+        }
+        return out;
+    }
+};
+
+#endif // ASTRING_BUILDER_H
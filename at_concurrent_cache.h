@@ -0,0 +1,312 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AT_CONCURRENT_CACHE_H
+#define AT_CONCURRENT_CACHE_H
+
+#include "at_priority_cache.h"
+#include "at_ring.h"
+#include "athread.h"
+#include "atime.h"
+
+#include <atomic>
+
+namespace alt {
+
+    struct concurrentCacheStats
+    {
+        uint64 inserts = 0;
+        uint64 evictions = 0;
+        uint64 expired = 0;
+    };
+
+    // Разделяемый между потоками кэш. Ключи распределены по шардам по хэшу,
+    // вытеснение - CLOCK: чтение только взводит бит обращения (и только если он сброшен),
+    // все перестроения выполняет писатель под исключительной блокировкой шарда.
+    // Значение копируется под разделяемой блокировкой, поэтому копирование V должно быть
+    // потокобезопасным (POD, shared<T>, ...); для alt::string/array используйте visit().
+    template <class K, class V>
+    class concurrentCache
+    {
+    public:
+
+        //maxCount - общий лимит (делится между шардами с округлением вверх),
+        //ttl_us - время жизни по умолчанию (0 - бессрочно)
+        explicit concurrentCache(int maxCount, int shardCount = 64, uint64 ttl_us = 0)
+        {
+            int p2p = 0;
+            while((1<<p2p)<shardCount && p2p<16) p2p++;
+            shard_bits = p2p;
+            shards = new Shard[1<<p2p];
+
+            int per_shard = roundup_div(maxCount>0 ? maxCount : 1, 1<<p2p);
+            for(int i=0;i<(1<<p2p);i++)
+                shards[i].init(per_shard);
+
+            default_ttl = ttl_us;
+        }
+
+        ~concurrentCache()
+        {
+            delete []shards;
+        }
+
+        concurrentCache(const concurrentCache &val) = delete;
+        concurrentCache& operator=(const concurrentCache &val) = delete;
+
+        bool get(const K &key, V &val) const
+        {
+            return visit(key,[&](const V &el){ val = el; });
+        }
+
+        //proc(const V&) вызывается под разделяемой блокировкой шарда
+        template <class F>
+        bool visit(const K &key, F proc) const
+        {
+            Shard &sh = shardOf(key);
+            sh.lock.lockShared();
+            int ind = sh.index.indexOf(key);
+            if(ind<0)
+            {
+                sh.lock.unlockShared();
+                return false;
+            }
+            Entry &el = sh.entries[sh.index.value(ind)];
+            if(el.expire && el.expire<=alt::time::uStamp())
+            {
+                sh.lock.unlockShared();
+                return false;
+            }
+            if(!el.referenced.load(std::memory_order_relaxed))
+                el.referenced.store(1,std::memory_order_relaxed);
+            proc(el.value);
+            sh.lock.unlockShared();
+            return true;
+        }
+
+        bool contains(const K &key) const
+        {
+            return visit(key,[](const V&){});
+        }
+
+        //ttl_us: 0 - по умолчанию для кэша, -1 - бессрочно
+        void insert(const K &key, const V &val, int64 ttl_us = 0)
+        {
+            uint64 expire = 0;
+            if(ttl_us>0) expire = alt::time::uStamp()+ttl_us;
+            else if(!ttl_us && default_ttl) expire = alt::time::uStamp()+default_ttl;
+
+            Shard &sh = shardOf(key);
+            sh.lock.lock();
+
+            int slot;
+            int ind = sh.index.indexOf(key);
+            if(ind>=0) slot = sh.index.value(ind);
+            else
+            {
+                slot = sh.freeSlot();
+                sh.index.insert(key,slot);
+                sh.entries[slot].key = key;
+                sh.entries[slot].used = true;
+                sh.count++;
+            }
+
+            Entry &el = sh.entries[slot];
+            el.value = val;
+            el.expire = expire;
+            el.referenced.store(0,std::memory_order_relaxed);
+            sh.stat.inserts++;
+
+            sh.lock.unlock();
+        }
+
+        bool remove(const K &key)
+        {
+            Shard &sh = shardOf(key);
+            sh.lock.lock();
+            int ind = sh.index.indexOf(key);
+            if(ind>=0) sh.drop(sh.index.value(ind));
+            sh.lock.unlock();
+            return ind>=0;
+        }
+
+        //удаление просроченных записей без ожидания вытеснения
+        int purgeExpired()
+        {
+            int rv = 0;
+            uint64 now = alt::time::uStamp();
+            for(int i=0;i<shardCount();i++)
+            {
+                Shard &sh = shards[i];
+                sh.lock.lock();
+                for(int j=0;j<sh.capacity;j++)
+                {
+                    Entry &el = sh.entries[j];
+                    if(el.used && el.expire && el.expire<=now)
+                    {
+                        sh.drop(j);
+                        sh.stat.expired++;
+                        rv++;
+                    }
+                }
+                sh.lock.unlock();
+            }
+            return rv;
+        }
+
+        void clear()
+        {
+            for(int i=0;i<shardCount();i++)
+            {
+                Shard &sh = shards[i];
+                sh.lock.lock();
+                for(int j=0;j<sh.capacity;j++)
+                {
+                    if(sh.entries[j].used) sh.drop(j);
+                }
+                sh.lock.unlock();
+            }
+        }
+
+        int size() const
+        {
+            int rv = 0;
+            for(int i=0;i<shardCount();i++)
+            {
+                shards[i].lock.lockShared();
+                rv += shards[i].count;
+                shards[i].lock.unlockShared();
+            }
+            return rv;
+        }
+
+        int shardCount() const { return 1<<shard_bits; }
+
+        concurrentCacheStats stats() const
+        {
+            concurrentCacheStats rv;
+            for(int i=0;i<shardCount();i++)
+            {
+                shards[i].lock.lockShared();
+                rv.inserts += shards[i].stat.inserts;
+                rv.evictions += shards[i].stat.evictions;
+                rv.expired += shards[i].stat.expired;
+                shards[i].lock.unlockShared();
+            }
+            return rv;
+        }
+
+    private:
+
+        struct Entry
+        {
+            K key;
+            V value;
+            uint64 expire = 0;
+            std::atomic<uint8> referenced = 0;
+            bool used = false;
+        };
+
+        struct alignas(hardware_destructive_interference_size) Shard
+        {
+            mutable rwlock lock;
+            hash<K,int> index;
+            Entry *entries = nullptr;
+            array<int> free;
+            int capacity = 0;
+            int count = 0;
+            int hand = 0;
+            concurrentCacheStats stat;
+
+            ~Shard() { delete []entries; }
+
+            void init(int size)
+            {
+                capacity = size;
+                entries = new Entry[size];
+                for(int i=size-1;i>=0;i--) free.append(i);
+            }
+
+            int freeSlot()
+            {
+                if(free.size()) return free.pop();
+
+                //CLOCK: просроченные и давно не читанные уходят первыми
+                uint64 now = 0;
+                for(;;)
+                {
+                    Entry &el = entries[hand];
+                    int slot = hand;
+                    hand = (hand+1)%capacity;
+
+                    if(el.expire)
+                    {
+                        if(!now) now = alt::time::uStamp();
+                        if(el.expire<=now)
+                        {
+                            drop(slot);
+                            stat.expired++;
+                            return free.pop();
+                        }
+                    }
+                    if(el.referenced.load(std::memory_order_relaxed))
+                    {
+                        el.referenced.store(0,std::memory_order_relaxed);
+                        continue;
+                    }
+                    drop(slot);
+                    stat.evictions++;
+                    return free.pop();
+                }
+            }
+
+            void drop(int slot)
+            {
+                Entry &el = entries[slot];
+                index.remove(el.key);
+                el.key = K();
+                el.value = V();
+                el.expire = 0;
+                el.used = false;
+                free.append(slot);
+                count--;
+            }
+        };
+
+        Shard& shardOf(const K &key) const
+        {
+            uint32 code = cacheMix(aHash(key));
+            return shards[shard_bits ? code>>(32-shard_bits) : 0];
+        }
+
+        Shard *shards;
+        int shard_bits;
+        uint64 default_ttl;
+    };
+
+} // namespace alt
+
+#endif // AT_CONCURRENT_CACHE_H
@@ -0,0 +1,645 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AT_FUTURE_H
+#define AT_FUTURE_H
+
+#include "athreadpool.h"
+#include "at_array.h"
+#include "atypes.h"
+
+#include <functional>
+#include <type_traits>
+#include <initializer_list>
+
+// Асинхронные результаты поверх threadPool: future/promise с продолжениями then(),
+// whenAll/whenAny, токены отмены и граф задач, запускающий узел сразу после его входов.
+// Исключения не используются: вместо ошибки результат переходит в состояние "отменен",
+// get() у отмененного результата возвращает значение по умолчанию.
+
+namespace alt {
+
+    class cancelToken
+    {
+    public:
+        cancelToken() : state(new std::atomic<bool>(false)) {}
+
+        void cancel()
+        {
+            state->store(true,std::memory_order_release);
+        }
+
+        bool isCancelled() const
+        {
+            return state->load(std::memory_order_acquire);
+        }
+
+    private:
+        shared<std::atomic<bool>> state;
+    };
+
+    namespace futures {
+
+        enum
+        {
+            PENDING = 0,
+            READY,
+            CANCELLED
+        };
+
+        template<typename T>
+        struct storage
+        {
+            typedef T type;
+        };
+
+        template<>
+        struct storage<void>
+        {
+            typedef char type;
+        };
+
+        template<typename T>
+        struct state
+        {
+            std::atomic<int> status = PENDING;
+            typename storage<T>::type value = typename storage<T>::type();
+
+            semaphore mutex;
+            array<std::function<void()>> continuations;
+
+            //true, если перевели из PENDING
+            bool finish(int result)
+            {
+                mutex.lock();
+                if(status.load(std::memory_order_relaxed)!=PENDING)
+                {
+                    mutex.unlock();
+                    return false;
+                }
+                status.store(result,std::memory_order_release);
+                array<std::function<void()>> list = continuations;
+                continuations.clear();
+                mutex.unlock();
+
+                status.notify_all();
+                for(int i=0;i<list.size();i++)
+                    list[i]();
+                return true;
+            }
+
+            //fun вызывается сразу, если результат уже есть
+            void subscribe(std::function<void()> fun)
+            {
+                mutex.lock();
+                if(status.load(std::memory_order_relaxed)==PENDING)
+                {
+                    continuations.append(fun);
+                    mutex.unlock();
+                    return;
+                }
+                mutex.unlock();
+                fun();
+            }
+
+            void wait(threadPool *pool)
+            {
+                //рабочий пула выполняет чужие задачи, чтобы не заблокировать пул
+                bool worker = pool && pool->currentWorker()>=0;
+                int idle = 0;
+                for(;;)
+                {
+                    int current = status.load(std::memory_order_acquire);
+                    if(current!=PENDING)
+                        return;
+                    if(worker)
+                    {
+                        if(!pool->runPending())
+                            alt::sleep(++idle<64 ? 0 : 50);
+                        else
+                            idle = 0;
+                        continue;
+                    }
+                    status.wait(PENDING,std::memory_order_acquire);
+                }
+            }
+        };
+
+        //результат fun(arg) или fun() для void
+        template<typename F, typename T>
+        struct thenResult
+        {
+            typedef typename std::invoke_result<F,const T&>::type type;
+        };
+
+        template<typename F>
+        struct thenResult<F,void>
+        {
+            typedef typename std::invoke_result<F>::type type;
+        };
+
+    } // namespace futures
+
+    template<typename T> class promise;
+
+    namespace futures {
+
+        template<typename R, typename F, typename... A>
+        void fulfil(const promise<R> &prom, F &fun, A&&... args);
+
+    } // namespace futures
+
+    template<typename T>
+    class future
+    {
+    public:
+        future() {}
+
+        bool isValid() const {return st.use_count()>0;}
+
+        bool isReady() const
+        {
+            return isValid() && st->status.load(std::memory_order_acquire)==futures::READY;
+        }
+
+        bool isCancelled() const
+        {
+            return isValid() && st->status.load(std::memory_order_acquire)==futures::CANCELLED;
+        }
+
+        bool isDone() const
+        {
+            return isValid() && st->status.load(std::memory_order_acquire)!=futures::PENDING;
+        }
+
+        void wait(threadPool *pool = nullptr) const
+        {
+            if(!isValid())
+                return;
+            st->wait(pool ? pool : &threadPool::global());
+        }
+
+        T get(threadPool *pool = nullptr) const
+        {
+            wait(pool);
+            if constexpr (!std::is_void<T>::value)
+            {
+                if(!isReady())
+                    return T();
+                return st->value;
+            }
+        }
+
+        //fun(значение) выполняется в пуле после готовности; отмена передается дальше без вызова fun
+        template<typename F>
+        future<typename futures::thenResult<F,T>::type> then(F &&fun, threadPool *pool = nullptr) const;
+
+        //вызывается при любом завершении, в том числе отмене
+        void onDone(std::function<void()> fun) const
+        {
+            if(isValid())
+                st->subscribe(fun);
+        }
+
+    private:
+        friend class promise<T>;
+
+        future(const shared<futures::state<T>> &val) : st(val) {}
+
+        shared<futures::state<T>> st;
+    };
+
+    template<typename T>
+    class promise
+    {
+    public:
+        promise() : st(new futures::state<T>()) {}
+
+        future<T> getFuture() const {return future<T>(st);}
+
+        //val не должен больше использоваться вызывающим, если это alt::string/array:
+        //их счетчик ссылок не атомарный, а получатель может копировать значение сразу
+        template<typename V = T>
+        typename std::enable_if<!std::is_void<V>::value,bool>::type setValue(const V &val) const
+        {
+            return store(val) && st->finish(futures::READY);
+        }
+
+        template<typename V = T>
+        typename std::enable_if<std::is_void<V>::value,bool>::type setValue() const
+        {
+            return st->finish(futures::READY);
+        }
+
+        //копии promise делят состояние, поэтому невыполненное обещание нужно отменять явно
+        bool cancel() const
+        {
+            return st->finish(futures::CANCELLED);
+        }
+
+        bool isDone() const
+        {
+            return st->status.load(std::memory_order_acquire)!=futures::PENDING;
+        }
+
+    private:
+        template<typename R, typename F, typename... A>
+        friend void futures::fulfil(const promise<R> &prom, F &fun, A&&... args);
+
+        template<typename V>
+        bool store(const V &val) const
+        {
+            st->mutex.lock();
+            bool pending = st->status.load(std::memory_order_relaxed)==futures::PENDING;
+            if(pending)
+                st->value = val;
+            st->mutex.unlock();
+            return pending;
+        }
+
+        bool commit() const
+        {
+            return st->finish(futures::READY);
+        }
+
+        shared<futures::state<T>> st;
+    };
+
+    namespace futures {
+
+        //выполнить fun(args...) и положить результат в prom;
+        //временный результат разрушается до публикации
+        template<typename R, typename F, typename... A>
+        void fulfil(const promise<R> &prom, F &fun, A&&... args)
+        {
+            if constexpr (std::is_void<R>::value)
+            {
+                fun(std::forward<A>(args)...);
+                prom.setValue();
+            }
+            else
+            {
+                bool stored;
+                {
+                    R tmp = fun(std::forward<A>(args)...);
+                    stored = prom.store(tmp);
+                }
+                if(stored)
+                    prom.commit();
+            }
+        }
+
+    } // namespace futures
+
+    template<typename T>
+    template<typename F>
+    future<typename futures::thenResult<F,T>::type> future<T>::then(F &&fun, threadPool *pool) const
+    {
+        typedef typename futures::thenResult<F,T>::type R;
+        if(!pool)
+            pool = &threadPool::global();
+
+        promise<R> prom;
+        if(!isValid())
+        {
+            prom.cancel();
+            return prom.getFuture();
+        }
+
+        future<T> self = *this;
+        typename std::decay<F>::type proc(std::forward<F>(fun));
+        st->subscribe([self,prom,proc,pool]()
+        {
+            if(self.isCancelled())
+            {
+                prom.cancel();
+                return;
+            }
+            pool->submit([self,prom,proc]() mutable
+            {
+                if constexpr (std::is_void<T>::value)
+                    futures::fulfil(prom,proc);
+                else
+                    futures::fulfil(prom,proc,(const T&)self.st->value);
+            });
+        });
+        return prom.getFuture();
+    }
+
+    //fun() в пуле; если токен отменен до старта, результат отменяется
+    template<typename F>
+    future<typename std::invoke_result<F>::type> async(F &&fun, threadPool *pool = nullptr,
+                                                      cancelToken token = cancelToken())
+    {
+        typedef typename std::invoke_result<F>::type R;
+        if(!pool)
+            pool = &threadPool::global();
+
+        promise<R> prom;
+        typename std::decay<F>::type proc(std::forward<F>(fun));
+        pool->submit([prom,proc,token]() mutable
+        {
+            if(token.isCancelled())
+            {
+                prom.cancel();
+                return;
+            }
+            futures::fulfil(prom,proc);
+        });
+        return prom.getFuture();
+    }
+
+    namespace futures {
+
+        template<typename T>
+        struct waitList
+        {
+            waitList(const array<future<T>> &list)
+                : items(list), left(list.size())
+            {
+            }
+
+            array<future<T>> items;
+            std::atomic<int> left;
+        };
+
+    } // namespace futures
+
+    //готов, когда готовы все; отмена любого отменяет результат
+    template<typename T>
+    future<array<T>> whenAll(const array<future<T>> &list)
+    {
+        promise<array<T>> prom;
+        if(!list.size())
+        {
+            prom.setValue(array<T>());
+            return prom.getFuture();
+        }
+
+        //копии alt::array нельзя делить между потоками, поэтому список живет в одном экземпляре
+        shared<futures::waitList<T>> wait_list(new futures::waitList<T>(list));
+        for(int i=0;i<list.size();i++)
+        {
+            list[i].onDone([wait_list,prom]()
+            {
+                if(wait_list->left.fetch_sub(1,std::memory_order_acq_rel)!=1)
+                    return;
+                const array<future<T>> &items = wait_list->items;
+                for(int j=0;j<items.size();j++)
+                {
+                    if(items[j].isCancelled())
+                    {
+                        prom.cancel();
+                        return;
+                    }
+                }
+                auto collect = [&items]()
+                {
+                    array<T> rv;
+                    rv.resize(items.size());
+                    for(int j=0;j<items.size();j++)
+                        rv[j] = items[j].get();
+                    return rv;
+                };
+                futures::fulfil(prom,collect);
+            });
+        }
+        return prom.getFuture();
+    }
+
+    __inline future<void> whenAll(const array<future<void>> &list)
+    {
+        promise<void> prom;
+        if(!list.size())
+        {
+            prom.setValue();
+            return prom.getFuture();
+        }
+
+        shared<futures::waitList<void>> wait_list(new futures::waitList<void>(list));
+        for(int i=0;i<list.size();i++)
+        {
+            list[i].onDone([wait_list,prom]()
+            {
+                if(wait_list->left.fetch_sub(1,std::memory_order_acq_rel)!=1)
+                    return;
+                const array<future<void>> &items = wait_list->items;
+                for(int j=0;j<items.size();j++)
+                {
+                    if(items[j].isCancelled())
+                    {
+                        prom.cancel();
+                        return;
+                    }
+                }
+                prom.setValue();
+            });
+        }
+        return prom.getFuture();
+    }
+
+    //индекс первого завершившегося (готового или отмененного)
+    template<typename T>
+    future<int> whenAny(const array<future<T>> &list)
+    {
+        promise<int> prom;
+        if(!list.size())
+        {
+            prom.cancel();
+            return prom.getFuture();
+        }
+        for(int i=0;i<list.size();i++)
+        {
+            list[i].onDone([prom,i]()
+            {
+                prom.setValue(i);
+            });
+        }
+        return prom.getFuture();
+    }
+
+    //граф зависимых задач: узел отправляется в пул, как только выполнены все его входы
+    class taskGraph
+    {
+    public:
+        taskGraph(threadPool *pool = nullptr)
+            : pool(pool ? pool : &threadPool::global())
+        {
+        }
+
+        ~taskGraph()
+        {
+            wait();
+            for(int i=0;i<nodes.size();i++)
+                delete nodes[i];
+        }
+
+        taskGraph(const taskGraph &val) = delete;
+        taskGraph& operator=(const taskGraph &val) = delete;
+
+        int add(std::function<void()> fun, std::initializer_list<int> deps = {})
+        {
+            node *el = new node;
+            el->fun = fun;
+            nodes.append(el);
+            int rv = nodes.size()-1;
+            for(int dep : deps)
+                depends(rv,dep);
+            return rv;
+        }
+
+        //task выполнится после on
+        bool depends(int task, int on)
+        {
+            if(task<0 || on<0 || task>=nodes.size() || on>=nodes.size() || task==on)
+                return false;
+            nodes[on]->next.append(task);
+            nodes[task]->inputs++;
+            return true;
+        }
+
+        int size() const {return nodes.size();}
+
+        //false при цикле в графе
+        bool isAcyclic() const
+        {
+            array<int> inputs;
+            inputs.resize(nodes.size());
+            array<int> ready;
+            for(int i=0;i<nodes.size();i++)
+            {
+                inputs[i] = nodes[i]->inputs;
+                if(!inputs[i])
+                    ready.append(i);
+            }
+            int visited = 0;
+            while(ready.size())
+            {
+                int cur = ready.pop();
+                visited++;
+                const array<int> &next = nodes[cur]->next;
+                for(int i=0;i<next.size();i++)
+                {
+                    if(!--inputs[next[i]])
+                        ready.append(next[i]);
+                }
+            }
+            return visited==nodes.size();
+        }
+
+        //запуск без ожидания; граф должен жить до завершения результата.
+        //при отмене оставшиеся узлы не выполняются, результат отменяется
+        future<void> start(cancelToken token = cancelToken())
+        {
+            wait();
+
+            promise<void> prom;
+            finished = prom.getFuture();
+            if(!isAcyclic())
+            {
+                prom.cancel();
+                return finished;
+            }
+            if(!nodes.size())
+            {
+                prom.setValue();
+                return finished;
+            }
+
+            done = prom;
+            cancel = token;
+            left.store(nodes.size(),std::memory_order_relaxed);
+            for(int i=0;i<nodes.size();i++)
+                nodes[i]->remaining.store(nodes[i]->inputs,std::memory_order_relaxed);
+            for(int i=0;i<nodes.size();i++)
+            {
+                if(!nodes[i]->inputs)
+                    schedule(i);
+            }
+            return finished;
+        }
+
+        bool run(cancelToken token = cancelToken())
+        {
+            future<void> rv = start(token);
+            rv.wait(pool);
+            return rv.isReady();
+        }
+
+        void wait()
+        {
+            if(finished.isValid())
+                finished.wait(pool);
+        }
+
+    private:
+
+        struct node
+        {
+            std::function<void()> fun;
+            array<int> next;
+            int inputs = 0;
+            std::atomic<int> remaining = 0;
+        };
+
+        void schedule(int index)
+        {
+            pool->submit([this,index]()
+            {
+                node *el = nodes[index];
+                if(!cancel.isCancelled())
+                    el->fun();
+                for(int i=0;i<el->next.size();i++)
+                {
+                    if(nodes[el->next[i]]->remaining.fetch_sub(1,std::memory_order_acq_rel)==1)
+                        schedule(el->next[i]);
+                }
+                if(left.fetch_sub(1,std::memory_order_acq_rel)==1)
+                {
+                    //ожидающий finish() может разрушить граф сразу после завершения обещания,
+                    //поэтому все нужное копируется до него
+                    promise<void> prom = done;
+                    bool cancelled = cancel.isCancelled();
+                    if(cancelled)
+                        prom.cancel();
+                    else
+                        prom.setValue();
+                }
+            });
+        }
+
+        threadPool *pool;
+        array<node*> nodes;
+
+        std::atomic<int> left = 0;
+        cancelToken cancel;
+        promise<void> done;
+        future<void> finished;
+    };
+
+} // namespace alt
+
+#endif // AT_FUTURE_H
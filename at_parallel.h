@@ -0,0 +1,312 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef AT_PARALLEL_H
+#define AT_PARALLEL_H
+
+#include "athreadpool.h"
+#include "at_array.h"
+#include "at_tensor.h"
+
+// Параллельные алгоритмы поверх threadPool: диапазон делится на куски по grain элементов,
+// куски разбираются рабочими и вызывающим потоком через общий счетчик.
+// Редукция и скан детерминированы: при заданном grain (или grain=0) разбиение
+// не зависит от числа потоков, частичные результаты объединяются в порядке кусков.
+
+namespace alt {
+
+    namespace parallel {
+
+        enum
+        {
+            REDUCE_CHUNKS = 256, //куски по умолчанию для редукции и скана
+            FOR_OVERSPLIT = 8    //кусков на поток по умолчанию для parallelFor
+        };
+
+        __inline int64 chunkCount(int64 count, int64 grain)
+        {
+            return (count+grain-1)/grain;
+        }
+
+        __inline int64 forGrain(int64 count, int64 grain, threadPool *pool)
+        {
+            if(grain>0)
+                return grain;
+            int64 chunks = int64(pool->workerCount()+1)*FOR_OVERSPLIT;
+            int64 rv = (count+chunks-1)/chunks;
+            return rv>0 ? rv : 1;
+        }
+
+        __inline int64 reduceGrain(int64 count, int64 grain)
+        {
+            if(grain>0)
+                return grain;
+            int64 rv = (count+REDUCE_CHUNKS-1)/REDUCE_CHUNKS;
+            return rv>0 ? rv : 1;
+        }
+
+        //body(chunk) для chunk в [0,chunks)
+        template<typename F>
+        void runChunks(int64 chunks, F &body, threadPool *pool)
+        {
+            if(chunks<=0)
+                return;
+            if(chunks==1 || !pool->workerCount())
+            {
+                for(int64 i=0;i<chunks;i++)
+                    body(i);
+                return;
+            }
+
+            std::atomic<int64> next = 0;
+            auto runner = [&next,&body,chunks]()
+            {
+                for(;;)
+                {
+                    int64 chunk = next.fetch_add(1,std::memory_order_relaxed);
+                    if(chunk>=chunks)
+                        break;
+                    body(chunk);
+                }
+            };
+
+            int64 helpers = chunks-1;
+            if(helpers>pool->workerCount())
+                helpers = pool->workerCount();
+
+            taskGroup group(pool);
+            for(int64 i=0;i<helpers;i++)
+                group.run(runner);
+            runner();
+            group.wait();
+        }
+
+    } // namespace parallel
+
+    //fun(from,to) на кусках [begin,end)
+    template<typename F>
+    void parallelForRange(int64 begin, int64 end, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        if(end<=begin)
+            return;
+        if(!pool)
+            pool = &threadPool::global();
+
+        int64 count = end-begin;
+        grain = parallel::forGrain(count,grain,pool);
+        auto body = [&](int64 chunk)
+        {
+            int64 from = begin+chunk*grain;
+            int64 to = from+grain<end ? from+grain : end;
+            fun(from,to);
+        };
+        parallel::runChunks(parallel::chunkCount(count,grain),body,pool);
+    }
+
+    //fun(i) для каждого i в [begin,end)
+    template<typename F>
+    void parallelFor(int64 begin, int64 end, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        parallelForRange(begin,end,[&fun](int64 from, int64 to)
+        {
+            for(int64 i=from;i<to;i++)
+                fun(i);
+        },grain,pool);
+    }
+
+    //fun(el) для каждого элемента буфера
+    template<typename T, typename F>
+    void parallelFor(T *data, int64 count, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        parallelForRange(0,count,[data,&fun](int64 from, int64 to)
+        {
+            for(int64 i=from;i<to;i++)
+                fun(data[i]);
+        },grain,pool);
+    }
+
+    template<typename T, typename F>
+    void parallelFor(array<T> &arr, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        parallelFor(arr(),int64(arr.size()),std::forward<F>(fun),grain,pool);
+    }
+
+    template<typename T, typename F>
+    void parallelFor(tensor<T> &val, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        parallelFor(val(),int64(val.dims().rawSize()),std::forward<F>(fun),grain,pool);
+    }
+
+    //map(from,to) -> частичный результат куска, combine(a,b) -> объединение
+    template<typename R, typename M, typename C>
+    R parallelReduce(int64 begin, int64 end, R identity, M &&map, C &&combine, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        if(end<=begin)
+            return identity;
+        if(!pool)
+            pool = &threadPool::global();
+
+        int64 count = end-begin;
+        grain = parallel::reduceGrain(count,grain);
+        int64 chunks = parallel::chunkCount(count,grain);
+
+        array<R> partial;
+        partial.resize(int(chunks));
+        R *out = partial();
+        auto body = [&](int64 chunk)
+        {
+            int64 from = begin+chunk*grain;
+            int64 to = from+grain<end ? from+grain : end;
+            out[chunk] = map(from,to);
+        };
+        parallel::runChunks(chunks,body,pool);
+
+        R rv = identity;
+        for(int64 i=0;i<chunks;i++)
+            rv = combine(rv,out[i]);
+        return rv;
+    }
+
+    //свертка буфера: fold(acc,el) внутри куска, combine(a,b) - объединение результатов кусков
+    //(для суммы обе - одна операция, для подсчета вида acc+(el>0) combine - обычное сложение)
+    template<typename R, typename T, typename F, typename C>
+    R parallelReduce(const T *data, int64 count, R identity, F &&fold, C &&combine, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        return parallelReduce(int64(0),count,identity,[data,identity,&fold](int64 from, int64 to)
+        {
+            R acc = identity;
+            for(int64 i=from;i<to;i++)
+                acc = fold(acc,data[i]);
+            return acc;
+        },combine,grain,pool);
+    }
+
+    template<typename R, typename T, typename F, typename C>
+    R parallelReduce(const array<T> &arr, R identity, F &&fold, C &&combine, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        return parallelReduce(arr(),int64(arr.size()),identity,std::forward<F>(fold),std::forward<C>(combine),grain,pool);
+    }
+
+    //префиксная сумма операцией op, inclusive - с текущим элементом; in и out могут совпадать
+    template<typename T, typename C>
+    void parallelScan(const T *in, T *out, int64 count, T identity, C &&op, bool inclusive = true,
+                      int64 grain = 0, threadPool *pool = nullptr)
+    {
+        if(count<=0)
+            return;
+        if(!pool)
+            pool = &threadPool::global();
+
+        grain = parallel::reduceGrain(count,grain);
+        int64 chunks = parallel::chunkCount(count,grain);
+
+        //суммы кусков
+        array<T> sums;
+        sums.resize(int(chunks));
+        T *chunk_sum = sums();
+        auto reduce = [&](int64 chunk)
+        {
+            int64 from = chunk*grain;
+            int64 to = from+grain<count ? from+grain : count;
+            T acc = identity;
+            for(int64 i=from;i<to;i++)
+                acc = op(acc,in[i]);
+            chunk_sum[chunk] = acc;
+        };
+        parallel::runChunks(chunks,reduce,pool);
+
+        //смещения кусков (последовательно, кусков немного)
+        T acc = identity;
+        for(int64 i=0;i<chunks;i++)
+        {
+            T tmp = chunk_sum[i];
+            chunk_sum[i] = acc;
+            acc = op(acc,tmp);
+        }
+
+        auto scan = [&](int64 chunk)
+        {
+            int64 from = chunk*grain;
+            int64 to = from+grain<count ? from+grain : count;
+            T acc = chunk_sum[chunk];
+            for(int64 i=from;i<to;i++)
+            {
+                T val = in[i];
+                if(inclusive)
+                {
+                    acc = op(acc,val);
+                    out[i] = acc;
+                }
+                else
+                {
+                    out[i] = acc;
+                    acc = op(acc,val);
+                }
+            }
+        };
+        parallel::runChunks(chunks,scan,pool);
+    }
+
+    template<typename T, typename C>
+    array<T> parallelScan(const array<T> &arr, T identity, C &&op, bool inclusive = true,
+                          int64 grain = 0, threadPool *pool = nullptr)
+    {
+        array<T> rv;
+        rv.resize(arr.size());
+        parallelScan(arr(),rv(),int64(arr.size()),identity,std::forward<C>(op),inclusive,grain,pool);
+        return rv;
+    }
+
+    //out[i] = fun(in[i]); in и out могут совпадать
+    template<typename T, typename R, typename F>
+    void parallelTransform(const T *in, R *out, int64 count, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        parallelForRange(0,count,[in,out,&fun](int64 from, int64 to)
+        {
+            for(int64 i=from;i<to;i++)
+                out[i] = fun(in[i]);
+        },grain,pool);
+    }
+
+    template<typename R, typename T, typename F>
+    array<R> parallelTransform(const array<T> &arr, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        array<R> rv;
+        rv.resize(arr.size());
+        parallelTransform(arr(),rv(),int64(arr.size()),std::forward<F>(fun),grain,pool);
+        return rv;
+    }
+
+    template<typename T, typename F>
+    void parallelTransform(tensor<T> &val, F &&fun, int64 grain = 0, threadPool *pool = nullptr)
+    {
+        T *data = val();
+        parallelTransform(data,data,int64(val.dims().rawSize()),std::forward<F>(fun),grain,pool);
+    }
+
+} // namespace alt
+
+#endif // AT_PARALLEL_H
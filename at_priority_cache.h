@@ -28,6 +28,10 @@ SOFTWARE.
 #define PCACHE_H
 
 #include "at_array.h"
+#include "at_hash.h"
+#include "astring.h"
+
+#include <functional>
 
 namespace alt {
 
@@ -161,6 +165,659 @@ namespace alt {
         list.clear();free.clear();last=first=-1;
     }
 
+    //////////////////////////////////////////////////////////////////////////////////
+    // Кэш с доступом по ключу и подключаемой политикой вытеснения
+    //////////////////////////////////////////////////////////////////////////////////
+
+    __inline uint32 cacheMix(uint32 code)
+    {   //финализатор murmur3 - aHash строк слишком слабо перемешивает биты
+        code ^= code >> 16;
+        code *= 0x85ebca6b;
+        code ^= code >> 13;
+        code *= 0xc2b2ae35;
+        code ^= code >> 16;
+        return code;
+    }
+
+    //несколько двусвязных списков поверх общего пула индексов, голова - самый свежий
+    template <int LISTS>
+    class cacheLinks
+    {
+    public:
+        cacheLinks(){ clear(); }
+
+        void clear()
+        {
+            prev.clear(); next.clear(); owner.clear();
+            for(int i=0;i<LISTS;i++)
+            {
+                head[i] = tail[i] = -1;
+                counter[i] = 0;
+            }
+        }
+
+        void reserve(int size)
+        {
+            while(owner.size()<size)
+            {
+                prev.append(-1);
+                next.append(-1);
+                owner.append(-1);
+            }
+        }
+
+        void pushFront(int list, int ind)
+        {
+            reserve(ind+1);
+            if(owner[ind]>=0) unlink(ind);
+
+            prev[ind] = -1;
+            next[ind] = head[list];
+            if(head[list]>=0) prev[head[list]] = ind;
+            else tail[list] = ind;
+            head[list] = ind;
+            owner[ind] = list;
+            counter[list]++;
+        }
+
+        void unlink(int ind)
+        {
+            if(ind<0 || ind>=owner.size() || owner[ind]<0) return;
+            int list = owner[ind];
+
+            if(prev[ind]>=0) next[prev[ind]] = next[ind];
+            else head[list] = next[ind];
+            if(next[ind]>=0) prev[next[ind]] = prev[ind];
+            else tail[list] = prev[ind];
+
+            owner[ind] = -1;
+            counter[list]--;
+        }
+
+        int front(int list) const { return head[list]; }
+        int back(int list) const { return tail[list]; }
+        int count(int list) const { return counter[list]; }
+        int listOf(int ind) const
+        {
+            if(ind<0 || ind>=owner.size()) return -1;
+            return owner[ind];
+        }
+
+    private:
+
+        array<int> prev, next, owner;
+        int head[LISTS], tail[LISTS], counter[LISTS];
+    };
+
+    // Политика вытеснения работает только с номерами слотов кэша:
+    //  admit(code)        - будет вставлена запись с хэшем code, вызывается до вытеснения под нее
+    //  insert(slot, code) - новая запись, code - перемешанный хэш ключа
+    //  access(slot)       - попадание
+    //  remove(slot)       - запись удалена владельцем (remove/замена значения)
+    //  victim()           - кого вытеснять, -1 если некого
+    //  evicted(slot)      - кандидат из victim() действительно вытеснен
+    //  record(code)       - любое обращение по ключу, в т.ч. промах
+    //  clear()
+
+    class cacheLRU
+    {
+    public:
+        void admit(uint32) {}
+        void insert(int slot, uint32) { links.pushFront(0,slot); }
+        void access(int slot) { links.pushFront(0,slot); }
+        void remove(int slot) { links.unlink(slot); }
+        int victim() const { return links.back(0); }
+        void evicted(int slot) { links.unlink(slot); }
+        void record(uint32) {}
+        void clear() { links.clear(); }
+
+    private:
+        cacheLinks<1> links;
+    };
+
+    //Adaptive Replacement Cache (Megiddo, Modha): T1 - видели однажды, T2 - многократно,
+    //B1/B2 - "призраки" вытесненных из T1/T2 (хранятся только хэши ключей)
+    class cacheARC
+    {
+    public:
+        //попадание в призрак сдвигает цель до выбора жертвы, как в шаге REPLACE
+        void admit(uint32 code)
+        {
+            admitted = -1;
+            int ghost = ghostIndex.contains(code) ? ghostIndex[code] : -1;
+            int list = ghost>=0 ? ghosts.listOf(ghost) : -1;
+            if(list == B1)
+            {
+                int b1 = ghosts.count(B1), b2 = ghosts.count(B2);
+                target += b2>b1 ? b2/b1 : 1;
+                if(target>resident()) target = resident();
+            }
+            else if(list == B2)
+            {
+                int b1 = ghosts.count(B1), b2 = ghosts.count(B2);
+                target -= b1>b2 ? b1/b2 : 1;
+                if(target<0) target = 0;
+            }
+            else
+            {
+                return;
+            }
+            dropGhost(ghost);
+            admitted = list;
+            admittedCode = code;
+        }
+
+        void insert(int slot, uint32 code)
+        {
+            while(codes.size()<=slot) codes.append(0);
+            codes[slot] = code;
+
+            //встреченный в призраках ключ сразу попадает в T2
+            bool seen = admitted>=0 && admittedCode==code;
+            admitted = -1;
+            links.pushFront(seen ? T2 : T1,slot);
+        }
+
+        void access(int slot) { links.pushFront(T2,slot); }
+        void remove(int slot) { links.unlink(slot); }
+
+        int victim() const
+        {
+            int t1 = links.count(T1), t2 = links.count(T2);
+            if(t1 && (t1>target || (t1==target && admitted==B2) || !t2)) return links.back(T1);
+            return links.back(T2);
+        }
+
+        void evicted(int slot)
+        {
+            int list = links.listOf(slot);
+            links.unlink(slot);
+            if(list<0) return;
+            addGhost(list == T1 ? B1 : B2, codes[slot]);
+        }
+
+        void record(uint32) {}
+
+        void clear()
+        {
+            links.clear();
+            ghosts.clear();
+            ghostIndex.clear();
+            ghostCodes.clear();
+            ghostFree.clear();
+            codes.clear();
+            target = 0;
+            admitted = -1;
+        }
+
+        int adaptiveTarget() const { return target; }
+
+    private:
+
+        enum { T1 = 0, T2 = 1, B1 = 0, B2 = 1 };
+
+        int resident() const { return links.count(T1)+links.count(T2); }
+
+        void addGhost(int list, uint32 code)
+        {
+            if(ghostIndex.contains(code)) dropGhost(ghostIndex[code]);
+
+            int ind;
+            if(ghostFree.size()) ind = ghostFree.pop();
+            else
+            {
+                ind = ghostCodes.size();
+                ghostCodes.append(0);
+            }
+            ghostCodes[ind] = code;
+            ghostIndex.insert(code,ind);
+            ghosts.pushFront(list,ind);
+
+            //каждый список призраков не длиннее резидентной части
+            int limit = resident()>1 ? resident() : 1;
+            while(ghosts.count(list)>limit)
+                dropGhost(ghosts.back(list));
+        }
+
+        void dropGhost(int ind)
+        {
+            ghosts.unlink(ind);
+            ghostIndex.remove(ghostCodes[ind]);
+            ghostFree.append(ind);
+        }
+
+        cacheLinks<2> links;
+        cacheLinks<2> ghosts;
+        hash<uint32,int> ghostIndex;
+        array<uint32> ghostCodes;
+        array<int> ghostFree;
+        array<uint32> codes;
+        int target = 0;
+        int admitted = -1;      //список призраков последнего admit(), -1 - промах
+        uint32 admittedCode = 0;
+    };
+
+    //count-min скетч с 4-битными счетчиками и периодическим старением
+    class frequencySketch
+    {
+    public:
+        frequencySketch(int capacity = 64) { resize(capacity); }
+
+        void resize(int capacity)
+        {
+            int p2p = 4;
+            while((1<<p2p)<capacity && p2p<24) p2p++;
+            mask = (1u<<p2p)-1;
+            table.resize(ROWS<<p2p);
+            table.fill(0);
+            samples = 0;
+            sampleLimit = 10u<<p2p;
+        }
+
+        int width() const { return mask+1; }
+
+        void increment(uint32 code)
+        {
+            bool added = false;
+            uint8 *tab = table();
+            for(int i=0;i<ROWS;i++)
+            {
+                uint8 &cnt = tab[index(i,code)];
+                if(cnt<15)
+                {
+                    cnt++;
+                    added = true;
+                }
+            }
+            if(added && ++samples>=sampleLimit) age();
+        }
+
+        int estimate(uint32 code) const
+        {
+            int rv = 15;
+            for(int i=0;i<ROWS;i++)
+            {
+                int cnt = table[index(i,code)];
+                if(cnt<rv) rv = cnt;
+            }
+            return rv;
+        }
+
+        void clear()
+        {
+            table.fill(0);
+            samples = 0;
+        }
+
+    private:
+
+        enum { ROWS = 4 };
+
+        uint32 index(int row, uint32 code) const
+        {
+            const static uint32 seeds[ROWS] = { 0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f };
+            uint32 h = (code + seeds[row]) * seeds[(row+1)&(ROWS-1)];
+            h ^= h >> 15;
+            return uint32(row)*(mask+1) + (h & mask);
+        }
+
+        void age()
+        {
+            uint8 *tab = table();
+            for(intz i=0;i<table.size();i++) tab[i] >>= 1;
+            samples >>= 1;
+        }
+
+        array<uint8> table;
+        uint32 mask = 0;
+        uint32 samples = 0;
+        uint32 sampleLimit = 0;
+    };
+
+    //W-TinyLFU (Einziger, Friedman, Manes): маленькое LRU-окно перед сегментированным LRU,
+    //вышедший из окна кандидат вытесняет жертву основной части только если встречался чаще
+    class cacheTinyLFU
+    {
+    public:
+        void admit(uint32) {}
+        void insert(int slot, uint32 code)
+        {
+            while(codes.size()<=slot)
+            {
+                codes.append(0);
+                candidate.append(false);
+            }
+            codes[slot] = code;
+            candidate[slot] = false;
+            links.pushFront(WINDOW,slot);
+
+            int total = resident();
+            if(total>(sketch.width()<<1)) sketch.resize(total);
+
+            int quota = total/100 > 1 ? total/100 : 1;
+            while(links.count(WINDOW)>quota)
+            {
+                int ind = links.back(WINDOW);
+                links.pushFront(PROBATION,ind);
+                candidate[ind] = true;
+            }
+        }
+
+        void access(int slot)
+        {
+            int list = links.listOf(slot);
+            if(list == PROBATION)
+            {
+                candidate[slot] = false;
+                links.pushFront(PROTECTED,slot);
+
+                int main = links.count(PROBATION)+links.count(PROTECTED);
+                while(links.count(PROTECTED)>1 && links.count(PROTECTED)*5>main*4)
+                    links.pushFront(PROBATION,links.back(PROTECTED));
+            }
+            else if(list>=0)
+            {
+                links.pushFront(list,slot);
+            }
+        }
+
+        void remove(int slot) { links.unlink(slot); }
+
+        int victim()
+        {
+            int vict = links.back(PROBATION);
+            if(vict<0) vict = links.back(PROTECTED);
+            if(vict<0) return links.back(WINDOW);
+
+            //кандидаты из окна лежат у головы испытательного сегмента
+            int cand = links.front(PROBATION);
+            if(cand<0 || cand==vict || !candidate[cand] || candidate[vict])
+                return vict;
+
+            candidate[cand] = false;
+            if(sketch.estimate(codes[cand])>sketch.estimate(codes[vict]))
+                return vict;
+            return cand;
+        }
+
+        void evicted(int slot) { links.unlink(slot); }
+
+        void record(uint32 code) { sketch.increment(code); }
+
+        void clear()
+        {
+            links.clear();
+            sketch.clear();
+            codes.clear();
+            candidate.clear();
+        }
+
+    private:
+
+        enum { WINDOW = 0, PROBATION = 1, PROTECTED = 2 };
+
+        int resident() const
+        {
+            return links.count(WINDOW)+links.count(PROBATION)+links.count(PROTECTED);
+        }
+
+        cacheLinks<3> links;
+        frequencySketch sketch;
+        array<uint32> codes;
+        array<bool> candidate;
+    };
+
+    struct cacheStats
+    {
+        uint64 hits = 0;
+        uint64 misses = 0;
+        uint64 inserts = 0;
+        uint64 evictions = 0;
+        uint64 rejects = 0;
+
+        real hitRatio() const
+        {
+            uint64 total = hits+misses;
+            return total ? real(hits)/total : 0.0;
+        }
+
+        string toString() const
+        {
+            return "hits = " + string::fromInt(hits)
+                + ", misses = " + string::fromInt(misses)
+                + ", ratio = " + string::fromReal(hitRatio()*100.0,4) + "%"
+                + ", inserts = " + string::fromInt(inserts)
+                + ", evictions = " + string::fromInt(evictions)
+                + ", rejects = " + string::fromInt(rejects);
+        }
+    };
+
+    //лимиты: 0 - без ограничения; стоимость записи задается при вставке (например, в байтах)
+    template <class K, class V, class POLICY = cacheLRU>
+    class keyCache
+    {
+    public:
+
+        enum DropReason
+        {
+            Evicted,    //вытеснено политикой
+            Replaced,   //ключ вставлен повторно
+            Removed,    //удалено явно
+            Cleared     //clear()
+        };
+
+        typedef std::function<void(const K&, V&, DropReason)> dropCallback;
+
+        explicit keyCache(uint64 maxCount = 0, uint64 maxCost = 0)
+            : count_limit(maxCount), cost_limit(maxCost)
+        {
+        }
+
+        //обработчик не вызывается из деструктора - владелец должен сам позвать clear()
+        ~keyCache()
+        {
+            for(int i=0;i<slots.size();i++)
+                delete slots[i];
+        }
+
+        keyCache(const keyCache &val) = delete;
+        keyCache& operator=(const keyCache &val) = delete;
+
+        void onDrop(dropCallback proc) { drop_proc = proc; }
+
+        void setLimits(uint64 maxCount, uint64 maxCost = 0)
+        {
+            count_limit = maxCount;
+            cost_limit = maxCost;
+            trim(count_limit,cost_limit);
+        }
+        uint64 countLimit() const { return count_limit; }
+        uint64 costLimit() const { return cost_limit; }
+
+        //вытесняет записи до заданных лимитов, не меняя постоянных
+        void trim(uint64 maxCount, uint64 maxCost = 0)
+        {
+            while(overflow(maxCount,maxCost) && evictOne());
+        }
+
+        //указатели из insert/find/peek живут, пока запись в кэше: их не сдвигают другие вставки,
+        //но любая вставка может вытеснить запись, а remove/clear/setLimits/trim - удалить ее.
+        //nullptr - запись дороже лимита стоимости и сразу отдана обработчику
+        V* insert(const K &key, const V &val, uint64 cost = 1)
+        {
+            uint32 code = cacheMix(aHash(key));
+            policy.record(code);
+
+            int slot = index.contains(key) ? index[key] : -1;
+            if(slot>=0)
+            {
+                policy.remove(slot);
+                dropSlot(slot,Replaced);
+            }
+
+            if(cost_limit && cost>cost_limit)
+            {
+                stat.rejects++;
+                if(drop_proc)
+                {
+                    V tmp = val;
+                    drop_proc(key,tmp,Evicted);
+                }
+                return nullptr;
+            }
+
+            //политика узнает о записи до выбора жертвы (ARC сдвигает цель по призракам)
+            policy.admit(code);
+
+            //место освобождаем до вставки, чтобы новая запись не стала жертвой
+            while(overflow(count_limit,cost_limit,1,cost) && evictOne());
+
+            if(free_slots.size()) slot = free_slots.pop();
+            else
+            {
+                slot = slots.size();
+                slots.append(new Slot());
+            }
+
+            Slot &el = *slots[slot];
+            el.key = key;
+            el.value = val;
+            el.cost = cost;
+            el.used = true;
+            index.insert(key,slot);
+            total_cost += cost;
+            stat.inserts++;
+
+            policy.insert(slot,code);
+            return &el.value;
+        }
+
+        //поиск с учетом в статистике и политике
+        V* find(const K &key)
+        {
+            policy.record(cacheMix(aHash(key)));
+            int slot = index.contains(key) ? index[key] : -1;
+            if(slot<0)
+            {
+                stat.misses++;
+                return nullptr;
+            }
+            stat.hits++;
+            policy.access(slot);
+            return &slots[slot]->value;
+        }
+
+        bool get(const K &key, V &val)
+        {
+            V *rv = find(key);
+            if(!rv) return false;
+            val = *rv;
+            return true;
+        }
+
+        //без влияния на статистику и порядок вытеснения
+        V* peek(const K &key)
+        {
+            int slot = index.contains(key) ? index[key] : -1;
+            if(slot<0) return nullptr;
+            return &slots[slot]->value;
+        }
+
+        bool contains(const K &key) const
+        {
+            return index.contains(key);
+        }
+
+        bool remove(const K &key)
+        {
+            if(!index.contains(key)) return false;
+            int slot = index[key];
+            policy.remove(slot);
+            dropSlot(slot,Removed);
+            return true;
+        }
+
+        void clear()
+        {
+            for(int i=0;i<slots.size();i++)
+            {
+                if(slots[i]->used)
+                {
+                    slots[i]->used = false;
+                    if(drop_proc) drop_proc(slots[i]->key,slots[i]->value,Cleared);
+                }
+                delete slots[i];
+            }
+            slots.clear();
+            free_slots.clear();
+            index.clear();
+            policy.clear();
+            total_cost = 0;
+        }
+
+        int size() const { return index.size(); }
+        uint64 cost() const { return total_cost; }
+
+        const array<K>& keys() const { return index.keys(); }
+
+        const cacheStats& stats() const { return stat; }
+        void resetStats() { stat = cacheStats(); }
+
+        POLICY& evictionPolicy() { return policy; }
+
+    private:
+
+        struct Slot
+        {
+            K key;
+            V value;
+            uint64 cost = 0;
+            bool used = false;
+        };
+
+        bool overflow(uint64 maxCount, uint64 maxCost, uint64 addCount = 0, uint64 addCost = 0) const
+        {
+            if(!size()) return false;
+            if(maxCount && uint64(size())+addCount>maxCount) return true;
+            if(maxCost && total_cost+addCost>maxCost) return true;
+            return false;
+        }
+
+        bool evictOne()
+        {
+            int slot = policy.victim();
+            if(slot<0) return false;
+            policy.evicted(slot);
+            stat.evictions++;
+            dropSlot(slot,Evicted);
+            return true;
+        }
+
+        void dropSlot(int slot, DropReason reason)
+        {
+            Slot &el = *slots[slot];
+            el.used = false;
+            total_cost -= el.cost;
+            index.remove(el.key);
+            if(drop_proc) drop_proc(el.key,el.value,reason);
+            el.key = K();
+            el.value = V();
+            free_slots.append(slot);
+        }
+
+        POLICY policy;
+        array<Slot*> slots;     //записи по отдельности, чтобы рост массива не сдвигал значения
+        array<int> free_slots;
+        hash<K,int> index;
+
+        uint64 count_limit;
+        uint64 cost_limit;
+        uint64 total_cost = 0;
+
+        cacheStats stat;
+        dropCallback drop_proc;
+    };
+
 } // namespace alt
 
 #endif // PCACHE_H
@@ -28,9 +28,320 @@ SOFTWARE.
 
 #include <type_traits>
 #include "atime.h"
+#include "athread.h"
+#include "aperf.h"
+#include "astring_builder.h"
 
 namespace alt {
 
+// Лог-линейная гистограмма задержек (в духе HdrHistogram): значения в наносекундах,
+// на каждую двоичную октаву SUB_COUNT линейных корзин - погрешность не хуже 1/64.
+class latencyHistogram {
+public:
+    enum {
+        SUB_BITS = 6,
+        SUB_COUNT = 1 << SUB_BITS,
+        MAX_BITS = 44, // ~4.9 часа
+        // 2*SUB_COUNT точных корзин и по SUB_COUNT на октавы 7..MAX_BITS
+        BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT
+    };
+    static constexpr uint64 LIMIT = (1ull << MAX_BITS) - 1;
+
+    void record(uint64 value, uint64 count = 1)
+    {
+        if (!counts_.size())
+            counts_.resize(BUCKETS).fill(0);
+
+        if (value > LIMIT)
+            value = LIMIT;
+
+        counts_()[bucketOf(value)] += count;
+        total_ += count;
+        sum_ += value * count;
+        if (value > max_)
+            max_ = value;
+        if (value < min_)
+            min_ = value;
+    }
+
+    void merge(const latencyHistogram &val)
+    {
+        if (!val.total_)
+            return;
+        if (!counts_.size())
+            counts_.resize(BUCKETS).fill(0);
+
+        uint64 *dst = counts_();
+        const uint64 *src = val.counts_();
+        for (int i = 0; i < BUCKETS; i++)
+            dst[i] += src[i];
+
+        total_ += val.total_;
+        sum_ += val.sum_;
+        if (val.max_ > max_)
+            max_ = val.max_;
+        if (val.min_ < min_)
+            min_ = val.min_;
+    }
+
+    void reset()
+    {
+        if (total_)
+            counts_.fill(0);
+        total_ = 0;
+        sum_ = 0;
+        max_ = 0;
+        min_ = ~0ull;
+    }
+
+    uint64 count() const { return total_; }
+    uint64 sum() const { return sum_; }
+    uint64 max() const { return max_; }
+    uint64 min() const { return total_ ? min_ : 0; }
+    double mean() const { return total_ ? double(sum_) / total_ : 0.0; }
+
+    // p - в процентах (50, 99, 99.9); верхняя граница корзины, не больше max()
+    uint64 percentile(double p) const
+    {
+        if (!total_)
+            return 0;
+        if (p >= 100.0)
+            return max_;
+
+        uint64 target = uint64(p / 100.0 * total_ + 0.5);
+        if (target < 1)
+            target = 1;
+
+        uint64 acc = 0;
+        const uint64 *cnt = counts_();
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            acc += cnt[i];
+            if (acc >= target)
+            {
+                uint64 rv = bucketHigh(i);
+                return rv < max_ ? rv : max_;
+            }
+        }
+        return max_;
+    }
+
+    string toString() const
+    {
+        if (!total_)
+            return "count = 0";
+
+        stringBuilder rv(128);
+        rv.format("count = {}", total_);
+        rv << ", min = "; appendNs(rv, min());
+        rv << ", p50 = "; appendNs(rv, percentile(50.0));
+        rv << ", p90 = "; appendNs(rv, percentile(90.0));
+        rv << ", p99 = "; appendNs(rv, percentile(99.0));
+        rv << ", p99.9 = "; appendNs(rv, percentile(99.9));
+        rv << ", max = "; appendNs(rv, max_);
+        return rv.finish();
+    }
+
+    static void appendNs(stringBuilder &rv, uint64 ns)
+    {
+        if (ns < 1000)
+            rv.format("{} ns", ns);
+        else if (ns < 1000000)
+            rv.format("{:.4g} us", ns / 1e3);
+        else if (ns < 1000000000)
+            rv.format("{:.4g} ms", ns / 1e6);
+        else
+            rv.format("{:.4g} s", ns / 1e9);
+    }
+
+    static string formatNs(uint64 ns)
+    {
+        stringBuilder rv;
+        appendNs(rv, ns);
+        return rv.finish();
+    }
+
+    static constexpr int bucketOf(uint64 value)
+    {
+        if (value < 2 * SUB_COUNT)
+            return int(value);
+        int shift = bitCount(value) - (SUB_BITS + 1);
+        return (shift + 1) * SUB_COUNT + int((value >> shift) - SUB_COUNT);
+    }
+
+    static constexpr uint64 bucketLow(int index)
+    {
+        if (index < 2 * SUB_COUNT)
+            return index;
+        int shift = index / SUB_COUNT - 1;
+        return uint64(index % SUB_COUNT + SUB_COUNT) << shift;
+    }
+
+    static constexpr uint64 bucketHigh(int index)
+    {
+        if (index < 2 * SUB_COUNT)
+            return index;
+        int shift = index / SUB_COUNT - 1;
+        return bucketLow(index) + (1ull << shift) - 1;
+    }
+
+private:
+
+    static constexpr int bitCount(uint64 value)
+    {
+#ifdef __GNUC__
+        return 64 - __builtin_clzll(value);
+#else
+        int rv = 0;
+        while (value)
+        {
+            value >>= 1;
+            rv++;
+        }
+        return rv;
+#endif
+    }
+
+    array<uint64> counts_;
+    uint64 total_ = 0;
+    uint64 sum_ = 0;
+    uint64 max_ = 0;
+    uint64 min_ = ~0ull;
+};
+
+// предельное значение попадает в последнюю корзину, и ее верхняя граница - само значение
+static_assert(latencyHistogram::bucketOf(latencyHistogram::LIMIT) == latencyHistogram::BUCKETS - 1);
+static_assert(latencyHistogram::bucketHigh(latencyHistogram::BUCKETS - 1) == latencyHistogram::LIMIT);
+
+// Многопоточная запись в гистограмму: у каждого потока своя пара гистограмм,
+// запись без блокировок, снимок переключает фазу и ждет только пишущих в старую.
+class latencyRecorder {
+public:
+    explicit latencyRecorder(string name = string())
+        : name_(name), id_(nextId().fetch_add(1) + 1)
+    {
+    }
+
+    ~latencyRecorder()
+    {
+        for (int i = 0; i < slots_.size(); i++)
+            delete slots_[i];
+    }
+
+    latencyRecorder(const latencyRecorder &val) = delete;
+    latencyRecorder& operator=(const latencyRecorder &val) = delete;
+
+    void record(uint64 ns)
+    {
+        Slot *slot = local();
+        slot->busy.store(1, std::memory_order_seq_cst);
+        int phase = phase_.load(std::memory_order_seq_cst);
+        slot->hist[phase].record(ns);
+        slot->busy.store(0, std::memory_order_release);
+    }
+
+    // значения, накопленные с прошлого вызова interval()
+    latencyHistogram interval()
+    {
+        mutex_.lock();
+        drain();
+        latencyHistogram rv = interval_;
+        total_.merge(interval_);
+        interval_.reset();
+        mutex_.unlock();
+        return rv;
+    }
+
+    // все значения с момента создания или reset()
+    latencyHistogram total()
+    {
+        mutex_.lock();
+        drain();
+        latencyHistogram rv = total_;
+        rv.merge(interval_);
+        mutex_.unlock();
+        return rv;
+    }
+
+    void reset()
+    {
+        mutex_.lock();
+        drain();
+        interval_.reset();
+        total_.reset();
+        mutex_.unlock();
+    }
+
+    const string& getName() const { return name_; }
+
+    string toString()
+    {
+        return alt::format("Latency [{}]: {}", name_, interval().toString());
+    }
+
+private:
+
+    struct Slot {
+        std::atomic<int> busy = 0;
+        latencyHistogram hist[2];
+    };
+
+    struct LocalRef {
+        uint64 id;
+        Slot *slot;
+    };
+
+    static std::atomic<uint64>& nextId()
+    {
+        static std::atomic<uint64> counter(0);
+        return counter;
+    }
+
+    Slot* local()
+    {
+        // идентификаторы не переиспользуются, поэтому ссылки на удаленные регистраторы безвредны
+        static thread_local array<LocalRef> refs;
+        for (int i = 0; i < refs.size(); i++)
+        {
+            if (refs[i].id == id_)
+                return refs[i].slot;
+        }
+
+        Slot *slot = new Slot;
+        mutex_.lock();
+        slots_.append(slot);
+        mutex_.unlock();
+
+        LocalRef ref = { id_, slot };
+        refs.append(ref);
+        return slot;
+    }
+
+    // вызывается под mutex_
+    void drain()
+    {
+        int old = phase_.load(std::memory_order_relaxed);
+        phase_.store(old ^ 1, std::memory_order_seq_cst);
+
+        for (int i = 0; i < slots_.size(); i++)
+        {
+            Slot *slot = slots_[i];
+            while (slot->busy.load(std::memory_order_seq_cst))
+                alt::sleep(0);
+            interval_.merge(slot->hist[old]);
+            slot->hist[old].reset();
+        }
+    }
+
+    string name_;
+    uint64 id_;
+    std::atomic<int> phase_ = 0;
+    semaphore mutex_;
+    array<Slot*> slots_;
+    latencyHistogram interval_;
+    latencyHistogram total_;
+};
+
 template<typename T = uint64>
 class profiling {
 public:
@@ -49,14 +360,53 @@ public:
             last_traffic_acc_ = traffic_acc_;
             traffic_acc_ = 0;
 
+            if (counters_)
+                last_counters_ = counters_->interval();
+
             last_sample_count_ = count_;
             time_acc_ = 0.0;
             count_ = 0;
         }
     }
 
+    // гистограмма интервалов для процентилей, по умолчанию выключена
+    void enableHistogram(bool on = true)
+    {
+        histogram_enabled_ = on;
+        if (!on)
+            histogram_.reset();
+    }
+
+    // дополнительно писать интервалы в общий многопоточный регистратор
+    void attach(latencyRecorder *recorder) { recorder_ = recorder; }
+
+    // аппаратные счетчики, снимаемые на каждом интервале start/end (в потоке, открывшем счетчики)
+    void attach(perfCounters *counters)
+    {
+        counters_ = counters;
+        last_counters_ = perfSample();
+        if (counters_)
+            counters_->interval();
+    }
+
+    // сумма счетчиков за последний расчетный период, toString() выводит среднее на замер
+    const perfSample& getCounters() const { return last_counters_; }
+
+    const latencyHistogram& histogram() const { return histogram_; }
+
+    uint64 getPercentile(double p) const { return histogram_.percentile(p); }
+
     void push(double interval, T traffic = 0)
     {
+        if (histogram_enabled_ || recorder_)
+        {
+            uint64 ns = interval > 0.0 ? uint64(interval * 1e6 + 0.5) : 0;
+            if (histogram_enabled_)
+                histogram_.record(ns);
+            if (recorder_)
+                recorder_->record(ns);
+        }
+
         count_++;
         time_acc_ += interval;
 
@@ -72,13 +422,21 @@ public:
 
     void start(T traffic = 0)
     {
-        uint64 now = alt::time::uStamp();
+        uint64 now = alt::time::nStamp();
         if (has_start_)
         {
-            double interval_ms = (now - start_time_) / 1000.0;
+            if (counters_)
+                counters_->stop();
+            double interval_ms = (now - start_time_) / 1000000.0;
             push(interval_ms, traffic);
         }
 
+        //без счетчиков интервалы идут встык; со счетчиками замер начинается после их запуска
+        if (counters_)
+        {
+            counters_->start();
+            now = alt::time::nStamp();
+        }
         start_time_ = now;
         has_start_ = true;
     }
@@ -87,8 +445,10 @@ public:
     {
         if (has_start_)
         {
-            uint64 now = alt::time::uStamp();
-            double interval_ms = (now - start_time_) / 1000.0;
+            uint64 now = alt::time::nStamp();
+            if (counters_)
+                counters_->stop();
+            double interval_ms = (now - start_time_) / 1000000.0;
             push(interval_ms, traffic);
         }
     }
@@ -104,6 +464,12 @@ public:
         traffic_acc_ = 0;
         traffic_average_ = 0.0;
         last_traffic_acc_ = 0;
+
+        histogram_.reset();
+
+        last_counters_ = perfSample();
+        if (counters_)
+            counters_->interval();
     }
 
     double getAverage() const
@@ -139,27 +505,39 @@ public:
 
     string toString() const
     {
-        string rv(256,true);
-        rv += "Profiling [" + name_ + "]: ";
+        stringBuilder rv(256);
+        rv.format("Profiling [{}]: ", name_);
 
         if (last_sample_count_ > 0)
         {
-            rv += "avg = " + string::fromReal(interval_average_,4) + " ms";
+            rv.format("avg = {:.4g} ms", interval_average_);
         }
         else
         {
-            rv += "avg = N/A";
+            rv << "avg = N/A";
         }
 
-        rv += ", events = " + string::fromInt(last_sample_count_)
-            + ", time = " + string::fromReal(time_acc_,4) + " ms";
+        rv.format(", events = {}, time = {:.4g} ms", last_sample_count_, time_acc_);
 
         if (last_sample_count_ > 0 && last_traffic_acc_)
         {
-            rv += ", traffic avg = " +string::fromInt(traffic_average_,2);
+            rv.format(", traffic avg = {:.4g}", traffic_average_);
         }
 
-        return rv;
+        if (histogram_enabled_ && histogram_.count())
+        {
+            rv << ", p50 = "; latencyHistogram::appendNs(rv, histogram_.percentile(50.0));
+            rv << ", p99 = "; latencyHistogram::appendNs(rv, histogram_.percentile(99.0));
+            rv << ", p99.9 = "; latencyHistogram::appendNs(rv, histogram_.percentile(99.9));
+            rv << ", max = "; latencyHistogram::appendNs(rv, histogram_.max());
+        }
+
+        if (counters_ && last_sample_count_ > 0)
+        {
+            rv << ", " << last_counters_.toString(last_sample_count_);
+        }
+
+        return rv.finish();
     }
 
     string toFpsString() const
@@ -211,6 +589,13 @@ private:
 
     uint64 start_time_ = 0;
     bool has_start_ = false;
+
+    bool histogram_enabled_ = false;
+    latencyHistogram histogram_;
+    latencyRecorder *recorder_ = nullptr;
+
+    perfCounters *counters_ = nullptr;
+    perfSample last_counters_;
 };
 
 } // namespace alt
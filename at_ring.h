@@ -231,7 +231,7 @@ namespace alt {
 
             T Get()
             {
-             T rv;
+             T rv{};
                 if(!Size())return rv;
 
                 std::atomic_thread_fence(std::memory_order_acquire);
@@ -28,6 +28,7 @@ SOFTWARE.
 #define AT_TENSOR_H
 
 #include "avariant.h"
+#include "astring_builder.h"
 
 namespace alt {
 
@@ -125,10 +126,10 @@ namespace alt {
                         dimensions<uintz> start = dimensions<uintz>(),
                         dimensions<uintz> end = dimensions<uintz>())
         {
-            string rv;
-
             if(dim.empty()) return "[]";
 
+            stringBuilder rv;
+
             if(start.empty())
                 start.resize(dim.size());
             if(end.empty())
@@ -167,23 +168,19 @@ namespace alt {
                     if(index[i-1]) break;
                     left_count++;
                 }
-                rv += string::mono(' ', index.size()-left_count);
-                rv += string::mono('[', left_count);
+                rv.fill(' ', index.size()-left_count);
+                rv.fill('[', left_count);
 
                 dimensions<uintz> point = start;
                 point += index;
                 T *ptr = &(*this)[point];
                 for(uintz i=0;i<subspace[subspace.size()-1];i++)
                 {
-                    variant tmp(ptr[i]);
-                    if(i)rv+=", ";
+                    string tmp = variant(ptr[i]).toString();
+                    if(i)rv << ", ";
                     if(align)
-                    {
-                        int n = elsize-tmp.toString().size();
-                        if(n)
-                            rv += string::mono(' ', n);
-                    }
-                    rv += tmp.toString();
+                        rv.fill(' ', elsize-tmp.size());
+                    rv << tmp;
                 }
                 int right_count = 1;
                 for(uintz i=index.size()-1;i>0;i--)
@@ -191,11 +188,12 @@ namespace alt {
                     if(index[i-1]!=subspace[i-1]-1) break;
                     right_count++;
                 }
-                rv += string::mono(']', right_count)+"\n";
+                rv.fill(']', right_count);
+                rv << '\n';
             }
             while(index.inc(subspace,dim.size()-2));
 
-            return rv;
+            return rv.finish();
         }
     };
 
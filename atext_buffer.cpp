@@ -0,0 +1,540 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "atext_buffer.h"
+
+#include <string.h>
+#include <atomic>
+#include <new>
+
+using namespace alt;
+
+struct alt::textNode
+{
+    std::atomic<int> refcount;
+    int height; //0 - лист
+    int64 size;
+    int64 lines;
+    textNode *left;
+    textNode *right;
+    char text[1]; //только у листа, size байт
+};
+
+//листы пересобираются до этого размера, правка объединяет соседей, пока не наберется минимум
+static const int LEAF_MAX = 2048;
+static const int LEAF_MIN = LEAF_MAX/4;
+
+static textNode* retain(textNode *node)
+{
+    if(node)node->refcount.fetch_add(1,std::memory_order_relaxed);
+    return node;
+}
+
+static void release(textNode *node)
+{
+    while(node)
+    {
+        if(node->refcount.fetch_sub(1,std::memory_order_acq_rel)!=1)return;
+        textNode *next=node->right;
+        release(node->left);
+        node->~textNode();
+        ::operator delete(node);
+        node=next;
+    }
+}
+
+//владеющая ссылка на узел
+class nodeRef
+{
+public:
+    nodeRef() : ptr(nullptr) {}
+    nodeRef(const nodeRef &val) : ptr(retain(val.ptr)) {}
+    ~nodeRef() {release(ptr);}
+
+    nodeRef& operator=(const nodeRef &val)
+    {
+        textNode *tmp=retain(val.ptr);
+        release(ptr);
+        ptr=tmp;
+        return *this;
+    }
+
+    static nodeRef adopt(textNode *val)
+    {
+        nodeRef rv;
+        rv.ptr=val;
+        return rv;
+    }
+    static nodeRef share(textNode *val)
+    {
+        return adopt(retain(val));
+    }
+    textNode* take()
+    {
+        textNode *rv=ptr;
+        ptr=nullptr;
+        return rv;
+    }
+
+    textNode* operator->() const {return ptr;}
+    textNode* get() const {return ptr;}
+    explicit operator bool() const {return ptr!=nullptr;}
+
+private:
+    textNode *ptr;
+};
+
+static __inline int nodeHeight(const textNode *node)
+{
+    return node ? node->height : -1;
+}
+
+static nodeRef makeLeaf(const char *data, int size)
+{
+    textNode *rv=new(::operator new(sizeof(textNode)+size)) textNode;
+    rv->refcount.store(1,std::memory_order_relaxed);
+    rv->height=0;
+    rv->size=size;
+    rv->left=rv->right=nullptr;
+    ::memcpy(rv->text,data,size);
+    int64 lines=0;
+    for(int i=0;i<size;i++)
+        lines+=data[i]=='\n';
+    rv->lines=lines;
+    return nodeRef::adopt(rv);
+}
+
+static nodeRef makeNode(const nodeRef &left, const nodeRef &right)
+{
+    textNode *rv=new(::operator new(sizeof(textNode))) textNode;
+    rv->refcount.store(1,std::memory_order_relaxed);
+    rv->height=(left->height>right->height ? left->height : right->height)+1;
+    rv->size=left->size+right->size;
+    rv->lines=left->lines+right->lines;
+    rv->left=retain(left.get());
+    rv->right=retain(right.get());
+    return nodeRef::adopt(rv);
+}
+
+//узел из поддеревьев с разницей высот не больше двух, с поворотом при необходимости
+static nodeRef balanced(const nodeRef &left, const nodeRef &right)
+{
+    int hl=nodeHeight(left.get()), hr=nodeHeight(right.get());
+    if(hl>hr+1)
+    {
+        nodeRef ll=nodeRef::share(left->left), lr=nodeRef::share(left->right);
+        if(nodeHeight(ll.get())>=nodeHeight(lr.get()))
+            return makeNode(ll,makeNode(lr,right));
+        nodeRef lrl=nodeRef::share(lr->left), lrr=nodeRef::share(lr->right);
+        return makeNode(makeNode(ll,lrl),makeNode(lrr,right));
+    }
+    if(hr>hl+1)
+    {
+        nodeRef rl=nodeRef::share(right->left), rr=nodeRef::share(right->right);
+        if(nodeHeight(rr.get())>=nodeHeight(rl.get()))
+            return makeNode(makeNode(left,rl),rr);
+        nodeRef rll=nodeRef::share(rl->left), rlr=nodeRef::share(rl->right);
+        return makeNode(makeNode(left,rll),makeNode(rlr,rr));
+    }
+    return makeNode(left,right);
+}
+
+//конкатенация: спуск по краю более высокого дерева до равной высоты
+static nodeRef join(const nodeRef &left, const nodeRef &right)
+{
+    if(!left)return right;
+    if(!right)return left;
+    if(left->height>right->height+1)
+        return balanced(nodeRef::share(left->left),join(nodeRef::share(left->right),right));
+    if(right->height>left->height+1)
+        return balanced(join(left,nodeRef::share(right->left)),nodeRef::share(right->right));
+    return makeNode(left,right);
+}
+
+//разрез на [0,pos) и [pos,size); по границе листа байты не копируются
+static void split(const nodeRef &node, int64 pos, nodeRef &left, nodeRef &right)
+{
+    if(!node || pos<=0)
+    {
+        left=nodeRef();
+        right=node;
+        return;
+    }
+    if(pos>=node->size)
+    {
+        left=node;
+        right=nodeRef();
+        return;
+    }
+    if(!node->height)
+    {
+        left=makeLeaf(node->text,int(pos));
+        right=makeLeaf(node->text+pos,int(node->size-pos));
+        return;
+    }
+    nodeRef part;
+    if(pos<node->left->size)
+    {
+        split(nodeRef::share(node->left),pos,left,part);
+        right=join(part,nodeRef::share(node->right));
+    }
+    else
+    {
+        split(nodeRef::share(node->right),pos-node->left->size,part,right);
+        left=join(nodeRef::share(node->left),part);
+    }
+}
+
+//сбалансированное дерево из листов почти равного размера
+static nodeRef buildRange(const char *data, int64 size, int64 leaves)
+{
+    if(leaves==1)return makeLeaf(data,int(size));
+    int64 half=leaves/2;
+    int64 lsize=size/leaves*half+size%leaves*half/leaves;
+    return makeNode(buildRange(data,lsize,half),buildRange(data+lsize,size-lsize,leaves-half));
+}
+
+static nodeRef build(const char *data, int64 size)
+{
+    if(size<=0)return nodeRef();
+    return buildRange(data,size,(size+LEAF_MAX-1)/LEAF_MAX);
+}
+
+//границы листа, содержащего pos (0<=pos<size)
+static void leafRange(const textNode *node, int64 pos, int64 &start, int64 &end)
+{
+    int64 base=0;
+    while(node->height)
+    {
+        if(pos<node->left->size)node=node->left;
+        else
+        {
+            pos-=node->left->size;
+            base+=node->left->size;
+            node=node->right;
+        }
+    }
+    start=base;
+    end=base+node->size;
+}
+
+//замена листа, начинающегося с pos, с копированием пути от корня
+static nodeRef replaceLeaf(const textNode *node, int64 pos, const nodeRef &leaf)
+{
+    if(!node->height)return leaf;
+    if(pos<node->left->size)
+        return makeNode(replaceLeaf(node->left,pos,leaf),nodeRef::share(node->right));
+    return makeNode(nodeRef::share(node->left),replaceLeaf(node->right,pos-node->left->size,leaf));
+}
+
+static void copyOut(const textNode *node, int64 from, int64 count, char *dst)
+{
+    while(count>0)
+    {
+        if(!node->height)
+        {
+            ::memcpy(dst,node->text+from,count);
+            return;
+        }
+        int64 lsize=node->left->size;
+        if(from<lsize)
+        {
+            int64 part = count<lsize-from ? count : lsize-from;
+            copyOut(node->left,from,part,dst);
+            dst+=part;
+            count-=part;
+            from=0;
+        }
+        else from-=lsize;
+        node=node->right;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+textBuffer::textBuffer()
+{
+    root=nullptr;
+}
+
+textBuffer::textBuffer(const string &text)
+{
+    root=build(text(),text.size()).take();
+}
+
+textBuffer::textBuffer(const byteArray &data)
+{
+    root=build((const char*)data(),data.size()).take();
+}
+
+textBuffer::textBuffer(const char *data, int64 size)
+{
+    root=build(data,size).take();
+}
+
+textBuffer::textBuffer(const textBuffer &val)
+{
+    root=retain(val.root);
+}
+
+textBuffer::~textBuffer()
+{
+    release(root);
+}
+
+textBuffer& textBuffer::operator=(const textBuffer &val)
+{
+    textNode *tmp=retain(val.root);
+    release(root);
+    root=tmp;
+    return *this;
+}
+
+int64 textBuffer::size() const
+{
+    return root ? root->size : 0;
+}
+
+int64 textBuffer::lineCount() const
+{
+    return root ? root->lines+1 : 1;
+}
+
+int textBuffer::height() const
+{
+    return nodeHeight(root)+1;
+}
+
+void textBuffer::clear()
+{
+    release(root);
+    root=nullptr;
+}
+
+void textBuffer::replace(int64 pos, int64 count, const char *data, int64 size)
+{
+    int64 total=this->size();
+    if(pos<0)pos=0;
+    if(pos>total)pos=total;
+    if(count<0 || count>total-pos)count=total-pos;
+    if(size<0)size=0;
+    if(!count && !size)return;
+
+    //держим старое дерево: data может указывать в его листы
+    nodeRef cur=nodeRef::share(root);
+
+    //правка пересобирается вместе с крайними листами, мелкие куски - вместе с соседями
+    int64 from=0, to=0, start, end;
+    if(total)
+    {
+        leafRange(cur.get(),pos<total ? pos : total-1,from,to);
+        if(count)leafRange(cur.get(),pos+count-1,start,to);
+        if(to-from-count+size<LEAF_MIN && from>0)
+            leafRange(cur.get(),from-1,from,end);
+        if(to-from-count+size<LEAF_MIN && to<total)
+            leafRange(cur.get(),to,start,to);
+    }
+
+    int64 head=pos-from, tail=to-pos-count;
+    int64 msize=head+size+tail;
+    char *buff=new char[msize ? msize : 1];
+    if(head)copyOut(cur.get(),from,head,buff);
+    if(size)::memcpy(buff+head,data,size);
+    if(tail)copyOut(cur.get(),pos+count,tail,buff+head+size);
+
+    nodeRef rv;
+    if(total)leafRange(cur.get(),from,start,end);
+    if(total && end==to && msize && msize<=LEAF_MAX)
+    {
+        //правка внутри одного листа: высота не меняется, достаточно копии пути
+        rv=replaceLeaf(cur.get(),from,makeLeaf(buff,int(msize)));
+    }
+    else
+    {
+        nodeRef left, rest, mid, right;
+        split(cur,from,left,rest);
+        split(rest,to-from,mid,right);
+        rv=join(join(left,build(buff,msize)),right);
+    }
+    delete []buff;
+
+    release(root);
+    root=rv.take();
+}
+
+char textBuffer::at(int64 pos) const
+{
+    if(pos<0 || pos>=size())return 0;
+    const textNode *node=root;
+    while(node->height)
+    {
+        if(pos<node->left->size)node=node->left;
+        else
+        {
+            pos-=node->left->size;
+            node=node->right;
+        }
+    }
+    return node->text[pos];
+}
+
+int64 textBuffer::read(int64 pos, char *dst, int64 count) const
+{
+    int64 total=size();
+    if(pos<0)pos=0;
+    if(pos>=total || count<=0)return 0;
+    if(count>total-pos)count=total-pos;
+    copyOut(root,pos,count,dst);
+    return count;
+}
+
+string textBuffer::mid(int64 pos, int64 count) const
+{
+    int64 total=size();
+    if(pos<0)pos=0;
+    if(pos>=total || count<=0)return string();
+    if(count>total-pos)count=total-pos;
+    string rv(int(count),false);
+    copyOut(root,pos,count,rv());
+    return rv;
+}
+
+int64 textBuffer::lineOffset(int64 line) const
+{
+    if(line<=0)return line ? -1 : 0;
+    if(line>=lineCount())return -1;
+
+    //позиция после line-го перевода строки
+    const textNode *node=root;
+    int64 base=0;
+    while(node->height)
+    {
+        if(line<=node->left->lines)node=node->left;
+        else
+        {
+            line-=node->left->lines;
+            base+=node->left->size;
+            node=node->right;
+        }
+    }
+    const char *text=node->text, *end=text+node->size;
+    while(text<end)
+    {
+        text=(const char*)::memchr(text,'\n',end-text);
+        if(!text)break;
+        text++;
+        if(!--line)return base+(text-node->text);
+    }
+    return -1;
+}
+
+int64 textBuffer::lineAt(int64 pos) const
+{
+    if(pos<=0 || !root)return 0;
+    if(pos>=root->size)return root->lines;
+
+    const textNode *node=root;
+    int64 rv=0;
+    while(node->height)
+    {
+        if(pos<node->left->size)node=node->left;
+        else
+        {
+            pos-=node->left->size;
+            rv+=node->left->lines;
+            node=node->right;
+        }
+    }
+    const char *text=node->text;
+    for(int64 i=0;i<pos;i++)
+        rv+=text[i]=='\n';
+    return rv;
+}
+
+string textBuffer::line(int64 index) const
+{
+    int64 from=lineOffset(index);
+    if(from<0)return string();
+    int64 to=lineOffset(index+1);
+    if(to<0)to=size();
+    else to--;
+    return mid(from,to-from);
+}
+
+string textBuffer::toString() const
+{
+    return mid(0,size());
+}
+
+byteArray textBuffer::toByteArray() const
+{
+    byteArray rv((int)size());
+    if(root)copyOut(root,0,root->size,(char*)rv());
+    return rv;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+textBuffer::chunkIterator::chunkIterator(const textBuffer &text, int64 pos)
+    : snapshot(text)
+{
+    depth=0;
+    skip=0;
+    const textNode *node=snapshot.root;
+    if(!node || pos>=node->size)return;
+    if(pos<0)pos=0;
+
+    //правые поддеревья пути до листа с pos - очередь обхода
+    while(node->height)
+    {
+        if(pos<node->left->size)
+        {
+            stack[depth++]=node->right;
+            node=node->left;
+        }
+        else
+        {
+            pos-=node->left->size;
+            node=node->right;
+        }
+    }
+    stack[depth++]=node;
+    skip=int(pos);
+}
+
+bool textBuffer::chunkIterator::next(stringRef &chunk)
+{
+    if(!depth)return false;
+    const textNode *node=stack[--depth];
+    while(node->height)
+    {
+        stack[depth++]=node->right;
+        node=node->left;
+    }
+    chunk=stringRef(node->text+skip,int(node->size-skip));
+    skip=0;
+    return true;
+}
@@ -0,0 +1,126 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ATEXT_BUFFER_H
+#define ATEXT_BUFFER_H
+
+#include "atypes.h"
+#include "astring.h"
+#include "abyte_array.h"
+
+// Текст для больших редактируемых документов: AVL дерево конкатенации над листами до 2 КБ.
+// Вставка и удаление - O(log n) плюс пересборка одного-трех листов вокруг правки.
+// Узлы хранят число байт и переводов строк, так что смещение строки и номер строки
+// по смещению находятся спуском по дереву. Узлы неизменяемы и разделяются между копиями:
+// копия буфера - это снимок за O(1), изменение копирует только путь от корня.
+// Снимки можно читать из других потоков, пока исходный буфер редактируется.
+
+namespace alt {
+
+    struct textNode;
+
+    class textBuffer
+    {
+    public:
+        textBuffer();
+        textBuffer(const string &text);
+        textBuffer(const byteArray &data);
+        textBuffer(const char *data, int64 size);
+        textBuffer(const textBuffer &val);
+        ~textBuffer();
+
+        textBuffer& operator=(const textBuffer &val);
+
+        int64 size() const;
+        bool isEmpty() const {return !root;}
+        //переводов строки плюс один
+        int64 lineCount() const;
+
+        //позиции за пределами текста приводятся к его границам
+        void replace(int64 pos, int64 count, const char *data, int64 size);
+        void replace(int64 pos, int64 count, const string &text) {replace(pos,count,text(),text.size());}
+        void insert(int64 pos, const char *data, int64 size) {replace(pos,0,data,size);}
+        void insert(int64 pos, const string &text) {replace(pos,0,text(),text.size());}
+        void append(const string &text) {replace(size(),0,text(),text.size());}
+        void remove(int64 pos, int64 count) {replace(pos,count,nullptr,0);}
+        void clear();
+
+        char at(int64 pos) const;
+        //копирование участка, возвращает число скопированных байт
+        int64 read(int64 pos, char *dst, int64 count) const;
+        string mid(int64 pos, int64 count) const;
+
+        //смещение начала строки (-1 за пределами текста) и номер строки по смещению
+        int64 lineOffset(int64 line) const;
+        int64 lineAt(int64 pos) const;
+        //строка без завершающего перевода
+        string line(int64 index) const;
+
+        string toString() const;
+        byteArray toByteArray() const;
+
+        //обход кусками от смещения pos
+        class chunkIterator;
+        //fun(stringRef) возвращает false для остановки
+        template<typename F>
+        void forEachChunk(F fun, int64 pos=0) const;
+
+        //высота дерева, для диагностики
+        int height() const;
+
+    private:
+
+        textNode *root;
+    };
+
+    //итератор держит снимок, поэтому куски остаются действительными и после изменения буфера
+    class textBuffer::chunkIterator
+    {
+    public:
+        explicit chunkIterator(const textBuffer &text, int64 pos=0);
+        bool next(stringRef &chunk);
+
+    private:
+        textBuffer snapshot;
+        const textNode *stack[96];
+        int depth;
+        int skip;
+    };
+
+    template<typename F>
+    void textBuffer::forEachChunk(F fun, int64 pos) const
+    {
+        chunkIterator it(*this,pos);
+        stringRef chunk;
+        while(it.next(chunk))
+        {
+            if(!fun(chunk))break;
+        }
+    }
+
+} //namespace alt
+
+#endif // ATEXT_BUFFER_H
@@ -27,9 +27,236 @@ SOFTWARE.
 #include "athread.h"
 #include <stdexcept>
 #include <iostream>
+#include <stdio.h>
+#include <chrono>
 
 using namespace alt;
 
+alt::array<int> cpuTopology::parseList(const char *list)
+{
+    alt::array<int> rv;
+    if(!list)
+        return rv;
+
+    const char *p = list;
+    while(*p)
+    {
+        if(*p<'0' || *p>'9')
+        {
+            p++;
+            continue;
+        }
+        int from = 0;
+        while(*p>='0' && *p<='9')
+            from = from*10 + (*p++ - '0');
+        int to = from;
+        if(*p=='-')
+        {
+            p++;
+            to = 0;
+            while(*p>='0' && *p<='9')
+                to = to*10 + (*p++ - '0');
+        }
+        for(int i=from;i<=to;i++)
+            rv.append(i);
+    }
+    return rv;
+}
+
+int cpuTopology::cpuCount()
+{
+    return cpus().size();
+}
+
+int cpuTopology::nodeCount()
+{
+    return nodes().size();
+}
+
+int cpuTopology::currentNode()
+{
+    int cpu = currentCpu();
+    if(cpu<0)
+        return -1;
+    return cpuNode(cpu);
+}
+
+bool thread::attributesApplied()
+{
+    //параметры из конструктора применяет сам поток при старте
+    while(attributesState()<0)
+        sleep(0);
+    return attributesState()>0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int syncSpinCount = 64;
+
+void mutex::lockSlow()
+{
+    //короткая секция владельца: дождаться его в пространстве пользователя
+    int limit = spin_limit.load(std::memory_order_relaxed);
+    for(int i=0;i<limit;i++)
+    {
+        cpuRelax();
+        uint32 c = state.load(std::memory_order_relaxed);
+        if(!c && state.compare_exchange_weak(c,1,std::memory_order_acquire))
+        {
+            //удачное ожидание - предел тянется к удвоенному фактическому
+            int target = i*2+16;
+            if(target>1000)
+                target = 1000;
+            spin_limit.store(limit+(target-limit)/8,std::memory_order_relaxed);
+            return;
+        }
+    }
+    if(limit>8)
+        spin_limit.store(limit-limit/8,std::memory_order_relaxed);
+
+    uint32 c = state.exchange(2,std::memory_order_acquire);
+    while(c)
+    {
+        futexWait(state,2);
+        c = state.exchange(2,std::memory_order_acquire);
+    }
+}
+
+void rwlock::lockSharedSlow()
+{
+    int spins = 0;
+    for(;;)
+    {
+        uint32 st = state.load(std::memory_order_relaxed);
+        if(!(st & (WRITER|WAITERS_MASK)))
+        {
+            if(state.compare_exchange_weak(st,st+1,std::memory_order_acquire))
+                return;
+            continue;
+        }
+        if(spins<syncSpinCount)
+        {
+            spins++;
+            cpuRelax();
+            continue;
+        }
+        if(!(st & SLEEPERS) && !state.compare_exchange_weak(st,st|SLEEPERS,std::memory_order_relaxed))
+            continue;
+        futexWait(state,st|SLEEPERS);
+    }
+}
+
+void rwlock::lockSlow()
+{
+    //ждущий писатель сразу закрывает вход новым читателям
+    state.fetch_add(WAITER_ONE,std::memory_order_relaxed);
+
+    int spins = 0;
+    for(;;)
+    {
+        uint32 st = state.load(std::memory_order_relaxed);
+        if(!(st & (WRITER|READERS_MASK)))
+        {
+            if(state.compare_exchange_weak(st,(st-WAITER_ONE)|WRITER,std::memory_order_acquire))
+                return;
+            continue;
+        }
+        if(spins<syncSpinCount)
+        {
+            spins++;
+            cpuRelax();
+            continue;
+        }
+        if(!(st & SLEEPERS) && !state.compare_exchange_weak(st,st|SLEEPERS,std::memory_order_relaxed))
+            continue;
+        futexWait(state,st|SLEEPERS);
+    }
+}
+
+void rwlock::wakeSleepers()
+{
+    state.fetch_and(~uint32(SLEEPERS),std::memory_order_relaxed);
+    futexWakeAll(state);
+}
+
+bool countingSemaphore::acquireSlow(int64 us)
+{
+    for(int i=0;i<syncSpinCount;i++)
+    {
+        cpuRelax();
+        if(tryAcquire())
+            return true;
+    }
+
+    auto deadline = std::chrono::steady_clock::now()+std::chrono::microseconds(us>0 ? us : 0);
+    waiters.fetch_add(1,std::memory_order_seq_cst);
+    for(;;)
+    {
+        if(tryAcquire())
+            break;
+
+        int64 left = -1;
+        if(us>=0)
+        {
+            left = std::chrono::duration_cast<std::chrono::microseconds>(
+                        deadline-std::chrono::steady_clock::now()).count();
+            if(left<=0)
+            {
+                waiters.fetch_sub(1,std::memory_order_relaxed);
+                return false;
+            }
+        }
+        futexWait(count,0,left);
+    }
+    waiters.fetch_sub(1,std::memory_order_relaxed);
+    return true;
+}
+
+void latch::wait()
+{
+    for(int i=0;i<syncSpinCount && count.load(std::memory_order_acquire);i++)
+        cpuRelax();
+
+    uint32 c;
+    while((c = count.load(std::memory_order_acquire)))
+        futexWait(count,c);
+}
+
+bool barrier::arriveAndWait()
+{
+    return arrive(false);
+}
+
+void barrier::arriveAndDrop()
+{
+    arrive(true);
+}
+
+bool barrier::arrive(bool drop)
+{
+    if(drop)
+        dropped.fetch_add(1,std::memory_order_relaxed);
+
+    uint32 ph = current.load(std::memory_order_acquire);
+    if(arrived.fetch_add(1,std::memory_order_acq_rel)+1==expected.load(std::memory_order_relaxed))
+    {
+        //выбывшие перестают учитываться со следующей фазы
+        expected.fetch_sub(dropped.exchange(0,std::memory_order_relaxed),std::memory_order_relaxed);
+        arrived.store(0,std::memory_order_relaxed);
+        current.fetch_add(1,std::memory_order_release);
+        futexWakeAll(current);
+        return true;
+    }
+    if(drop)
+        return false;
+
+    for(int i=0;i<syncSpinCount && current.load(std::memory_order_acquire)==ph;i++)
+        cpuRelax();
+    while(current.load(std::memory_order_acquire)==ph)
+        futexWait(current,ph);
+    return false;
+}
+
 thread_local alt::array<sharedArrayInternal*>* sharedArrays::ptr = nullptr;
 std::atomic<int> sharedArrays::initialized(0);
 
@@ -141,6 +368,424 @@ void sharedArrays::cleanup()
     mutex.unlock();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+
+namespace alt {
+
+    struct bufferPoolCore
+    {
+        static const int maxClasses = 40;
+
+        struct alignas(64) sizeClass
+        {
+            std::atomic<uint64> depot = 0;  //вершина стека с тегом против ABA
+            std::atomic<int64> cached = 0;
+            std::atomic<int64> inUse = 0;
+            std::atomic<int64> peak = 0;
+        };
+
+        int minLog2, maxLog2;
+        std::atomic<int64> refs = 1;        //пул, кэши потоков и выданные буферы
+        std::atomic<bool> closing = false;
+
+        sizeClass classes[maxClasses];
+
+        //заголовки без памяти; заголовки не удаляются до смерти ядра,
+        //поэтому чтение next у снятого чужим потоком узла безопасно
+        std::atomic<uint64> spare = 0;
+        std::atomic<sharedArrayInternal*> all = nullptr;
+
+        std::atomic<uint64> acquires = 0;
+        std::atomic<uint64> hits = 0;
+        std::atomic<uint64> allocations = 0;
+        std::atomic<uint64> oversize = 0;
+        std::atomic<uint64> trimmed = 0;
+        std::atomic<int64> oversizeInUse = 0;
+        std::atomic<int64> oversizeBytes = 0;
+
+        ~bufferPoolCore()
+        {
+            sharedArrayInternal *item = all.load(std::memory_order_acquire);
+            while(item)
+            {
+                sharedArrayInternal *next = item->all_next;
+                delete item;
+                item = next;
+            }
+        }
+
+        int classCount() const
+        {
+            return maxLog2-minLog2+1;
+        }
+
+        uintz classSize(int cls) const
+        {
+            return uintz(1)<<(minLog2+cls);
+        }
+
+        //-1 - больше старшего класса
+        int classOf(uintz size) const
+        {
+            int log2 = minLog2;
+            while(log2<=maxLog2 && (uintz(1)<<log2)<size)
+                log2++;
+            return log2>maxLog2 ? -1 : log2-minLog2;
+        }
+
+        //кэш потока на класс: около мегабайта, но от 1 до 32 буферов
+        int cacheLimit(int cls) const
+        {
+            int log2 = minLog2+cls;
+            if(log2>=20)
+                return 1;
+            int rv = 1<<(20-log2);
+            return rv>32 ? 32 : rv;
+        }
+
+        void unref()
+        {
+            if(refs.fetch_sub(1,std::memory_order_acq_rel)==1)
+                delete this;
+        }
+    };
+
+} // namespace alt
+
+namespace {
+
+    const int poolTagShift = sizeof(void*)==8 ? 48 : 32;
+    const uint64 poolPtrMask = (uint64(1)<<poolTagShift)-1;
+
+    void poolPush(std::atomic<uint64> &top, sharedArrayInternal *item)
+    {
+        uint64 old = top.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            item->next.store((sharedArrayInternal*)uintptr_t(old&poolPtrMask),std::memory_order_relaxed);
+            uint64 val = uint64(uintptr_t(item)) | (((old>>poolTagShift)+1)<<poolTagShift);
+            if(top.compare_exchange_weak(old,val,std::memory_order_release,std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    sharedArrayInternal* poolPop(std::atomic<uint64> &top)
+    {
+        uint64 old = top.load(std::memory_order_acquire);
+        for(;;)
+        {
+            sharedArrayInternal *item = (sharedArrayInternal*)uintptr_t(old&poolPtrMask);
+            if(!item)
+                return nullptr;
+            sharedArrayInternal *next = item->next.load(std::memory_order_relaxed);
+            uint64 val = uint64(uintptr_t(next)) | (((old>>poolTagShift)+1)<<poolTagShift);
+            if(top.compare_exchange_weak(old,val,std::memory_order_acquire,std::memory_order_acquire))
+                return item;
+        }
+    }
+
+    struct bufferThreadCache
+    {
+        bufferPoolCore *core;
+        alt::array<sharedArrayInternal*> lists[bufferPoolCore::maxClasses];
+
+        //оставить в кэше класса не больше keep буферов
+        void flush(int cls, int keep)
+        {
+            alt::array<sharedArrayInternal*> &list = lists[cls];
+            int count = 0;
+            while(list.size()>keep)
+            {
+                poolPush(core->classes[cls].depot,list.last());
+                list.pop();
+                count++;
+            }
+            if(count)
+                core->classes[cls].cached.fetch_add(count,std::memory_order_relaxed);
+        }
+
+        void flushAll()
+        {
+            for(int i=0;i<core->classCount();i++)
+                flush(i,0);
+        }
+    };
+
+    struct bufferThreadCaches
+    {
+        alt::array<bufferThreadCache*> list;
+
+        ~bufferThreadCaches()
+        {
+            for(int i=0;i<list.size();i++)
+            {
+                list[i]->flushAll();
+                list[i]->core->unref();
+                delete list[i];
+            }
+        }
+
+        bufferThreadCache* find(bufferPoolCore *core, bool create)
+        {
+            for(int i=0;i<list.size();i++)
+            {
+                if(list[i]->core==core)
+                    return list[i];
+            }
+            if(!create)
+                return nullptr;
+            bufferThreadCache *rv = new bufferThreadCache;
+            rv->core = core;
+            core->refs.fetch_add(1,std::memory_order_relaxed);
+            list.append(rv);
+            return rv;
+        }
+    };
+
+    thread_local bufferThreadCaches poolThreadCaches;
+
+    //заголовок из запаса или новый (без памяти буфера)
+    sharedArrayInternal* poolNewItem(bufferPoolCore *core)
+    {
+        sharedArrayInternal *item = poolPop(core->spare);
+        if(item)
+            return item;
+
+        item = new sharedArrayInternal;
+        item->core = core;
+        sharedArrayInternal *head = core->all.load(std::memory_order_relaxed);
+        do
+        {
+            item->all_next = head;
+        }
+        while(!core->all.compare_exchange_weak(head,item,std::memory_order_release,std::memory_order_relaxed));
+        return item;
+    }
+
+    //освободить память буфера, заголовок - в запас
+    uint64 poolDropBuffer(bufferPoolCore *core, sharedArrayInternal *item)
+    {
+        uint64 rv = item->buffer.allocated();
+        item->buffer = alt::array<uint8>();
+        poolPush(core->spare,item);
+        return rv;
+    }
+
+}
+
+void alt::bufferPoolRecycle(sharedArrayInternal *item)
+{
+    bufferPoolCore *core = item->core;
+    int cls = item->sizeClass;
+
+    if(cls<0)
+    {
+        core->oversizeInUse.fetch_sub(1,std::memory_order_relaxed);
+        core->oversizeBytes.fetch_sub(item->buffer.allocated(),std::memory_order_relaxed);
+        poolDropBuffer(core,item);
+    }
+    else
+    {
+        core->classes[cls].inUse.fetch_sub(1,std::memory_order_relaxed);
+        if(core->closing.load(std::memory_order_relaxed))
+        {
+            poolDropBuffer(core,item);
+        }
+        else
+        {
+            bufferThreadCache *cache = poolThreadCaches.find(core,true);
+            cache->lists[cls].append(item);
+            int limit = core->cacheLimit(cls);
+            if(cache->lists[cls].size()>limit)
+                cache->flush(cls,limit/2);
+        }
+    }
+    core->unref();
+}
+
+bufferPool::bufferPool(int minLog2, int maxLog2)
+{
+    if(minLog2<0) minLog2 = 0;
+    if(maxLog2>int(sizeof(uintz)*8)-2) maxLog2 = sizeof(uintz)*8-2;
+    if(maxLog2<minLog2) maxLog2 = minLog2;
+    if(maxLog2-minLog2>=bufferPoolCore::maxClasses) minLog2 = maxLog2-bufferPoolCore::maxClasses+1;
+
+    core = new bufferPoolCore;
+    core->minLog2 = minLog2;
+    core->maxLog2 = maxLog2;
+}
+
+bufferPool::~bufferPool()
+{
+    //выданные буферы и кэши других потоков держат ядро, пока не вернутся
+    purge();
+    core->closing.store(true,std::memory_order_relaxed);
+    core->unref();
+}
+
+bufferPool& bufferPool::global()
+{
+    static bufferPool pool;
+    return pool;
+}
+
+sharedArrayRef bufferPool::acquire(uintz size)
+{
+    core->refs.fetch_add(1,std::memory_order_relaxed);
+    core->acquires.fetch_add(1,std::memory_order_relaxed);
+
+    int cls = core->classOf(size);
+    sharedArrayInternal *item = nullptr;
+    if(cls>=0)
+    {
+        bufferPoolCore::sizeClass &sc = core->classes[cls];
+
+        bufferThreadCache *cache = poolThreadCaches.find(core,true);
+        if(cache->lists[cls].size())
+        {
+            item = cache->lists[cls].last();
+            cache->lists[cls].pop();
+        }
+        else
+        {
+            item = poolPop(sc.depot);
+            if(item)
+                sc.cached.fetch_sub(1,std::memory_order_relaxed);
+        }
+        if(item)
+            core->hits.fetch_add(1,std::memory_order_relaxed);
+
+        int64 used = sc.inUse.fetch_add(1,std::memory_order_relaxed)+1;
+        int64 peak = sc.peak.load(std::memory_order_relaxed);
+        while(used>peak && !sc.peak.compare_exchange_weak(peak,used,std::memory_order_relaxed));
+    }
+    else
+    {
+        core->oversize.fetch_add(1,std::memory_order_relaxed);
+        core->oversizeInUse.fetch_add(1,std::memory_order_relaxed);
+    }
+
+    if(!item)
+    {
+        item = poolNewItem(core);
+        item->sizeClass = cls;
+        item->buffer.resize(cls>=0 ? core->classSize(cls) : size,false);
+        core->allocations.fetch_add(1,std::memory_order_relaxed);
+        if(cls<0)
+            core->oversizeBytes.fetch_add(item->buffer.allocated(),std::memory_order_relaxed);
+    }
+
+    item->buffer.resize(size,false);
+    return sharedArrayRef(item);
+}
+
+void bufferPool::reserve(uintz size, int count)
+{
+    int cls = core->classOf(size);
+    if(cls<0)
+        return;
+    for(int i=0;i<count;i++)
+    {
+        sharedArrayInternal *item = poolNewItem(core);
+        item->sizeClass = cls;
+        item->buffer.resize(core->classSize(cls),false);
+        core->allocations.fetch_add(1,std::memory_order_relaxed);
+        poolPush(core->classes[cls].depot,item);
+        core->classes[cls].cached.fetch_add(1,std::memory_order_relaxed);
+    }
+}
+
+bufferPoolStats bufferPool::stats() const
+{
+    bufferPoolStats rv;
+    rv.acquires = core->acquires.load(std::memory_order_relaxed);
+    rv.hits = core->hits.load(std::memory_order_relaxed);
+    rv.allocations = core->allocations.load(std::memory_order_relaxed);
+    rv.oversize = core->oversize.load(std::memory_order_relaxed);
+    rv.trimmed = core->trimmed.load(std::memory_order_relaxed);
+
+    int64 over = core->oversizeInUse.load(std::memory_order_relaxed);
+    rv.inUse = over>0 ? over : 0;
+    int64 over_bytes = core->oversizeBytes.load(std::memory_order_relaxed);
+    rv.bytesInUse = over_bytes>0 ? over_bytes : 0;
+
+    for(int i=0;i<core->classCount();i++)
+    {
+        const bufferPoolCore::sizeClass &sc = core->classes[i];
+        int64 used = sc.inUse.load(std::memory_order_relaxed);
+        int64 cached = sc.cached.load(std::memory_order_relaxed);
+        int64 peak = sc.peak.load(std::memory_order_relaxed);
+        if(used<0) used = 0;
+        if(cached<0) cached = 0;
+
+        rv.inUse += used;
+        rv.bytesInUse += used*core->classSize(i);
+        rv.cached += cached;
+        rv.bytesCached += cached*core->classSize(i);
+        rv.highWater += peak;
+        rv.bytesHighWater += peak*core->classSize(i);
+    }
+    return rv;
+}
+
+uint64 bufferPool::trim()
+{
+    uint64 rv = 0;
+    for(int i=0;i<core->classCount();i++)
+    {
+        bufferPoolCore::sizeClass &sc = core->classes[i];
+        int64 used = sc.inUse.load(std::memory_order_relaxed);
+        int64 keep = sc.peak.exchange(used,std::memory_order_relaxed)-used;
+        while(sc.cached.load(std::memory_order_relaxed)>keep)
+        {
+            sharedArrayInternal *item = poolPop(sc.depot);
+            if(!item)
+                break;
+            sc.cached.fetch_sub(1,std::memory_order_relaxed);
+            rv += poolDropBuffer(core,item);
+        }
+    }
+    core->trimmed.fetch_add(rv,std::memory_order_relaxed);
+    return rv;
+}
+
+uint64 bufferPool::purge()
+{
+    flushThreadCache();
+
+    uint64 rv = 0;
+    for(int i=0;i<core->classCount();i++)
+    {
+        bufferPoolCore::sizeClass &sc = core->classes[i];
+        while(sharedArrayInternal *item = poolPop(sc.depot))
+        {
+            sc.cached.fetch_sub(1,std::memory_order_relaxed);
+            rv += poolDropBuffer(core,item);
+        }
+    }
+    core->trimmed.fetch_add(rv,std::memory_order_relaxed);
+    return rv;
+}
+
+void bufferPool::flushThreadCache()
+{
+    bufferThreadCache *cache = poolThreadCaches.find(core,false);
+    if(cache)
+        cache->flushAll();
+}
+
+//копия без общих буферов: строки и массивы alt не атомарны по счетчику ссылок,
+//а новый поток читает атрибуты, пока создатель может разрушать свой экземпляр
+static threadAttributes threadAttributesCopy(const threadAttributes &attr)
+{
+    threadAttributes rv = attr;
+    rv.name.deepCopy(attr.name);
+    rv.cpus = alt::array<int>();
+    if(attr.cpus.size())
+        rv.cpus.append(attr.cpus(),attr.cpus.size());
+    return rv;
+}
+
 #if defined(linux) || defined(__APPLE__)
 
 #include <unistd.h>
@@ -149,6 +794,337 @@ void sharedArrays::cleanup()
 #include <sched.h>
 #include <signal.h>
 #include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#ifndef __APPLE__
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+static_assert(sizeof(std::atomic<uint32>)==sizeof(uint32),"futex word must be plain 32 bit");
+
+bool alt::futexWait(std::atomic<uint32> &addr, uint32 expected, int64 us)
+{
+    timespec ts, *pts = nullptr;
+    if(us>=0)
+    {
+        ts.tv_sec = us/1000000;
+        ts.tv_nsec = (us%1000000)*1000;
+        pts = &ts;
+    }
+    long rv = syscall(SYS_futex,(uint32*)&addr,FUTEX_WAIT_PRIVATE,expected,pts,nullptr,0);
+    return !(rv<0 && errno==ETIMEDOUT);
+}
+
+void alt::futexWake(std::atomic<uint32> &addr, int count)
+{
+    syscall(SYS_futex,(uint32*)&addr,FUTEX_WAKE_PRIVATE,count,nullptr,nullptr,0);
+}
+
+void alt::futexWakeAll(std::atomic<uint32> &addr)
+{
+    futexWake(addr,0x7fffffff);
+}
+
+static bool readSysFile(const char *path, char *buff, int size)
+{
+    FILE *f = fopen(path,"rb");
+    if(!f)
+        return false;
+    int rv = fread(buff,1,size-1,f);
+    fclose(f);
+    if(rv<0)
+        rv = 0;
+    buff[rv] = 0;
+    return rv>0;
+}
+
+static int readSysInt(const char *path, int def)
+{
+    char buff[32];
+    if(!readSysFile(path,buff,sizeof(buff)))
+        return def;
+    return atoi(buff);
+}
+
+//номера процессоров в сети, без обращения к сведениям об узлах
+static alt::array<int> onlineCpus()
+{
+    char buff[4096];
+    alt::array<int> list;
+    if(readSysFile("/sys/devices/system/cpu/online",buff,sizeof(buff)))
+        list = cpuTopology::parseList(buff);
+    if(!list.size())
+    {
+        int count = sysconf(_SC_NPROCESSORS_ONLN);
+        for(int i=0;i<count;i++)
+            list.append(i);
+    }
+    return list;
+}
+
+alt::array<cpuInfo> cpuTopology::cpus()
+{
+    alt::array<int> list = onlineCpus();
+
+    alt::array<int> node_list = nodes();
+    alt::array<alt::array<int>> node_cpus;
+    for(int i=0;i<node_list.size();i++)
+        node_cpus.append(nodeCpus(node_list[i]));
+
+    alt::array<cpuInfo> rv;
+    for(int i=0;i<list.size();i++)
+    {
+        cpuInfo el;
+        el.cpu = list[i];
+
+        char path[128];
+        snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%d/topology/core_id",el.cpu);
+        el.core = readSysInt(path,el.cpu);
+        snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%d/topology/physical_package_id",el.cpu);
+        el.package = readSysInt(path,0);
+
+        el.node = 0;
+        for(int j=0;j<node_list.size();j++)
+        {
+            if(node_cpus[j].indexOf(el.cpu)>=0)
+            {
+                el.node = node_list[j];
+                break;
+            }
+        }
+        rv.append(el);
+    }
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodes()
+{
+    char buff[1024];
+    alt::array<int> rv;
+    if(readSysFile("/sys/devices/system/node/online",buff,sizeof(buff)))
+        rv = parseList(buff);
+    if(!rv.size())
+        rv.append(0);
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodeCpus(int node)
+{
+    char path[128], buff[4096];
+    snprintf(path,sizeof(path),"/sys/devices/system/node/node%d/cpulist",node);
+    if(readSysFile(path,buff,sizeof(buff)))
+        return parseList(buff);
+
+    //ядро без NUMA: все процессоры на узле 0 (cpus() сам спрашивает узлы, сюда его не звать)
+    if(!node)
+        return onlineCpus();
+    return alt::array<int>();
+}
+
+int cpuTopology::cpuNode(int cpu)
+{
+    alt::array<int> node_list = nodes();
+    for(int i=0;i<node_list.size();i++)
+    {
+        if(nodeCpus(node_list[i]).indexOf(cpu)>=0)
+            return node_list[i];
+    }
+    return -1;
+}
+
+alt::array<int> cpuTopology::affinity()
+{
+    alt::array<int> rv;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(pthread_getaffinity_np(pthread_self(),sizeof(set),&set))
+        return rv;
+    for(int i=0;i<CPU_SETSIZE;i++)
+    {
+        if(CPU_ISSET(i,&set))
+            rv.append(i);
+    }
+    return rv;
+}
+
+int cpuTopology::currentCpu()
+{
+    return sched_getcpu();
+}
+
+#else
+
+//у macOS нет открытого futex: без таймаута - ожидание std::atomic, иначе опрос
+bool alt::futexWait(std::atomic<uint32> &addr, uint32 expected, int64 us)
+{
+    if(us<0)
+    {
+        addr.wait(expected,std::memory_order_relaxed);
+        return true;
+    }
+    for(int64 left=us; addr.load(std::memory_order_relaxed)==expected; left-=50)
+    {
+        if(left<=0)
+            return false;
+        usleep(50);
+    }
+    return true;
+}
+
+void alt::futexWake(std::atomic<uint32> &addr, int count)
+{
+    if(count==1)
+        addr.notify_one();
+    else
+        addr.notify_all();
+}
+
+void alt::futexWakeAll(std::atomic<uint32> &addr)
+{
+    addr.notify_all();
+}
+
+alt::array<cpuInfo> cpuTopology::cpus()
+{
+    alt::array<cpuInfo> rv;
+    int count = sysconf(_SC_NPROCESSORS_ONLN);
+    for(int i=0;i<count;i++)
+    {
+        cpuInfo el;
+        el.cpu = el.core = i;
+        el.package = el.node = 0;
+        rv.append(el);
+    }
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodes()
+{
+    alt::array<int> rv;
+    rv.append(0);
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodeCpus(int node)
+{
+    alt::array<int> rv;
+    if(node)
+        return rv;
+    int count = sysconf(_SC_NPROCESSORS_ONLN);
+    for(int i=0;i<count;i++)
+        rv.append(i);
+    return rv;
+}
+
+int cpuTopology::cpuNode(int cpu)
+{
+    return cpu>=0 && cpu<sysconf(_SC_NPROCESSORS_ONLN) ? 0 : -1;
+}
+
+alt::array<int> cpuTopology::affinity()
+{
+    //macOS не дает жесткой привязки
+    return nodeCpus(0);
+}
+
+int cpuTopology::currentCpu()
+{
+    return -1;
+}
+
+#endif
+
+//tid - системный номер потока для nice (только linux)
+static bool applyThreadAttributes(pthread_t hnd, long long tid, const threadAttributes &attr)
+{
+    bool rv = true;
+
+    alt::array<int> cpus = attr.cpus;
+    if(!cpus.size() && attr.numaNode>=0)
+    {
+        cpus = cpuTopology::nodeCpus(attr.numaNode);
+        if(!cpus.size())
+            rv = false;
+    }
+
+#ifndef __APPLE__
+    if(cpus.size())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int i=0;i<cpus.size();i++)
+        {
+            if(cpus[i]>=0 && cpus[i]<CPU_SETSIZE)
+                CPU_SET(cpus[i],&set);
+        }
+        if(!CPU_COUNT(&set) || pthread_setaffinity_np(hnd,sizeof(set),&set))
+            rv = false;
+    }
+    if(!attr.name.isEmpty())
+    {
+        if(pthread_setname_np(hnd,attr.name.left(15)()))
+            rv = false;
+    }
+#else
+    if(cpus.size())
+        rv = false;
+    if(!attr.name.isEmpty())
+    {
+        //macOS именует только вызывающий поток
+        if(!pthread_equal(hnd,pthread_self()) || pthread_setname_np(attr.name()))
+            rv = false;
+    }
+#endif
+
+    if(attr.policy!=threadAttributes::INHERIT)
+    {
+        int policy = SCHED_OTHER;
+        switch(attr.policy)
+        {
+#ifndef __APPLE__
+        case threadAttributes::BATCH: policy = SCHED_BATCH; break;
+        case threadAttributes::IDLE: policy = SCHED_IDLE; break;
+#endif
+        case threadAttributes::FIFO: policy = SCHED_FIFO; break;
+        case threadAttributes::ROUND_ROBIN: policy = SCHED_RR; break;
+        default: break;
+        }
+
+        bool realtime = policy==SCHED_FIFO || policy==SCHED_RR;
+        sched_param param;
+        memset(&param,0,sizeof(param));
+        if(realtime)
+        {
+            param.sched_priority = attr.priority;
+            int lo = sched_get_priority_min(policy);
+            int hi = sched_get_priority_max(policy);
+            if(param.sched_priority<lo)
+                param.sched_priority = lo;
+            if(param.sched_priority>hi)
+                param.sched_priority = hi;
+        }
+
+        if(pthread_setschedparam(hnd,policy,&param))
+        {
+            rv = false;
+        }
+        else if(!realtime && attr.priority)
+        {
+#ifndef __APPLE__
+            //в linux nice действует на отдельный поток
+            if(tid<=0 || setpriority(PRIO_PROCESS,(id_t)tid,attr.priority))
+                rv = false;
+#else
+            rv = false;
+#endif
+        }
+    }
+
+    return rv;
+}
 
 struct internalSleepStream
 {
@@ -156,6 +1132,11 @@ struct internalSleepStream
     pthread_mutex_t mutex;
     pthread_cond_t condition;
 
+    std::atomic<long long> tid;
+    std::atomic<int> attr_state;
+    threadAttributes attr;
+    bool stack_failed;
+
     volatile bool exit_flag;
     volatile bool complete_flag;
 
@@ -170,6 +1151,11 @@ void* sleepStreamThread (void *p)
 {
     internalSleepStream *hand = (internalSleepStream*)p;
 
+    //параметры применяются до первого запуска процедуры
+    hand->tid = alt::threadId();
+    bool ok = applyThreadAttributes(pthread_self(),hand->tid,hand->attr);
+    hand->attr_state = ok && !hand->stack_failed ? 1 : 0;
+
     pthread_mutex_lock( &hand->mutex );
     hand->complete_flag=true;
 
@@ -198,39 +1184,85 @@ void* sleepStreamThread (void *p)
     return NULL;
 }
 
-thread::thread(delegate<int, void *> proc)
+static void createSleepStream(internalSleepStream *hand)
+{
+    if(hand->attr.stackSize)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        bool ok = !pthread_attr_setstacksize(&attr,hand->attr.stackSize)
+                && !pthread_create(&hand->hnd,&attr,sleepStreamThread,hand);
+        pthread_attr_destroy(&attr);
+        if(ok)
+            return;
+        //неподходящий размер стека: поток все равно нужен
+        hand->stack_failed = true;
+    }
+    pthread_create(&hand->hnd,NULL,sleepStreamThread,hand);
+}
+
+thread::thread(delegate<int, void *> proc, const threadAttributes &attr)
 {
     internalSleepStream *hand = new internalSleepStream;
     hand->complete_flag=false;
     hand->exit_flag=false;
     hand->loop_flag=false;
+    hand->tid=0;
+    hand->attr_state=-1;
+    hand->attr=threadAttributesCopy(attr);
+    hand->stack_failed=false;
 
     pthread_cond_init(&hand->condition,NULL);
     pthread_mutex_init(&hand->mutex,NULL);
 
     hand->fun=NULL;
     hand->proc = proc;
-    pthread_create(&hand->hnd,NULL,sleepStreamThread,hand);
+    createSleepStream(hand);
 
     internal=hand;
 }
 
-thread::thread(int (*fun)(void*))
+thread::thread(int (*fun)(void*), const threadAttributes &attr)
 {
     internalSleepStream *hand = new internalSleepStream;
     hand->complete_flag=false;
     hand->exit_flag=false;
     hand->loop_flag=false;
+    hand->tid=0;
+    hand->attr_state=-1;
+    hand->attr=threadAttributesCopy(attr);
+    hand->stack_failed=false;
 
     pthread_cond_init(&hand->condition,NULL);
     pthread_mutex_init(&hand->mutex,NULL);
 
     hand->fun=fun;
-    pthread_create(&hand->hnd,NULL,sleepStreamThread,hand);
+    createSleepStream(hand);
 
     internal=hand;
 }
 
+bool thread::setAttributes(const threadAttributes &attr)
+{
+    internalSleepStream *hand = (internalSleepStream*)internal;
+    if(hand->exit_flag)
+        return false;
+    while(!hand->tid)
+        sched_yield();
+    return applyThreadAttributes(hand->hnd,hand->tid,attr);
+}
+
+int thread::attributesState()
+{
+    internalSleepStream *hand = (internalSleepStream*)internal;
+    return hand->attr_state;
+}
+
+bool thread::setCurrentAttributes(const threadAttributes &attr)
+{
+    return applyThreadAttributes(pthread_self(),alt::threadId(),attr);
+}
+
 void thread::terminate()
 {
     internalSleepStream *hand = (internalSleepStream*)internal;
@@ -425,11 +1457,208 @@ static bool existsConditionVars()
 
 static bool conditionVariableExists=existsConditionVars();
 
+//WaitOnAddress появился в Windows 8
+typedef BOOL (WINAPI *WaitOnAddress_proc) (volatile VOID *Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds);
+typedef VOID (WINAPI *WakeByAddress_proc) (PVOID Address);
+static HMODULE synchModule=LoadLibraryA("api-ms-win-core-synch-l1-2-0.dll");
+static WaitOnAddress_proc pWaitOnAddress=synchModule ?
+        (WaitOnAddress_proc)GetProcAddress(synchModule,"WaitOnAddress") : NULL;
+static WakeByAddress_proc pWakeByAddressSingle=synchModule ?
+        (WakeByAddress_proc)GetProcAddress(synchModule,"WakeByAddressSingle") : NULL;
+static WakeByAddress_proc pWakeByAddressAll=synchModule ?
+        (WakeByAddress_proc)GetProcAddress(synchModule,"WakeByAddressAll") : NULL;
+
+bool alt::futexWait(std::atomic<uint32> &addr, uint32 expected, int64 us)
+{
+    DWORD ms = us<0 ? INFINITE : DWORD((us+999)/1000);
+    if(pWaitOnAddress)
+    {
+        if(pWaitOnAddress((volatile VOID*)&addr,&expected,sizeof(expected),ms))
+            return true;
+        return GetLastError()!=ERROR_TIMEOUT;
+    }
+
+    //старые системы: опрос
+    DWORD start = GetTickCount();
+    while(addr.load(std::memory_order_relaxed)==expected)
+    {
+        if(ms!=INFINITE && GetTickCount()-start>=ms)
+            return false;
+        Sleep(0);
+    }
+    return true;
+}
+
+void alt::futexWake(std::atomic<uint32> &addr, int count)
+{
+    if(!pWakeByAddressSingle)
+        return;
+    if(count>1)
+    {
+        pWakeByAddressAll((PVOID)&addr);
+        return;
+    }
+    pWakeByAddressSingle((PVOID)&addr);
+}
+
+void alt::futexWakeAll(std::atomic<uint32> &addr)
+{
+    if(pWakeByAddressAll)
+        pWakeByAddressAll((PVOID)&addr);
+}
+
+//имена потоков появились в Windows 10
+typedef HRESULT (WINAPI *SetThreadDescription_proc) (HANDLE hThread, PCWSTR lpThreadDescription);
+static SetThreadDescription_proc pSetThreadDescription=(SetThreadDescription_proc)
+        GetProcAddress(GetModuleHandleA("kernel32.dll"),"SetThreadDescription");
+
+alt::array<cpuInfo> cpuTopology::cpus()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    alt::array<int> node_list = nodes();
+    alt::array<cpuInfo> rv;
+    for(int i=0;i<(int)info.dwNumberOfProcessors;i++)
+    {
+        cpuInfo el;
+        el.cpu = el.core = i;
+        el.package = 0;
+        el.node = cpuNode(i);
+        rv.append(el);
+    }
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodes()
+{
+    alt::array<int> rv;
+    ULONG highest = 0;
+    if(!GetNumaHighestNodeNumber(&highest))
+        highest = 0;
+    for(int i=0;i<=(int)highest;i++)
+    {
+        ULONGLONG mask = 0;
+        if(!i || (GetNumaNodeProcessorMask((UCHAR)i,&mask) && mask))
+            rv.append(i);
+    }
+    return rv;
+}
+
+alt::array<int> cpuTopology::nodeCpus(int node)
+{
+    alt::array<int> rv;
+    ULONGLONG mask = 0;
+    if(node<0 || !GetNumaNodeProcessorMask((UCHAR)node,&mask))
+        return rv;
+    for(int i=0;i<64;i++)
+    {
+        if(mask & (ULONGLONG(1)<<i))
+            rv.append(i);
+    }
+    return rv;
+}
+
+int cpuTopology::cpuNode(int cpu)
+{
+    UCHAR node = 0;
+    if(cpu<0 || cpu>255 || !GetNumaProcessorNode((UCHAR)cpu,&node) || node==0xff)
+        return -1;
+    return node;
+}
+
+alt::array<int> cpuTopology::affinity()
+{
+    alt::array<int> rv;
+    DWORD_PTR proc_mask, sys_mask;
+    if(!GetProcessAffinityMask(GetCurrentProcess(),&proc_mask,&sys_mask))
+        return rv;
+    for(int i=0;i<(int)sizeof(DWORD_PTR)*8;i++)
+    {
+        if(proc_mask & (DWORD_PTR(1)<<i))
+            rv.append(i);
+    }
+    return rv;
+}
+
+int cpuTopology::currentCpu()
+{
+#if _WIN32_WINNT >= 0x0600
+    return GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+static bool applyThreadAttributes(HANDLE hnd, const threadAttributes &attr)
+{
+    bool rv = true;
+
+    alt::array<int> cpus = attr.cpus;
+    if(!cpus.size() && attr.numaNode>=0)
+    {
+        cpus = cpuTopology::nodeCpus(attr.numaNode);
+        if(!cpus.size())
+            rv = false;
+    }
+    if(cpus.size())
+    {
+        DWORD_PTR mask = 0;
+        for(int i=0;i<cpus.size();i++)
+        {
+            if(cpus[i]>=0 && cpus[i]<(int)sizeof(DWORD_PTR)*8)
+                mask |= DWORD_PTR(1)<<cpus[i];
+        }
+        if(!mask || !SetThreadAffinityMask(hnd,mask))
+            rv = false;
+    }
+
+    if(!attr.name.isEmpty())
+    {
+        wchar_t name[256];
+        if(!pSetThreadDescription || !MultiByteToWideChar(CP_UTF8,0,attr.name(),-1,name,256)
+                || FAILED(pSetThreadDescription(hnd,name)))
+            rv = false;
+    }
+
+    if(attr.policy!=threadAttributes::INHERIT)
+    {
+        //классы планировщика сводятся к относительным приоритетам
+        int priority = THREAD_PRIORITY_NORMAL;
+        switch(attr.policy)
+        {
+        case threadAttributes::FIFO:
+        case threadAttributes::ROUND_ROBIN:
+            priority = attr.priority>=50 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+            break;
+        case threadAttributes::IDLE:
+            priority = THREAD_PRIORITY_IDLE;
+            break;
+        case threadAttributes::BATCH:
+            priority = THREAD_PRIORITY_BELOW_NORMAL;
+            break;
+        default:
+            if(attr.priority<=-10) priority = THREAD_PRIORITY_HIGHEST;
+            else if(attr.priority<0) priority = THREAD_PRIORITY_ABOVE_NORMAL;
+            else if(attr.priority>=10) priority = THREAD_PRIORITY_LOWEST;
+            else if(attr.priority>0) priority = THREAD_PRIORITY_BELOW_NORMAL;
+            break;
+        }
+        if(!SetThreadPriority(hnd,priority))
+            rv = false;
+    }
+
+    return rv;
+}
+
 struct internalSleepStream
 {
     DWORD id;
     HANDLE hph;
 
+    std::atomic<int> attr_state;
+    threadAttributes attr;
+
     //медленная синхронизация для ХР
     HANDLE go;
 
@@ -452,6 +1681,9 @@ static DWORD WINAPI sleepStreamThread (PVOID p)
 {
     internalSleepStream *hand = (internalSleepStream*)p;
 
+    //параметры применяются до первого запуска процедуры
+    hand->attr_state = applyThreadAttributes(GetCurrentThread(),hand->attr) ? 1 : 0;
+
     EnterCriticalSection (&hand->lock);
     hand->complete_flag=true;
     if(!conditionVariableExists)
@@ -503,12 +1735,14 @@ void thread::terminate()
     TerminateThread(&hand->hph,0);
 }
 
-thread::thread(delegate<int, void *> proc)
+thread::thread(delegate<int, void *> proc, const threadAttributes &attr)
 {
     internalSleepStream *hand = new internalSleepStream;
     hand->complete_flag=false;
     hand->exit_flag=false;
     hand->loop_flag=false;
+    hand->attr_state=-1;
+    hand->attr=threadAttributesCopy(attr);
 
     //XP совместимость
     if(!conditionVariableExists)
@@ -520,17 +1754,19 @@ thread::thread(delegate<int, void *> proc)
 
     hand->fun=NULL;
     hand->proc = proc;
-    hand->hph = CreateThread (NULL, 0, sleepStreamThread, hand, 0, &hand->id);
+    hand->hph = CreateThread (NULL, attr.stackSize, sleepStreamThread, hand, 0, &hand->id);
 
     internal = hand;
 }
 
-thread::thread(int (*fun)(void*))
+thread::thread(int (*fun)(void*), const threadAttributes &attr)
 {
     internalSleepStream *hand = new internalSleepStream;
     hand->complete_flag=false;
     hand->exit_flag=false;
     hand->loop_flag=false;
+    hand->attr_state=-1;
+    hand->attr=threadAttributesCopy(attr);
 
     //XP совместимость
     if(!conditionVariableExists)
@@ -541,7 +1777,7 @@ thread::thread(int (*fun)(void*))
     InitializeCriticalSection (&hand->lock);
 
     hand->fun = fun;
-    hand->hph = CreateThread (NULL, 0, sleepStreamThread, hand, 0, &hand->id);
+    hand->hph = CreateThread (NULL, attr.stackSize, sleepStreamThread, hand, 0, &hand->id);
 
     internal = hand;
 }
@@ -643,6 +1879,25 @@ bool thread::isOff()
     return hand->complete_flag || hand->exit_flag;
 }
 
+bool thread::setAttributes(const threadAttributes &attr)
+{
+    internalSleepStream *hand = (internalSleepStream*)internal;
+    if(hand->exit_flag)
+        return false;
+    return applyThreadAttributes(hand->hph,attr);
+}
+
+int thread::attributesState()
+{
+    internalSleepStream *hand = (internalSleepStream*)internal;
+    return hand->attr_state;
+}
+
+bool thread::setCurrentAttributes(const threadAttributes &attr)
+{
+    return applyThreadAttributes(GetCurrentThread(),attr);
+}
+
 void alt::sleep(int us)
 {
     Sleep(us/1000);
@@ -29,19 +29,82 @@ SOFTWARE.
 
 #include "atypes.h"
 #include "at_array.h"
+#include "astring.h"
 #include "adelegate.h"
 
+#include <atomic>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
 namespace alt {
 
     void sleep(int us);
 
     long long threadId();
 
+    //процессор из топологии системы
+    struct cpuInfo
+    {
+        int cpu = -1;
+        int core = -1;      //физическое ядро в пределах пакета
+        int package = -1;   //сокет
+        int node = -1;      //узел NUMA
+    };
+
+    //топология процессоров (в linux читается из sysfs)
+    class cpuTopology
+    {
+    public:
+        //процессоры, находящиеся в работе
+        static alt::array<cpuInfo> cpus();
+        static int cpuCount();
+
+        //номера узлов NUMA; без NUMA - один узел 0
+        static alt::array<int> nodes();
+        static int nodeCount();
+        static alt::array<int> nodeCpus(int node);
+        static int cpuNode(int cpu);
+
+        //процессоры маски привязки вызывающего потока
+        static alt::array<int> affinity();
+
+        //-1, если система не сообщает
+        static int currentCpu();
+        static int currentNode();
+
+        //разбор списков вида "0-3,8,10-11"
+        static alt::array<int> parseList(const char *list);
+    };
+
+    //параметры потока; значения по умолчанию ничего не меняют
+    struct threadAttributes
+    {
+        enum schedPolicy
+        {
+            INHERIT,
+            NORMAL,
+            BATCH,
+            IDLE,
+            FIFO,       //реального времени, нужны права
+            ROUND_ROBIN //реального времени, нужны права
+        };
+
+        alt::array<int> cpus;       //привязка к процессорам
+        int numaNode = -1;          //привязка к процессорам узла, если cpus пуст
+        alt::string name;           //видно в top/perf, linux обрезает до 15 символов
+        uintz stackSize = 0;        //только при создании потока
+
+        schedPolicy policy = INHERIT;
+        int priority = 0;           //FIFO/ROUND_ROBIN: 1..99, иначе nice -20..19
+    };
+
     class thread
     {
     public:
-        thread(delegate<int,void *> proc);
-        thread(int (*fun)(void *));
+        thread(delegate<int,void *> proc, const threadAttributes &attr = threadAttributes());
+        thread(int (*fun)(void *), const threadAttributes &attr = threadAttributes());
 
         ~thread();
 
@@ -50,8 +113,20 @@ namespace alt {
         bool isOff();
         void terminate(); //вызывать только в крайнем случае!
 
+        //применить параметры к работающему потоку (кроме размера стека);
+        //false, если хоть один не удалось установить
+        bool setAttributes(const threadAttributes &attr);
+
+        //удалось ли установить параметры, переданные в конструктор
+        bool attributesApplied();
+
+        static bool setCurrentAttributes(const threadAttributes &attr);
+
     private:
 
+        //-1 - еще не применены, 0 - с ошибками, 1 - успешно
+        int attributesState();
+
         void *internal;
 
     };
@@ -73,6 +148,339 @@ namespace alt {
 
     };
 
+    //////////////////////////////////////////////////////////////////////////////////////
+    // Примитивы на futex: ожидание сначала крутится в пространстве пользователя,
+    // затем засыпает в ядре на слове состояния. Свободный захват и освобождение
+    // без ожидающих обходятся без системных вызовов.
+
+    __inline void cpuRelax()
+    {
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        #ifdef _MSC_VER
+            _mm_pause();
+        #else
+            __builtin_ia32_pause();
+        #endif
+    #elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+    #endif
+    }
+
+    //спать, пока *addr==expected; us<0 - без ограничения;
+    //false по таймауту (возможны ложные пробуждения)
+    bool futexWait(std::atomic<uint32> &addr, uint32 expected, int64 us = -1);
+    void futexWake(std::atomic<uint32> &addr, int count);
+    void futexWakeAll(std::atomic<uint32> &addr);
+
+    //0 - свободен, 1 - захвачен, 2 - захвачен и есть спящие
+    class mutex
+    {
+    public:
+        mutex() {}
+        mutex(const mutex &val) = delete;
+        mutex& operator=(const mutex &val) = delete;
+
+        void lock()
+        {
+            uint32 c = 0;
+            if(state.compare_exchange_strong(c,1,std::memory_order_acquire))
+                return;
+            lockSlow();
+        }
+
+        bool trylock()
+        {
+            uint32 c = 0;
+            return state.compare_exchange_strong(c,1,std::memory_order_acquire);
+        }
+
+        void unlock()
+        {
+            if(state.exchange(0,std::memory_order_release)==2)
+                futexWake(state,1);
+        }
+
+    private:
+
+        void lockSlow();
+
+        std::atomic<uint32> state = 0;
+        std::atomic<int> spin_limit = 100; //подстраивается под длину критических секций
+    };
+
+    //читатели параллельны; ждущий писатель не пускает новых читателей
+    class rwlock
+    {
+    public:
+        rwlock() {}
+        rwlock(const rwlock &val) = delete;
+        rwlock& operator=(const rwlock &val) = delete;
+
+        void lockShared()
+        {
+            uint32 st = state.load(std::memory_order_relaxed);
+            if(!(st & (WRITER|WAITERS_MASK))
+                    && state.compare_exchange_weak(st,st+1,std::memory_order_acquire))
+                return;
+            lockSharedSlow();
+        }
+
+        bool trylockShared()
+        {
+            uint32 st = state.load(std::memory_order_relaxed);
+            while(!(st & (WRITER|WAITERS_MASK)))
+            {
+                if(state.compare_exchange_weak(st,st+1,std::memory_order_acquire))
+                    return true;
+            }
+            return false;
+        }
+
+        void unlockShared()
+        {
+            uint32 st = state.fetch_sub(1,std::memory_order_release)-1;
+            if(!(st & READERS_MASK) && (st & SLEEPERS))
+                wakeSleepers();
+        }
+
+        void lock()
+        {
+            uint32 st = 0;
+            if(state.compare_exchange_strong(st,WRITER,std::memory_order_acquire))
+                return;
+            lockSlow();
+        }
+
+        bool trylock()
+        {
+            uint32 st = state.load(std::memory_order_relaxed);
+            while(!(st & (WRITER|READERS_MASK)))
+            {
+                if(state.compare_exchange_weak(st,st|WRITER,std::memory_order_acquire))
+                    return true;
+            }
+            return false;
+        }
+
+        void unlock()
+        {
+            uint32 st = state.fetch_and(~(WRITER|SLEEPERS),std::memory_order_release);
+            if(st & SLEEPERS)
+                futexWakeAll(state);
+        }
+
+    private:
+
+        enum : uint32
+        {
+            READERS_MASK = (1u<<20)-1,
+            WAITER_ONE = 1u<<20,            //счетчик ждущих писателей
+            WAITERS_MASK = ((1u<<10)-1)<<20,
+            WRITER = 1u<<30,
+            SLEEPERS = 1u<<31
+        };
+
+        void lockSharedSlow();
+        void lockSlow();
+        void wakeSleepers();
+
+        std::atomic<uint32> state = 0;
+    };
+
+    template <class L>
+    class lockGuard
+    {
+    public:
+        lockGuard(L &val) : lockable(val) {lockable.lock();}
+        ~lockGuard() {lockable.unlock();}
+
+        lockGuard(const lockGuard &val) = delete;
+        lockGuard& operator=(const lockGuard &val) = delete;
+
+    private:
+        L &lockable;
+    };
+
+    class sharedLockGuard
+    {
+    public:
+        sharedLockGuard(rwlock &val) : lockable(val) {lockable.lockShared();}
+        ~sharedLockGuard() {lockable.unlockShared();}
+
+        sharedLockGuard(const sharedLockGuard &val) = delete;
+        sharedLockGuard& operator=(const sharedLockGuard &val) = delete;
+
+    private:
+        rwlock &lockable;
+    };
+
+    //работает с любым замком, у которого есть lock()/unlock() (mutex, semaphore, rwlock)
+    class condVar
+    {
+    public:
+        condVar() {}
+        condVar(const condVar &val) = delete;
+        condVar& operator=(const condVar &val) = delete;
+
+        template <class L>
+        void wait(L &lock)
+        {
+            uint32 s = prepare();
+            lock.unlock();
+            futexWait(seq,s);
+            waiters.fetch_sub(1,std::memory_order_relaxed);
+            lock.lock();
+        }
+
+        //false по таймауту
+        template <class L>
+        bool wait(L &lock, int64 us)
+        {
+            uint32 s = prepare();
+            lock.unlock();
+            bool rv = futexWait(seq,s,us);
+            waiters.fetch_sub(1,std::memory_order_relaxed);
+            lock.lock();
+            return rv || seq.load(std::memory_order_relaxed)!=s;
+        }
+
+        template <class L, class P>
+        void wait(L &lock, P pred)
+        {
+            while(!pred())
+                wait(lock);
+        }
+
+        void notifyOne()
+        {
+            seq.fetch_add(1,std::memory_order_seq_cst);
+            if(waiters.load(std::memory_order_seq_cst))
+                futexWake(seq,1);
+        }
+
+        void notifyAll()
+        {
+            seq.fetch_add(1,std::memory_order_seq_cst);
+            if(waiters.load(std::memory_order_seq_cst))
+                futexWakeAll(seq);
+        }
+
+    private:
+
+        uint32 prepare()
+        {
+            waiters.fetch_add(1,std::memory_order_seq_cst);
+            return seq.load(std::memory_order_seq_cst);
+        }
+
+        std::atomic<uint32> seq = 0;
+        std::atomic<int> waiters = 0;
+    };
+
+    class countingSemaphore
+    {
+    public:
+        countingSemaphore(uint32 initial = 0) : count(initial) {}
+        countingSemaphore(const countingSemaphore &val) = delete;
+        countingSemaphore& operator=(const countingSemaphore &val) = delete;
+
+        void acquire()
+        {
+            if(!tryAcquire())
+                acquireSlow(-1);
+        }
+
+        bool tryAcquire()
+        {
+            uint32 c = count.load(std::memory_order_relaxed);
+            while(c)
+            {
+                if(count.compare_exchange_weak(c,c-1,std::memory_order_acquire))
+                    return true;
+            }
+            return false;
+        }
+
+        //false по таймауту
+        bool tryAcquireFor(int64 us)
+        {
+            return tryAcquire() || acquireSlow(us);
+        }
+
+        void release(uint32 n = 1)
+        {
+            count.fetch_add(n,std::memory_order_seq_cst);
+            if(waiters.load(std::memory_order_seq_cst))
+                futexWake(count,n);
+        }
+
+        uint32 available() const {return count.load(std::memory_order_relaxed);}
+
+    private:
+
+        bool acquireSlow(int64 us);
+
+        std::atomic<uint32> count;
+        std::atomic<int> waiters = 0;
+    };
+
+    //одноразовый счетчик: wait() отпускает, когда счет дошел до нуля
+    class latch
+    {
+    public:
+        latch(uint32 expected) : count(expected) {}
+        latch(const latch &val) = delete;
+        latch& operator=(const latch &val) = delete;
+
+        void countDown(uint32 n = 1)
+        {
+            if(count.fetch_sub(n,std::memory_order_acq_rel)==n)
+                futexWakeAll(count);
+        }
+
+        bool tryWait() const
+        {
+            return !count.load(std::memory_order_acquire);
+        }
+
+        void wait();
+
+        void arriveAndWait(uint32 n = 1)
+        {
+            countDown(n);
+            wait();
+        }
+
+    private:
+        std::atomic<uint32> count;
+    };
+
+    //многоразовый барьер на count участников
+    class barrier
+    {
+    public:
+        barrier(uint32 count) : expected(count) {}
+        barrier(const barrier &val) = delete;
+        barrier& operator=(const barrier &val) = delete;
+
+        //true получает ровно один участник каждой фазы - последний пришедший
+        bool arriveAndWait();
+
+        //выйти из всех следующих фаз
+        void arriveAndDrop();
+
+        uint32 phase() const {return current.load(std::memory_order_acquire);}
+
+    private:
+
+        bool arrive(bool drop);
+
+        std::atomic<uint32> expected;
+        std::atomic<uint32> arrived = 0;
+        std::atomic<uint32> dropped = 0;
+        std::atomic<uint32> current = 0;
+    };
+
     class shadower
     {
     public:
@@ -98,12 +506,22 @@ namespace alt {
 
     //////////////////////////////////////////////////////////////////////////////////////
 
+    struct bufferPoolCore;
+
     struct sharedArrayInternal
     {
         std::atomic<uint> refcount = 0;
         alt::array<uint8> buffer;
+
+        //заполнены только у буферов bufferPool: с последней ссылкой буфер возвращается в пул
+        bufferPoolCore *core = nullptr;
+        int sizeClass = -1;
+        std::atomic<sharedArrayInternal*> next = nullptr;
+        sharedArrayInternal *all_next = nullptr;
     };
 
+    void bufferPoolRecycle(sharedArrayInternal *item);
+
     class sharedArrayRef
     {
     public:
@@ -126,20 +544,21 @@ namespace alt {
         ~sharedArrayRef()
         {
             if(handler)
-                handler->refcount--;
+                release();
         }
 
         sharedArrayRef& operator = (const sharedArrayRef& val)
         {
+            if(val.handler)
+                val.handler->refcount++;
             if(handler)
-                handler->refcount--;
+                release();
             if(!val.handler)
             {
                 handler = nullptr;
                 return *this;
             }
             handler = val.handler;
-            handler->refcount++;
             return *this;
         }
 
@@ -147,10 +566,23 @@ namespace alt {
         {
             if(!handler)
                 return;
-            handler->refcount--;
+            release();
             handler = nullptr;
         }
 
+        //запись допустима, пока ссылка единственная (например, сразу после bufferPool::acquire)
+        uint8* data()
+        {
+            if(!handler)
+                return nullptr;
+            return handler->buffer();
+        }
+
+        bool isUnique() const
+        {
+            return handler && handler->refcount.load(std::memory_order_acquire)==1;
+        }
+
         const uint8& operator[](uintz ind) const
         {
             return handler->buffer[ind];
@@ -177,10 +609,72 @@ namespace alt {
 
     private:
 
+        void release()
+        {
+            if(handler->refcount.fetch_sub(1,std::memory_order_acq_rel)==1 && handler->core)
+                bufferPoolRecycle(handler);
+        }
+
         sharedArrayInternal *handler = nullptr;
 
     };
 
+    struct bufferPoolStats
+    {
+        uint64 acquires = 0;
+        uint64 hits = 0;            //взяты из кэша потока или общего склада
+        uint64 allocations = 0;     //выделены заново
+        uint64 oversize = 0;        //больше старшего класса, не кэшируются
+        uint64 trimmed = 0;         //байт освобождено trim()/purge()
+
+        uint64 inUse = 0;           //выдано сейчас
+        uint64 bytesInUse = 0;      //по емкости классов
+        uint64 cached = 0;          //лежит в общем складе (кэши потоков не учитываются)
+        uint64 bytesCached = 0;
+        uint64 highWater = 0;       //пик выданных с последнего trim()
+        uint64 bytesHighWater = 0;
+    };
+
+    // Пул буферов с классами размеров 2^n. Освобожденный буфер попадает в кэш
+    // освободившего потока, излишек кэша - в общий склад (стек без блокировок на класс).
+    // Захват и возврат - O(1). Буферы раздаются как sharedArrayRef и возвращаются
+    // в пул сами, когда пропадает последняя ссылка, в том числе после разрушения пула.
+    class bufferPool
+    {
+    public:
+        //классы от 2^minLog2 до 2^maxLog2 байт
+        bufferPool(int minLog2 = 6, int maxLog2 = 26);
+        ~bufferPool();
+
+        bufferPool(const bufferPool &val) = delete;
+        bufferPool& operator=(const bufferPool &val) = delete;
+
+        static bufferPool& global();
+
+        //буфер размера size с единственной ссылкой
+        sharedArrayRef acquire(uintz size);
+
+        //заранее положить count буферов под size в склад
+        void reserve(uintz size, int count);
+
+        bufferPoolStats stats() const;
+
+        //оставить в складе столько, сколько нужно до пика с прошлого trim(),
+        //и начать новое окно пика; возвращает освобожденные байты
+        uint64 trim();
+
+        //освободить весь склад и кэш вызывающего потока
+        uint64 purge();
+
+        //кэш вызывающего потока в общий склад (например, перед завершением потока)
+        void flushThreadCache();
+
+    private:
+
+        bufferPoolCore *core;
+    };
+
+    //устаревший пул с поиском перебором; новый код использует bufferPool
     class sharedArrays
     {
     public:
@@ -0,0 +1,330 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "athreadpool.h"
+
+#include <thread>
+
+using namespace alt;
+
+namespace {
+
+    struct workerContext
+    {
+        threadPool *pool = nullptr;
+        int index = -1;
+    };
+
+    thread_local workerContext currentContext;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+taskGroup::taskGroup(threadPool *pool)
+    : pool(pool ? pool : &threadPool::global())
+{
+}
+
+taskGroup::~taskGroup()
+{
+    wait();
+}
+
+void taskGroup::wait()
+{
+    pool->wait(*this);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+int threadPool::affinityCount()
+{
+    int rv = cpuTopology::affinity().size();
+    if(rv>0)
+        return rv;
+    rv = std::thread::hardware_concurrency();
+    return rv>0 ? rv : 1;
+}
+
+threadPool::threadPool(int count, bool pinned)
+{
+    if(count<=0)
+        count = affinityCount();
+
+    array<int> cpus;
+    if(pinned)
+        cpus = cpuTopology::affinity();
+
+    for(int i=0;i<count;i++)
+    {
+        worker *el = new worker;
+        el->seed = 0x9e3779b9u*(i+1);
+        workers.append(el);
+    }
+    for(int i=0;i<count;i++)
+    {
+        threadAttributes attr;
+        attr.name = "alt.pool."+string::fromInt(i);
+        if(cpus.size())
+            attr.cpus.append(cpus[i%cpus.size()]);
+        workers[i]->hand = new thread(delegate<int,void*>(this,&threadPool::workerProc),attr);
+        workers[i]->hand->run((void*)intz(i));
+    }
+}
+
+threadPool::~threadPool()
+{
+    //оставшиеся задачи выполняются до остановки
+    while(runPending());
+
+    stopping.store(true,std::memory_order_seq_cst);
+    epoch.fetch_add(1,std::memory_order_seq_cst);
+    epoch.notify_all();
+
+    for(int i=0;i<workers.size();i++)
+    {
+        workers[i]->hand->wait();
+        delete workers[i]->hand;
+    }
+    for(int i=0;i<workers.size();i++)
+        delete workers[i];
+}
+
+threadPool& threadPool::global()
+{
+    static threadPool pool;
+    return pool;
+}
+
+int threadPool::currentWorker() const
+{
+    return currentContext.pool==this ? currentContext.index : -1;
+}
+
+void threadPool::push(taskItem *item)
+{
+    int index = currentWorker();
+    if(index>=0)
+    {
+        workers[index]->deque.push(item);
+    }
+    else
+    {
+        inject_mutex.lock();
+        injected.append(item);
+        injected_count.fetch_add(1,std::memory_order_relaxed);
+        inject_mutex.unlock();
+    }
+    wakeup();
+}
+
+void threadPool::wakeup()
+{
+    //пара к sleepers++ и повторной проверке очередей в workerProc
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleepers.load(std::memory_order_seq_cst)>0)
+    {
+        epoch.fetch_add(1,std::memory_order_seq_cst);
+        epoch.notify_one();
+    }
+}
+
+bool threadPool::hasWork() const
+{
+    if(injected_count.load(std::memory_order_relaxed)>0)
+        return true;
+    for(int i=0;i<workers.size();i++)
+    {
+        if(!workers[i]->deque.isEmpty())
+            return true;
+    }
+    return false;
+}
+
+int64 threadPool::pendingCount() const
+{
+    int64 rv = injected_count.load(std::memory_order_relaxed);
+    for(int i=0;i<workers.size();i++)
+        rv += workers[i]->deque.size();
+    return rv;
+}
+
+threadPool::taskItem* threadPool::take(int index)
+{
+    if(index>=0)
+    {
+        taskItem *rv = workers[index]->deque.pop();
+        if(rv)
+            return rv;
+    }
+
+    if(injected_count.load(std::memory_order_relaxed)>0)
+    {
+        taskItem *rv = nullptr;
+        inject_mutex.lock();
+        if(injected_head<injected.size())
+        {
+            rv = injected[injected_head++];
+            injected_count.fetch_sub(1,std::memory_order_relaxed);
+            if(injected_head==injected.size())
+            {
+                injected.clear();
+                injected_head = 0;
+            }
+            else if(injected_head>=1024 && injected_head*2>=injected.size())
+            {
+                injected.cut(0,injected_head);
+                injected_head = 0;
+            }
+        }
+        inject_mutex.unlock();
+        if(rv)
+            return rv;
+    }
+
+    //воруем, начиная со случайной жертвы
+    int count = workers.size();
+    if(!count)
+        return nullptr;
+
+    uint32 start;
+    if(index>=0)
+    {
+        uint32 &x = workers[index]->seed;
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        start = x;
+    }
+    else
+    {
+        static std::atomic<uint32> next(0);
+        start = next.fetch_add(1,std::memory_order_relaxed);
+    }
+
+    for(int i=0;i<count;i++)
+    {
+        int victim = (start+i)%count;
+        if(victim==index)
+            continue;
+        taskItem *rv = workers[victim]->deque.steal();
+        if(rv)
+            return rv;
+    }
+    return nullptr;
+}
+
+void threadPool::execute(taskItem *item)
+{
+    item->fun();
+    taskGroup *group = item->group;
+    delete item;
+    if(group)
+        group->finished();
+}
+
+bool threadPool::runPending()
+{
+    taskItem *item = take(currentWorker());
+    if(!item)
+        return false;
+    execute(item);
+    return true;
+}
+
+void threadPool::wait(taskGroup &group)
+{
+    int index = currentWorker();
+    int idle = 0;
+    while(!group.isDone())
+    {
+        taskItem *item = take(index);
+        if(item)
+        {
+            execute(item);
+            idle = 0;
+            continue;
+        }
+
+        //задачи группы выполняются где-то еще
+        if(++idle<64)
+        {
+            alt::sleep(0);
+            continue;
+        }
+        int left = group.pending.load(std::memory_order_acquire);
+        if(!left)
+        {
+            //завершивший задачу поток еще будит ожидающих
+            alt::sleep(0);
+            continue;
+        }
+        if(index>=0 || hasWork())
+        {
+            //рабочий не засыпает насовсем - его очередь может понадобиться группе
+            alt::sleep(50);
+            continue;
+        }
+        group.pending.wait(left,std::memory_order_acquire);
+    }
+}
+
+int threadPool::workerProc(void *data)
+{
+    int index = int(intz(data));
+    currentContext.pool = this;
+    currentContext.index = index;
+
+    int idle = 0;
+    while(!stopping.load(std::memory_order_relaxed))
+    {
+        taskItem *item = take(index);
+        if(item)
+        {
+            execute(item);
+            idle = 0;
+            continue;
+        }
+
+        if(++idle<64)
+        {
+            alt::sleep(0);
+            continue;
+        }
+
+        //пара к барьеру в wakeup(): либо мы увидим новую задачу, либо отправитель увидит sleepers
+        sleepers.fetch_add(1,std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32 current = epoch.load(std::memory_order_seq_cst);
+        if(!hasWork() && !stopping.load(std::memory_order_seq_cst))
+            epoch.wait(current,std::memory_order_seq_cst);
+        sleepers.fetch_sub(1,std::memory_order_seq_cst);
+        idle = 0;
+    }
+
+    currentContext.pool = nullptr;
+    currentContext.index = -1;
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ATHREADPOOL_H
+#define ATHREADPOOL_H
+
+#include "atypes.h"
+#include "at_array.h"
+#include "adelegate.h"
+#include "athread.h"
+#include "aepoch.h"
+
+#include <functional>
+#include <utility>
+
+// Пул потоков с перехватом работы: у каждого рабочего своя деква Чейза-Лева,
+// владелец кладет и берет задачи с низа (LIFO), остальные воруют сверху (FIFO).
+// Задачи из посторонних потоков идут в общую очередь. Вложенные задачи,
+// порожденные внутри рабочего, попадают в его собственную декву.
+
+namespace alt {
+
+    template <class T>
+    class workStealingDeque
+    {
+    public:
+        workStealingDeque(int capacity = 256)
+        {
+            int size = 16;
+            while(size<capacity)
+                size <<= 1;
+            buffer.store(new slots(size),std::memory_order_relaxed);
+        }
+
+        ~workStealingDeque()
+        {
+            delete buffer.load(std::memory_order_relaxed);
+        }
+
+        workStealingDeque(const workStealingDeque &val) = delete;
+        workStealingDeque& operator=(const workStealingDeque &val) = delete;
+
+        //только владелец
+        void push(T *val)
+        {
+            int64 b = bottom.load(std::memory_order_relaxed);
+            int64 t = top.load(std::memory_order_acquire);
+            slots *buff = buffer.load(std::memory_order_relaxed);
+            if(b-t>buff->mask)
+                buff = grow(buff,b,t);
+            buff->put(b,val);
+            bottom.store(b+1,std::memory_order_release);
+        }
+
+        //только владелец
+        T* pop()
+        {
+            int64 b = bottom.load(std::memory_order_relaxed)-1;
+            slots *buff = buffer.load(std::memory_order_relaxed);
+            bottom.store(b,std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64 t = top.load(std::memory_order_relaxed);
+
+            if(t>b)
+            {
+                bottom.store(b+1,std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T *rv = buff->get(b);
+            if(t==b)
+            {
+                //последний элемент - соревнуемся с ворами
+                if(!top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed))
+                    rv = nullptr;
+                bottom.store(b+1,std::memory_order_relaxed);
+            }
+            return rv;
+        }
+
+        //любой поток
+        T* steal()
+        {
+            int64 t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64 b = bottom.load(std::memory_order_acquire);
+            if(t>=b)
+                return nullptr;
+
+            //старый буфер после grow() освобождается, когда из него больше никто не читает
+            epochGuard guard;
+            slots *buff = buffer.load(std::memory_order_acquire);
+            T *rv = buff->get(t);
+            if(!top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed))
+                return nullptr;
+            return rv;
+        }
+
+        int64 size() const
+        {
+            int64 b = bottom.load(std::memory_order_relaxed);
+            int64 t = top.load(std::memory_order_relaxed);
+            return b>t ? b-t : 0;
+        }
+
+        bool isEmpty() const {return !size();}
+
+    private:
+
+        struct slots
+        {
+            slots(int64 size) : mask(size-1)
+            {
+                items = new std::atomic<T*>[size];
+            }
+            ~slots()
+            {
+                delete []items;
+            }
+
+            T* get(int64 ind) const
+            {
+                return items[ind & mask].load(std::memory_order_relaxed);
+            }
+            void put(int64 ind, T *val)
+            {
+                items[ind & mask].store(val,std::memory_order_relaxed);
+            }
+
+            int64 mask;
+            std::atomic<T*> *items;
+        };
+
+        slots* grow(slots *old, int64 b, int64 t)
+        {
+            slots *rv = new slots((old->mask+1)*2);
+            for(int64 i=t;i<b;i++)
+                rv->put(i,old->get(i));
+            buffer.store(rv,std::memory_order_release);
+            epochDomain::global().retire(old);
+            return rv;
+        }
+
+        alignas(64) std::atomic<int64> top = 0;
+        alignas(64) std::atomic<int64> bottom = 0;
+        std::atomic<slots*> buffer;
+    };
+
+    class threadPool;
+
+    //счетчик незавершенных задач, ожидающий поток выполняет задачи пула, а не просто спит
+    class taskGroup
+    {
+    public:
+        taskGroup(threadPool *pool = nullptr);
+        ~taskGroup();
+
+        taskGroup(const taskGroup &val) = delete;
+        taskGroup& operator=(const taskGroup &val) = delete;
+
+        template<typename F>
+        void run(F &&fun);
+
+        void wait();
+
+        //после true группу можно разрушать: последний finished() уже не обращается к ней
+        bool isDone() const
+        {
+            return !pending.load(std::memory_order_acquire) && !notifying.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class threadPool;
+
+        void started()
+        {
+            pending.fetch_add(1,std::memory_order_relaxed);
+        }
+        //ожидающий может вернуться сразу после обнуления pending, поэтому notify_all
+        //обрамлен счетчиком notifying, без которого isDone() не выполняется
+        void finished()
+        {
+            notifying.fetch_add(1,std::memory_order_relaxed);
+            if(pending.fetch_sub(1,std::memory_order_acq_rel)==1)
+                pending.notify_all();
+            notifying.fetch_sub(1,std::memory_order_release);
+        }
+
+        threadPool *pool;
+        std::atomic<int> pending = 0;
+        std::atomic<int> notifying = 0;
+    };
+
+    class threadPool : public delegateBase
+    {
+    public:
+        //workers<=0 - по числу ядер, доступных процессу;
+        //pinned - рабочие по кругу привязываются к процессорам маски процесса
+        threadPool(int workers = 0, bool pinned = false);
+        ~threadPool();
+
+        threadPool(const threadPool &val) = delete;
+        threadPool& operator=(const threadPool &val) = delete;
+
+        static threadPool& global();
+
+        //число процессоров в маске привязки процесса
+        static int affinityCount();
+
+        int workerCount() const {return workers.size();}
+
+        //номер рабочего этого пула в вызывающем потоке или -1
+        int currentWorker() const;
+
+        template<typename F>
+        void submit(F &&fun, taskGroup *group = nullptr)
+        {
+            push(new taskItem(std::function<void()>(std::forward<F>(fun)),group));
+        }
+
+        void submit(delegate<int,void*> proc, void *data, taskGroup *group = nullptr)
+        {
+            submit([proc,data]() mutable { proc(data); },group);
+        }
+
+        void submit(delegateProc<> proc, taskGroup *group = nullptr)
+        {
+            submit([proc]() mutable { proc(); },group);
+        }
+
+        //выполнить одну задачу в вызывающем потоке, если она есть
+        bool runPending();
+
+        void wait(taskGroup &group);
+
+        //задачи в очередях (оценка)
+        int64 pendingCount() const;
+
+    private:
+
+        struct taskItem
+        {
+            taskItem(std::function<void()> &&fun, taskGroup *group)
+                : fun(std::move(fun)), group(group)
+            {
+                if(group)
+                    group->started();
+            }
+
+            std::function<void()> fun;
+            taskGroup *group;
+        };
+
+        struct worker
+        {
+            workStealingDeque<taskItem> deque;
+            thread *hand = nullptr;
+            uint32 seed = 0;
+        };
+
+        void push(taskItem *item);
+        taskItem* take(int index);
+        void execute(taskItem *item);
+        void wakeup();
+        bool hasWork() const;
+
+        int workerProc(void *data);
+
+        array<worker*> workers;
+
+        semaphore inject_mutex;
+        array<taskItem*> injected;
+        int injected_head = 0;
+        std::atomic<int64> injected_count = 0;
+
+        std::atomic<uint32> epoch = 0;
+        std::atomic<int> sleepers = 0;
+        std::atomic<bool> stopping = false;
+    };
+
+    template<typename F>
+    void taskGroup::run(F &&fun)
+    {
+        pool->submit(std::forward<F>(fun),this);
+    }
+
+} // namespace alt
+
+#endif // ATHREADPOOL_H
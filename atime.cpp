@@ -27,30 +27,185 @@ SOFTWARE.
 #include "atime.h"
 
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
 #include <chrono>
 
+#if defined(ALT_TIME_TSC) && !defined(_MSC_VER)
+    #include <cpuid.h>
+#endif
+
 using namespace alt;
 
+enum
+{
+    SOURCE_CALIBRATING = timeSource::MONOTONIC+1
+};
+
+timeSource time::source = {{timeSource::UNKNOWN}, false, 1.0, 0, 0};
+
 alt::time time::current()
 {
     return time(uStamp());
 }
 
-#if !defined(linux) && !defined(__APPLE__)
-#include <intrin.h>
-
 uint64 time::systemTick()
 {
-    return __rdtsc();
+    return cycles();
 }
+
+uint64 time::monotonicStamp()
+{
+#if defined(linux) || defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW,&ts);
+    return uint64(ts.tv_sec)*1000000000ull+ts.tv_nsec;
 #else
-uint64 time::systemTick()
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static bool _time_counter_invariant()
+{
+#if defined(ALT_TIME_TSC)
+    //CPUID.80000007H:EDX[8] - частота TSC не зависит от P/C-состояний
+    uint32 regs[4] = {0,0,0,0};
+    #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info,0x80000000);
+    if(uint32(info[0])>=0x80000007)
+    {
+        __cpuid(info,0x80000007);
+        regs[3] = info[3];
+    }
+    #else
+    if(__get_cpuid_max(0x80000000,nullptr)>=0x80000007)
+        __get_cpuid(0x80000007,&regs[0],&regs[1],&regs[2],&regs[3]);
+    #endif
+    if(regs[3] & (1<<8))
+        return true;
+
+    #if defined(linux) || defined(__linux__)
+    //виртуальные машины часто прячут флаг, но ядро само проверяет TSC перед выбором источника
+    FILE *hand = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource","r");
+    if(hand)
+    {
+        char name[32] = {0};
+        bool rv = fgets(name,sizeof(name)-1,hand) && !strncmp(name,"tsc",3);
+        fclose(hand);
+        return rv;
+    }
+    #endif
+    return false;
+#elif defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+//пара (такты, наносекунды), снятая в самом узком окне из нескольких попыток
+static void _time_sample_pair(uint64 &cyc, uint64 &ns)
 {
-    uint64 d;
-    __asm__ __volatile__ ("rdtsc" : "=A" (d) );
-    return d;
+    cyc = 0;
+    ns = 0;
+    uint64 best = ~0ull;
+    for(int i=0;i<5;i++)
+    {
+        uint64 c0 = time::cycles();
+        uint64 m = time::monotonicStamp();
+        uint64 c1 = time::cycles();
+        if(c1-c0<best)
+        {
+            best = c1-c0;
+            cyc = c0+(c1-c0)/2;
+            ns = m;
+        }
+    }
 }
+
+void time::calibrate(int us)
+{
+    source.mode.store(SOURCE_CALIBRATING,std::memory_order_release);
+
+    source.invariant = _time_counter_invariant();
+
+#if defined(__aarch64__)
+    uint64 freq;
+    __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (freq));
+    source.nsPerCycle = freq ? 1e9/real(freq) : 1.0;
+    _time_sample_pair(source.baseCycles,source.baseNs);
+#elif defined(ALT_TIME_TSC)
+    uint64 c0,m0,c1,m1;
+    _time_sample_pair(c0,m0);
+    if(us<100) us = 100;
+    while(monotonicStamp()-m0 < uint64(us)*1000);
+    _time_sample_pair(c1,m1);
+    source.nsPerCycle = c1>c0 ? real(m1-m0)/real(c1-c0) : 1.0;
+    source.baseCycles = c1;
+    source.baseNs = m1;
+#else
+    (void)us;
+    source.nsPerCycle = 1.0;
+    _time_sample_pair(source.baseCycles,source.baseNs);
+#endif
+
+#if defined(ALT_TIME_TSC) || defined(__aarch64__)
+    source.mode.store(source.invariant ? timeSource::COUNTER : timeSource::MONOTONIC,std::memory_order_release);
+#else
+    source.mode.store(timeSource::MONOTONIC,std::memory_order_release);
 #endif
+}
+
+uint64 time::slowStamp()
+{
+    int mode = source.mode.load(std::memory_order_acquire);
+    if(mode==timeSource::UNKNOWN)
+    {
+        //калибрует первый пришедший поток, остальные пока идут через системные часы
+        if(source.mode.compare_exchange_strong(mode,SOURCE_CALIBRATING))
+        {
+            calibrate();
+            return nStamp();
+        }
+    }
+    return monotonicStamp();
+}
+
+//дождаться окончания калибровки, если она еще не выполнялась
+static int _time_source_ready(timeSource &src)
+{
+    int mode = src.mode.load(std::memory_order_acquire);
+    while(mode==timeSource::UNKNOWN || mode==SOURCE_CALIBRATING)
+    {
+        time::nStamp();
+        mode = src.mode.load(std::memory_order_acquire);
+    }
+    return mode;
+}
+
+uint64 time::cyclesToNs(uint64 delta)
+{
+    _time_source_ready(source);
+    return uint64(real(delta)*source.nsPerCycle);
+}
+
+real time::cyclesPerSecond()
+{
+    _time_source_ready(source);
+    return 1e9/source.nsPerCycle;
+}
+
+bool time::counterInvariant()
+{
+    _time_source_ready(source);
+    return source.invariant;
+}
+
+bool time::counterUsed()
+{
+    return _time_source_ready(source)==timeSource::COUNTER;
+}
 
 uint64 time::uStamp()
 {
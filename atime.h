@@ -29,8 +29,35 @@ SOFTWARE.
 
 #include "astring.h"
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define ALT_TIME_TSC
+#endif
+
 namespace alt {
 
+    //источник монотонного времени высокого разрешения: калиброванный счетчик тактов
+    //(TSC на x86, generic timer на aarch64) либо CLOCK_MONOTONIC_RAW, если счетчику нельзя доверять
+    struct timeSource
+    {
+        enum
+        {
+            UNKNOWN = 0,
+            COUNTER,
+            MONOTONIC
+        };
+
+        std::atomic<int> mode;
+        bool invariant;
+        real nsPerCycle;
+        uint64 baseCycles;
+        uint64 baseNs;
+    };
+
     class time
     {
     public:
@@ -75,6 +102,41 @@ namespace alt {
         static uint64 uStamp();
         static uint64 systemTick();
 
+        //сырой счетчик тактов, без сериализации
+        static uint64 cycles()
+        {
+        #if defined(ALT_TIME_TSC)
+            return __rdtsc();
+        #elif defined(__aarch64__)
+            uint64 val;
+            __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (val));
+            return val;
+        #else
+            return monotonicStamp();
+        #endif
+        }
+
+        //монотонное время в наносекундах, при пригодном счетчике без системного вызова
+        static uint64 nStamp()
+        {
+            if(source.mode.load(std::memory_order_acquire) == timeSource::COUNTER)
+            {
+                //счетчик другого ядра может отставать от точки калибровки на несколько тактов
+                int64 delta = int64(cycles()-source.baseCycles);
+                if(delta<=0)
+                    return source.baseNs;
+                return source.baseNs + uint64(real(delta)*source.nsPerCycle);
+            }
+            return slowStamp();
+        }
+
+        static uint64 cyclesToNs(uint64 delta);
+        static real cyclesPerSecond();
+        static bool counterInvariant();
+        static bool counterUsed();
+
+        static uint64 monotonicStamp();
+
         string toString(bool full = true);
 
         static string intervalString(uint64 start, uint64 end);
@@ -82,6 +144,14 @@ namespace alt {
 
     private:
 
+        static uint64 slowStamp();
+
+        //однократная калибровка при первом обращении, us - длительность замера;
+        //поля source пишутся до публикации mode и дальше не меняются
+        static void calibrate(int us = 2000);
+
+        static timeSource source;
+
         uint64 stamp;
     };
 
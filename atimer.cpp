@@ -0,0 +1,360 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "atimer.h"
+
+using namespace alt;
+
+static __inline uint32 _low_bit(uint64 val)
+{
+#ifdef _MSC_VER
+    unsigned long rv;
+    _BitScanForward64(&rv,val);
+    return rv;
+#else
+    return __builtin_ctzll(val);
+#endif
+}
+
+timerWheel::timerWheel(uint64 tick_us, threadPool *pool, uint64 start_us)
+{
+    this->tick_us = tick_us ? tick_us : 1;
+    this->start_us = start_us;
+    this->last_us = start_us;
+    this->pool = pool;
+    for(int i=0;i<LEVELS*SLOTS;i++)
+        buckets[i] = nullptr;
+    for(int i=0;i<LEVELS;i++)
+        occupied[i] = 0;
+}
+
+timerWheel::~timerWheel()
+{
+    for(int i=0;i<nodes.size();i++)
+        delete nodes[i];
+}
+
+timerId timerWheel::add(uint64 delay_us, std::function<void()> &&fun, uint64 period_us)
+{
+    node *n;
+    if(free_nodes.size())
+    {
+        n = nodes[free_nodes.pop()];
+    }
+    else
+    {
+        n = new node;
+        n->index = nodes.size();
+        n->gen = 1;
+        nodes.append(n);
+    }
+
+    //срок от времени последнего advance(), в тех же часах, что передает вызывающий
+    uint64 rel = (last_us>start_us ? last_us-start_us : 0)+delay_us;
+    n->expires = (rel+tick_us-1)/tick_us;
+    if(n->expires<=now_tick)
+        n->expires = now_tick+1;
+    n->period = period_us ? (period_us+tick_us-1)/tick_us : 0;
+    n->fun = std::move(fun);
+    count++;
+    link(n);
+
+    return (uint64(n->gen)<<32) | (n->index+1);
+}
+
+timerWheel::node* timerWheel::find(timerId id) const
+{
+    uint32 index = uint32(id)-1;
+    if(!uint32(id) || index>=uint32(nodes.size()))
+        return nullptr;
+    node *n = nodes[index];
+    if(n->gen!=uint32(id>>32) || (n->bucket<0 && !n->firing))
+        return nullptr;
+    return n;
+}
+
+void timerWheel::link(node *n)
+{
+    uint64 delta = n->expires-now_tick;
+    int level = 0;
+    while(level<LEVELS-1 && delta>=(uint64(1)<<(LEVEL_BITS*(level+1))))
+        level++;
+    if(delta>=(uint64(1)<<(LEVEL_BITS*LEVELS)))
+        n->expires = now_tick+(uint64(1)<<(LEVEL_BITS*LEVELS))-1;
+
+    int slot = int(n->expires>>(LEVEL_BITS*level))&(SLOTS-1);
+    int bucket = level*SLOTS+slot;
+    n->bucket = bucket;
+    n->prev = nullptr;
+    n->next = buckets[bucket];
+    if(n->next)
+        n->next->prev = n;
+    buckets[bucket] = n;
+    occupied[level] |= uint64(1)<<slot;
+}
+
+void timerWheel::unlink(node *n)
+{
+    if(n->prev)
+        n->prev->next = n->next;
+    else
+        buckets[n->bucket] = n->next;
+    if(n->next)
+        n->next->prev = n->prev;
+    if(!buckets[n->bucket])
+        occupied[n->bucket/SLOTS] &= ~(uint64(1)<<(n->bucket%SLOTS));
+    n->prev = n->next = nullptr;
+    n->bucket = -1;
+}
+
+void timerWheel::release(node *n)
+{
+    n->fun = nullptr;
+    n->gen++;
+    n->period = 0;
+    n->cancelled = false;
+    free_nodes.append(n->index);
+    count--;
+}
+
+bool timerWheel::cancel(timerId id)
+{
+    node *n = find(id);
+    if(!n || n->cancelled)
+        return false;
+    if(n->firing)
+    {
+        //разовый уже выполняется; периодический не будет перезапущен
+        if(!n->period)
+            return false;
+        n->cancelled = true;
+        return true;
+    }
+    unlink(n);
+    release(n);
+    return true;
+}
+
+bool timerWheel::isPending(timerId id) const
+{
+    node *n = find(id);
+    return n && !n->cancelled && !(n->firing && !n->period);
+}
+
+void timerWheel::cascade(int level)
+{
+    int bucket = level*SLOTS+(int(now_tick>>(LEVEL_BITS*level))&(SLOTS-1));
+    node *n = buckets[bucket];
+    buckets[bucket] = nullptr;
+    occupied[level] &= ~(uint64(1)<<(bucket%SLOTS));
+    while(n)
+    {
+        node *next = n->next;
+        link(n);
+        n = next;
+    }
+}
+
+int timerWheel::fireSlot(int slot)
+{
+    int fired = 0;
+    //обработчик может ставить таймеры, но не ближе следующего тика - в эту ячейку они не попадут
+    while(buckets[slot])
+    {
+        node *n = buckets[slot];
+        unlink(n);
+        fired++;
+
+        if(pool)
+        {
+            if(n->period)
+            {
+                pool->submit(n->fun);
+                n->expires = now_tick+n->period;
+                link(n);
+            }
+            else
+            {
+                pool->submit(std::move(n->fun));
+                release(n);
+            }
+            continue;
+        }
+
+        n->firing = true;
+        n->fun();
+        n->firing = false;
+        if(n->period && !n->cancelled)
+        {
+            n->expires = now_tick+n->period;
+            link(n);
+        }
+        else
+        {
+            release(n);
+        }
+    }
+    return fired;
+}
+
+int timerWheel::advance(uint64 now_us)
+{
+    if(now_us>last_us)
+        last_us = now_us;
+    uint64 target = now_us>start_us ? (now_us-start_us)/tick_us : 0;
+    int fired = 0;
+    while(now_tick<target)
+    {
+        if(!count)
+        {
+            now_tick = target;
+            break;
+        }
+
+        //до ближайшей непустой ячейки нижнего уровня или до конца его круга
+        uint64 t = now_tick+1;
+        int pos = int(t&(SLOTS-1));
+        if(pos)
+        {
+            uint64 mask = occupied[0]>>pos;
+            t += mask ? _low_bit(mask) : SLOTS-pos;
+            if(t>target)
+            {
+                now_tick = target;
+                break;
+            }
+        }
+        now_tick = t;
+
+        if(!(now_tick&(SLOTS-1)))
+        {
+            for(int level=1;level<LEVELS;level++)
+            {
+                cascade(level);
+                if((now_tick>>(LEVEL_BITS*level))&(SLOTS-1))
+                    break;
+            }
+        }
+        fired += fireSlot(int(now_tick&(SLOTS-1)));
+    }
+    return fired;
+}
+
+int64 timerWheel::untilNext(uint64 now_us) const
+{
+    if(!count)
+        return -1;
+
+    uint64 t = now_tick+1;
+    int pos = int(t&(SLOTS-1));
+    if(pos)
+    {
+        uint64 mask = occupied[0]>>pos;
+        t += mask ? _low_bit(mask) : SLOTS-pos;
+    }
+    uint64 due = start_us+t*tick_us;
+    return due>now_us ? int64(due-now_us) : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+timerService::timerService(uint64 tick_us, threadPool *pool)
+    : wheel(tick_us,pool ? pool : &threadPool::global())
+{
+    threadAttributes attr;
+    attr.name = "alt.timer";
+    hand = new thread(delegate<int,void*>(this,&timerService::proc),attr);
+    hand->run(nullptr);
+}
+
+timerService::~timerService()
+{
+    lock.lock();
+    stopping = true;
+    changed.notifyOne();
+    lock.unlock();
+
+    hand->wait();
+    delete hand;
+}
+
+timerService& timerService::global()
+{
+    static timerService service;
+    return service;
+}
+
+bool timerService::cancel(timerId id)
+{
+    lockGuard<mutex> guard(lock);
+    return wheel.cancel(id);
+}
+
+bool timerService::isPending(timerId id)
+{
+    lockGuard<mutex> guard(lock);
+    return wheel.isPending(id);
+}
+
+int timerService::size()
+{
+    lockGuard<mutex> guard(lock);
+    return wheel.size();
+}
+
+void timerService::wakeIfEarlier(uint64 delay_us)
+{
+    uint64 due = time::uStamp()+delay_us;
+    if(!wake_at || due<wake_at)
+    {
+        wake_at = due;
+        changed.notifyOne();
+    }
+}
+
+int timerService::proc(void *data)
+{
+    (void)data;
+
+    lock.lock();
+    while(!stopping)
+    {
+        wheel.advance();
+        int64 left = wheel.untilNext();
+        if(left<0)
+        {
+            wake_at = 0;
+            changed.wait(lock);
+        }
+        else if(left)
+        {
+            wake_at = time::uStamp()+left;
+            changed.wait(lock,left);
+        }
+    }
+    lock.unlock();
+    return 0;
+}
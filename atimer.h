@@ -0,0 +1,164 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ATIMER_H
+#define ATIMER_H
+
+#include "atypes.h"
+#include "at_array.h"
+#include "athread.h"
+#include "athreadpool.h"
+#include "atime.h"
+
+#include <functional>
+
+// Иерархическое колесо таймеров: постановка и отмена за O(1) при любом числе таймеров.
+// Уровень 0 - 64 ячейки по одному тику, каждый следующий в 64 раза грубее.
+// Когда младший уровень проходит круг, ячейка старшего пересыпается вниз,
+// так что таймер срабатывает в первый тик, не раньше своего срока.
+
+namespace alt {
+
+    //номер таймера; 0 - нет таймера
+    typedef uint64 timerId;
+
+    //не потокобезопасно: колесо ведет один поток (например, eventLoop)
+    class timerWheel
+    {
+    public:
+        //pool - вызывать обработчики в пуле, а не в потоке, вызвавшем advance()
+        timerWheel(uint64 tick_us = 1000, threadPool *pool = nullptr, uint64 start_us = time::uStamp());
+        ~timerWheel();
+
+        timerWheel(const timerWheel &val) = delete;
+        timerWheel& operator=(const timerWheel &val) = delete;
+
+        //срок отсчитывается от последнего advance() и округляется вверх до тика;
+        //колесо, долго не получавшее advance(), стоит сначала довести до текущего времени;
+        //period_us>0 - повторять с этим периодом до отмены
+        template <class F>
+        timerId schedule(uint64 delay_us, F &&fun, uint64 period_us = 0)
+        {
+            return add(delay_us,std::function<void()>(std::forward<F>(fun)),period_us);
+        }
+
+        //false, если таймер уже сработал или отменен; из обработчика можно отменить и себя
+        bool cancel(timerId id);
+        bool isPending(timerId id) const;
+
+        //выполнить все истекшие к now_us, вернуть их число
+        int advance(uint64 now_us = time::uStamp());
+
+        //через сколько мкс колесу нужен следующий advance() (не позже ближайшего срока), -1 - таймеров нет
+        int64 untilNext(uint64 now_us = time::uStamp()) const;
+
+        int size() const {return count;}
+        uint64 tickUs() const {return tick_us;}
+
+    private:
+        static const int LEVEL_BITS = 6;
+        static const int SLOTS = 1<<LEVEL_BITS;
+        static const int LEVELS = 6;
+
+        struct node
+        {
+            node *prev = nullptr;
+            node *next = nullptr;
+            uint64 expires = 0;   //тик срабатывания
+            uint64 period = 0;    //в тиках
+            uint32 index = 0;     //место в nodes
+            uint32 gen = 0;       //поколение для проверки номера
+            int bucket = -1;      //-1 - не в колесе
+            bool firing = false;
+            bool cancelled = false;
+            std::function<void()> fun;
+        };
+
+        timerId add(uint64 delay_us, std::function<void()> &&fun, uint64 period_us);
+        node* find(timerId id) const;
+        void link(node *n);
+        void unlink(node *n);
+        void release(node *n);
+        void cascade(int level);
+        int fireSlot(int slot);
+
+        uint64 tick_us;
+        uint64 start_us;
+        uint64 last_us;          //время последнего advance()
+        uint64 now_tick = 0;     //последний обработанный тик
+        threadPool *pool;
+        int count = 0;
+
+        node *buckets[LEVELS*SLOTS];
+        uint64 occupied[LEVELS];  //непустые ячейки уровня
+        array<node*> nodes;
+        array<uint32> free_nodes;
+    };
+
+    //потокобезопасная служба таймеров со своим потоком; обработчики выполняются в пуле,
+    //поэтому отмена не отзывает уже переданный пулу вызов
+    class timerService : public delegateBase
+    {
+    public:
+        timerService(uint64 tick_us = 1000, threadPool *pool = nullptr);
+        ~timerService();
+
+        timerService(const timerService &val) = delete;
+        timerService& operator=(const timerService &val) = delete;
+
+        static timerService& global();
+
+        template <class F>
+        timerId schedule(uint64 delay_us, F &&fun, uint64 period_us = 0)
+        {
+            lock.lock();
+            //поток службы мог спать без срока, срок считается от текущего времени
+            wheel.advance();
+            timerId rv = wheel.schedule(delay_us,std::forward<F>(fun),period_us);
+            wakeIfEarlier(delay_us);
+            lock.unlock();
+            return rv;
+        }
+
+        bool cancel(timerId id);
+        bool isPending(timerId id);
+        int size();
+
+    private:
+        void wakeIfEarlier(uint64 delay_us);
+        int proc(void *data);
+
+        mutex lock;
+        condVar changed;
+        timerWheel wheel;
+        uint64 wake_at = 0;   //0 - поток спит без срока
+        bool stopping = false;
+        thread *hand;
+    };
+
+} // namespace alt
+
+#endif // ATIMER_H
@@ -0,0 +1,333 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "atrace.h"
+#include "athread.h"
+#include "atime.h"
+#include "afile.h"
+#include "aprocess.h"
+
+using namespace alt;
+
+std::atomic<bool> trace::enabled(false);
+
+namespace {
+
+    enum traceEventType
+    {
+        evComplete,
+        evInstant,
+        evCounter
+    };
+
+    struct traceEvent
+    {
+        const char *cat;
+        const char *name;
+        uint64 start;
+        uint64 value; //длительность в нс или значение счетчика
+        int type;
+    };
+
+    //пишет только поток-владелец, читатель отбрасывает перезаписанные за время чтения события
+    struct traceThreadBuffer
+    {
+        long long tid;
+        string name;
+        traceEvent *events;
+        uint64 mask;
+        std::atomic<uint64> head;
+        std::atomic<uint64> tail; //начало непрочитанных после clear()
+        bool retired;             //поток-владелец завершился, под registryLock()
+    };
+
+    semaphore& registryLock()
+    {
+        static semaphore lock;
+        return lock;
+    }
+
+    array<traceThreadBuffer*>& registry()
+    {
+        static array<traceThreadBuffer*> list;
+        return list;
+    }
+
+    std::atomic<int> bufferSize(1<<16);
+
+    //начало отсчета времени в трассе
+    std::atomic<uint64> baseStamp(0);
+
+    //сколько буферов завершившихся потоков хранить до выгрузки; сверх этого
+    //новый поток забирает самый старый вместе с непрочитанными событиями
+    const int retiredLimit = 64;
+
+    thread_local traceThreadBuffer *localBuffer = nullptr;
+
+    //при завершении потока отдает его буфер для повторного использования
+    struct traceBufferOwner
+    {
+        traceThreadBuffer *buff = nullptr;
+
+        ~traceBufferOwner()
+        {
+            if(!buff)
+                return;
+            registryLock().lock();
+            buff->retired = true;
+            registryLock().unlock();
+            localBuffer = nullptr;
+        }
+    };
+
+    thread_local traceBufferOwner localOwner;
+
+    //буфер завершившегося потока того же размера: прочитанный, а при избытке - самый старый
+    traceThreadBuffer* reuse(uint64 mask)
+    {
+        array<traceThreadBuffer*> &list = registry();
+        traceThreadBuffer *oldest = nullptr;
+        int retired = 0;
+        for(int i=0;i<list.size();i++)
+        {
+            traceThreadBuffer *el = list[i];
+            if(!el->retired || el->mask!=mask)
+                continue;
+            if(el->tail.load(std::memory_order_relaxed)==el->head.load(std::memory_order_relaxed))
+                return el;
+            if(!oldest)
+                oldest = el;
+            retired++;
+        }
+        return retired>=retiredLimit ? oldest : nullptr;
+    }
+
+    traceThreadBuffer* local()
+    {
+        if(localBuffer)
+            return localBuffer;
+
+        int size = 1;
+        while(size<bufferSize.load(std::memory_order_relaxed))
+            size <<= 1;
+
+        registryLock().lock();
+        traceThreadBuffer *buff = reuse(uint64(size-1));
+        if(buff)
+        {
+            //head не откатывается: читатель сверяет его до и после копирования
+            buff->tail.store(buff->head.load(std::memory_order_relaxed),std::memory_order_relaxed);
+            buff->name = string();
+        }
+        else
+        {
+            buff = new traceThreadBuffer;
+            buff->events = new traceEvent[size];
+            buff->mask = size-1;
+            buff->head.store(0,std::memory_order_relaxed);
+            buff->tail.store(0,std::memory_order_relaxed);
+            registry().append(buff);
+        }
+        buff->tid = alt::threadId();
+        buff->retired = false;
+        registryLock().unlock();
+
+        localOwner.buff = buff;
+        localBuffer = buff;
+        return buff;
+    }
+
+    void push(const char *cat, const char *name, uint64 start, uint64 value, int type)
+    {
+        traceThreadBuffer *buff = local();
+        uint64 head = buff->head.load(std::memory_order_relaxed);
+        traceEvent &ev = buff->events[head & buff->mask];
+        ev.cat = cat;
+        ev.name = name;
+        ev.start = start;
+        ev.value = value;
+        ev.type = type;
+        buff->head.store(head+1,std::memory_order_release);
+    }
+
+    string escape(const char *str)
+    {
+        string rv;
+        if(!str)
+            return rv;
+        for(int i=0;str[i];i++)
+        {
+            char c = str[i];
+            if(c=='"' || c=='\\')
+            {
+                rv.append('\\');
+                rv.append(c);
+            }
+            else if(uint8(c)<0x20)
+            {
+                rv += string::print("\\u%04x",int(c));
+            }
+            else
+            {
+                rv.append(c);
+            }
+        }
+        return rv;
+    }
+
+}
+
+void trace::enable(bool on)
+{
+    if(on && !baseStamp.load(std::memory_order_relaxed))
+        baseStamp.store(ticks(),std::memory_order_relaxed);
+    enabled.store(on,std::memory_order_relaxed);
+}
+
+void trace::setBufferSize(int events)
+{
+    if(events<16)
+        events = 16;
+    bufferSize.store(events,std::memory_order_relaxed);
+}
+
+void trace::setThreadName(const string &name)
+{
+    traceThreadBuffer *buff = local();
+    registryLock().lock();
+    buff->name = name;
+    registryLock().unlock();
+}
+
+void trace::complete(const char *cat, const char *name, uint64 start, uint64 end)
+{
+    push(cat,name,start,end-start,evComplete);
+}
+
+void trace::instant(const char *cat, const char *name)
+{
+    push(cat,name,ticks(),0,evInstant);
+}
+
+void trace::counter(const char *cat, const char *name, int64 value)
+{
+    push(cat,name,ticks(),uint64(value),evCounter);
+}
+
+string trace::toJson(bool clear)
+{
+    uint64 base = baseStamp.load(std::memory_order_relaxed);
+
+    string pid = string::fromInt(alt::processId());
+    string rv(1<<16,true);
+    rv += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    registryLock().lock();
+    array<traceThreadBuffer*> &list = registry();
+    for(int i=0;i<list.size();i++)
+    {
+        traceThreadBuffer *buff = list[i];
+        string tid = string::fromInt(buff->tid);
+        string ids = ",\"pid\":"+pid+",\"tid\":"+tid;
+
+        if(!buff->name.isEmpty())
+        {
+            if(!first) rv += ",";
+            first = false;
+            rv += "{\"name\":\"thread_name\",\"ph\":\"M\""+ids+",\"args\":{\"name\":\""+escape(buff->name())+"\"}}";
+        }
+
+        uint64 size = buff->mask+1;
+        uint64 head = buff->head.load(std::memory_order_acquire);
+        uint64 from = buff->tail.load(std::memory_order_relaxed);
+        if(head-from>size) from = head-size;
+
+        array<traceEvent> copy;
+        copy.resize(head-from);
+        for(uint64 j=from;j<head;j++)
+            copy[j-from] = buff->events[j & buff->mask];
+
+        //то, что писатель успел перезаписать во время копирования, недостоверно,
+        //как и ячейка after, которую он мог начать заполнять до сдвига head
+        uint64 after = buff->head.load(std::memory_order_acquire);
+        uint64 valid = after-from>=size ? after-size+1 : from;
+
+        for(uint64 j=valid;j<head;j++)
+        {
+            const traceEvent &ev = copy[j-from];
+            if(ev.start<base)
+                continue;
+
+            if(!first) rv += ",";
+            first = false;
+
+            string ts = string::print("%.3f",real(ev.start-base)*0.001);
+            rv += "{\"name\":\""+escape(ev.name)+"\",\"cat\":\""+escape(ev.cat)+"\"";
+            switch(ev.type)
+            {
+            case evComplete:
+                rv += ",\"ph\":\"X\",\"ts\":"+ts+",\"dur\":"+string::print("%.3f",real(ev.value)*0.001);
+                break;
+            case evInstant:
+                rv += ",\"ph\":\"i\",\"s\":\"t\",\"ts\":"+ts;
+                break;
+            case evCounter:
+                rv += ",\"ph\":\"C\",\"ts\":"+ts+",\"args\":{\""+escape(ev.name)+"\":"+string::fromInt(int64(ev.value))+"}";
+                break;
+            }
+            rv += ids+"}";
+        }
+
+        if(clear)
+            buff->tail.store(head,std::memory_order_relaxed);
+    }
+    registryLock().unlock();
+
+    rv += "]}";
+    return rv;
+}
+
+bool trace::flush(const string &fname, bool clear)
+{
+    string json = toJson(clear);
+
+    alt::file hand(fname);
+    if(!hand.create())
+        return false;
+    bool rv = hand.write(json(),json.size()) == json.size();
+    hand.close();
+    return rv;
+}
+
+void trace::clear()
+{
+    registryLock().lock();
+    array<traceThreadBuffer*> &list = registry();
+    for(int i=0;i<list.size();i++)
+        list[i]->tail.store(list[i]->head.load(std::memory_order_acquire),std::memory_order_relaxed);
+    registryLock().unlock();
+}
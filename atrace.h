@@ -0,0 +1,124 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ATRACE_H
+#define ATRACE_H
+
+#include "atypes.h"
+#include "astring.h"
+#include "atime.h"
+
+// Трассировка по потокам с выгрузкой в формат Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Макросы ALT_TRACE_* компилируются только при ALT_TRACE_ENABLE, иначе раскрываются в пустоту.
+// Имена и категории должны жить все время работы программы (строковые литералы).
+
+namespace alt {
+
+    class trace
+    {
+    public:
+
+        static void enable(bool on = true);
+        static bool isEnabled()
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        //размер кольцевого буфера событий для потоков, начинающих писать после вызова
+        static void setBufferSize(int events);
+        static void setThreadName(const string &name);
+
+        //монотонное время в нс, см. time::nStamp()
+        static uint64 ticks()
+        {
+            return time::nStamp();
+        }
+
+        static void complete(const char *cat, const char *name, uint64 start, uint64 end);
+        static void instant(const char *cat, const char *name);
+        static void counter(const char *cat, const char *name, int64 value);
+
+        static string toJson(bool clear = false);
+        static bool flush(const string &fname, bool clear = true);
+        static void clear();
+
+    private:
+
+        static std::atomic<bool> enabled;
+    };
+
+    class traceScope
+    {
+    public:
+        traceScope(const char *name, const char *cat = "alt")
+        {
+            if(!trace::isEnabled())
+            {
+                scope_name = nullptr;
+                return;
+            }
+            scope_name = name;
+            scope_cat = cat;
+            start = trace::ticks();
+        }
+
+        ~traceScope()
+        {
+            if(scope_name)
+                trace::complete(scope_cat,scope_name,start,trace::ticks());
+        }
+
+        traceScope(const traceScope &val) = delete;
+        traceScope& operator=(const traceScope &val) = delete;
+
+    private:
+        const char *scope_name;
+        const char *scope_cat;
+        uint64 start;
+    };
+
+} // namespace alt
+
+#ifdef ALT_TRACE_ENABLE
+
+    #define ALT_TRACE_CONCAT_(a,b) a##b
+    #define ALT_TRACE_CONCAT(a,b) ALT_TRACE_CONCAT_(a,b)
+
+    #define ALT_TRACE_SCOPE(name) alt::traceScope ALT_TRACE_CONCAT(alt_trace_scope_,__LINE__)(name)
+    #define ALT_TRACE_SCOPE_CAT(cat,name) alt::traceScope ALT_TRACE_CONCAT(alt_trace_scope_,__LINE__)(name,cat)
+    #define ALT_TRACE_INSTANT(name) do{ if(alt::trace::isEnabled()) alt::trace::instant("alt",name); }while(0)
+    #define ALT_TRACE_COUNTER(name,value) do{ if(alt::trace::isEnabled()) alt::trace::counter("alt",name,value); }while(0)
+
+#else
+
+    #define ALT_TRACE_SCOPE(name) do{}while(0)
+    #define ALT_TRACE_SCOPE_CAT(cat,name) do{}while(0)
+    #define ALT_TRACE_INSTANT(name) do{}while(0)
+    #define ALT_TRACE_COUNTER(name,value) do{}while(0)
+
+#endif
+
+#endif // ATRACE_H
@@ -1,21 +1,30 @@
 #include "atranslate.h"
+#include "athread.h"
 
 using namespace alt;
 
 static hash<string,string> at_diction;
+static rwlock at_diction_lock; //словарь читают из любых потоков, меняют редко
 
 string alt::at(string text)
 {
-    if(at_diction[text].isEmpty()) return text;
-    return at_diction[text];
+    sharedLockGuard guard(at_diction_lock);
+    int ind = at_diction.indexOf(text);
+    if(ind<0 || at_diction.value(ind).isEmpty()) return text;
+    //счетчик ссылок строки не атомарный: читатели копируют содержимое, а не ссылку
+    string rv;
+    rv.deepCopy(at_diction.value(ind));
+    return rv;
 }
 
 hash<string,string> alt::translation()
 {
+    lockGuard<rwlock> guard(at_diction_lock);
     return at_diction;
 }
 
 void alt::setTranslation(hash<string,string> transl)
 {
+    lockGuard<rwlock> guard(at_diction_lock);
     at_diction.insert(transl);
 }
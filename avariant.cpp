@@ -78,6 +78,14 @@ intx variant::toInt(bool *ok) const
     return 0;
 }
 
+uintx variant::toUInt(bool *ok) const
+{
+    //строка разбирается без знакового предела, иначе верхняя половина диапазона насыщается
+    if(type==tString)
+        return (*data.vString).toInt<uintx>(10,ok);
+    return uintx(toInt(ok));
+}
+
 fraction<intx> variant::toFraction(bool *ok) const
 {
     if(ok)*ok=true;
@@ -135,7 +143,7 @@ string variant::toString(bool *ok, char sep) const
     case tString:
         return (*data.vString);
     case tReal:
-        return string::fromReal(data.vReal,20);
+        return string::fromReal(data.vReal);
     case tData:
         return (*data.vData).toHex();
     case tFraction:
@@ -196,7 +196,7 @@ namespace alt {
         //преобразовалки
         bool toBool(bool *ok = nullptr) const;
         intx toInt(bool *ok = nullptr) const;
-        uintx toUInt(bool *ok = nullptr) const {return toInt(ok);}
+        uintx toUInt(bool *ok = nullptr) const;
         realx toReal(bool *ok = nullptr) const;
         byteArray toData(bool *ok = nullptr) const;
         string toString(bool *ok = nullptr, char sep = ',') const;
@@ -0,0 +1,372 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#include "abench.h"
+#include "../afile.h"
+#include "../athread.h"
+
+#include <algorithm>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+using namespace alt;
+
+namespace {
+
+    struct benchEntry
+    {
+        string name;
+        benchRunner::benchFunction fun;
+    };
+
+    array<benchEntry>& benchList()
+    {
+        static array<benchEntry> list;
+        return list;
+    }
+
+    string jsonEscape(const string &str)
+    {
+        string rv(str.size()+8,true);
+        for(int i=0;i<str.size();i++)
+        {
+            char c = str[i];
+            if(c=='"' || c=='\\')
+            {
+                rv.append('\\');
+                rv.append(c);
+            }
+            else if(uint8(c)<0x20)
+            {
+                rv += string::print("\\u%04x",int(c));
+            }
+            else
+            {
+                rv.append(c);
+            }
+        }
+        return rv;
+    }
+
+    string jsonNumber(real val)
+    {
+        if(!isfinite(val))
+            return "null";
+        return string::print("%.6g",val);
+    }
+
+    string formatNs(real ns)
+    {
+        if(ns<1e3) return string::print("%.2f ns",ns);
+        if(ns<1e6) return string::print("%.2f us",ns*1e-3);
+        if(ns<1e9) return string::print("%.2f ms",ns*1e-6);
+        return string::print("%.2f s",ns*1e-9);
+    }
+
+    string formatRate(real val, const char *unit, int base)
+    {
+        static const char *prefix[] = {"","K","M","G","T"};
+        int ind = 0;
+        while(val>=base && ind<4)
+        {
+            val /= base;
+            ind++;
+        }
+        return string::print("%.2f %s%s/s",val,prefix[ind],unit);
+    }
+
+}
+
+bool benchRunner::add(const char *name, benchFunction fun)
+{
+    benchEntry el;
+    el.name = name;
+    el.fun = fun;
+    benchList().append(el);
+    return true;
+}
+
+bool benchRunner::pinCpu(int cpu)
+{
+    if(cpu<0)
+        return false;
+    threadAttributes attr;
+    attr.cpus.append(cpu);
+    return thread::setCurrentAttributes(attr); //macOS не дает жесткой привязки
+}
+
+uint64 benchRunner::measure(benchFunction &fun, uint64 count, benchState *out)
+{
+    benchState state(count);
+    benchClobber();
+    uint64 t0 = time::nStamp();
+    fun(state);
+    uint64 t1 = time::nStamp();
+    benchClobber();
+
+    uint64 elapsed = t1-t0;
+    elapsed = elapsed>state.paused ? elapsed-state.paused : 0;
+    if(out)
+        *out = state;
+    return elapsed;
+}
+
+benchResult benchRunner::run(const string &name, benchFunction fun, const benchOptions &opt)
+{
+    benchResult rv;
+    rv.name = name;
+
+    const uint64 target = uint64(opt.sampleTimeMs>0 ? opt.sampleTimeMs : 1)*1000000;
+    const uint64 warmup = uint64(opt.warmupMs>0 ? opt.warmupMs : 0)*1000000;
+
+    //подбор числа итераций, заодно первая часть прогрева
+    benchState probe(1);
+    uint64 count = 1;
+    uint64 started = time::nStamp();
+    for(;;)
+    {
+        uint64 elapsed = measure(fun,count,&probe);
+        if(!probe.skipped.isEmpty())
+        {
+            rv.skipped = probe.skipped;
+            return rv;
+        }
+        if(elapsed>=target || count>=(1ull<<40))
+            break;
+
+        uint64 next = elapsed ? uint64(real(count)*real(target)/real(elapsed)*1.2) : count*100;
+        if(next>count*100) next = count*100;
+        if(next<count*2) next = count*2;
+        count = next;
+    }
+
+    while(time::nStamp()-started<warmup)
+        measure(fun,count);
+
+    int samples = opt.samples>0 ? opt.samples : 1;
+    array<real> values;
+    values.resize(samples);
+    benchState last(count);
+    for(int i=0;i<samples;i++)
+        values[i] = real(measure(fun,count,&last))/real(count);
+
+    std::sort(values(),values()+samples);
+
+    real sum = 0.0;
+    for(int i=0;i<samples;i++)
+        sum += values[i];
+    rv.mean = sum/samples;
+    rv.median = samples&1 ? values[samples/2] : (values[samples/2-1]+values[samples/2])*0.5;
+    real var = 0.0;
+    for(int i=0;i<samples;i++)
+        var += (values[i]-rv.mean)*(values[i]-rv.mean);
+    rv.stddev = samples>1 ? sqrt(var/(samples-1)) : 0.0;
+    rv.min = values[0];
+    rv.max = values[samples-1];
+
+    rv.iterations = count;
+    rv.samples = samples;
+
+    //объемы относятся к одному вызову, скорость - по медиане
+    real seconds = rv.median*real(count)*1e-9;
+    if(seconds>0.0)
+    {
+        rv.bytesPerSecond = real(last.bytes)/seconds;
+        rv.itemsPerSecond = real(last.items)/seconds;
+    }
+    rv.counters = last.counters;
+
+    return rv;
+}
+
+array<benchResult> benchRunner::run(const benchOptions &opt)
+{
+    array<benchResult> rv;
+
+    if(opt.cpu>=0 && !pinCpu(opt.cpu) && !opt.quiet)
+        printf("warning: failed to pin to cpu %d\n",opt.cpu);
+
+    array<benchEntry> &list = benchList();
+    for(int i=0;i<list.size();i++)
+    {
+        if(!opt.filter.isEmpty() && list[i].name.indexOf(opt.filter)<0)
+            continue;
+
+        benchResult res = run(list[i].name,list[i].fun,opt);
+        if(!opt.quiet)
+        {
+            printf("%s\n",toText(res)());
+            fflush(stdout);
+        }
+        rv.append(res);
+    }
+
+    return rv;
+}
+
+string benchRunner::toText(const benchResult &res)
+{
+    string rv = string::print("%-40s",res.name());
+    if(!res.skipped.isEmpty())
+        return rv + " skipped: " + res.skipped;
+
+    rv += string::print(" %12s/iter  +-%5.1f%%  %12llu iters",formatNs(res.median)(),
+                        res.mean>0.0 ? res.stddev*100.0/res.mean : 0.0,
+                        (unsigned long long)res.iterations);
+    if(res.bytesPerSecond>0.0)
+        rv += "  " + formatRate(res.bytesPerSecond,"B",1024);
+    if(res.itemsPerSecond>0.0)
+        rv += "  " + formatRate(res.itemsPerSecond,"items",1000);
+
+    array<string> keys = res.counters.keys();
+    for(int i=0;i<keys.size();i++)
+        rv += "  " + keys[i] + "=" + string::print("%.4g",res.counters[keys[i]]);
+    return rv;
+}
+
+string benchRunner::toJson(const array<benchResult> &results, const benchOptions &opt)
+{
+    string rv(4096,true);
+
+    rv += "{\n  \"context\": {";
+    rv += "\"date\": \"" + time::current().toString() + "\"";
+    rv += ", \"cpus\": " + string::fromInt(int(std::thread::hardware_concurrency()));
+    rv += ", \"pinned_cpu\": " + string::fromInt(opt.cpu);
+    rv += ", \"counter_hz\": " + jsonNumber(time::cyclesPerSecond());
+    rv += ", \"counter_invariant\": " + string(time::counterInvariant() ? "true" : "false");
+#ifdef NDEBUG
+    rv += ", \"build\": \"release\"";
+#else
+    rv += ", \"build\": \"debug\"";
+#endif
+#ifdef __VERSION__
+    rv += ", \"compiler\": \"" + jsonEscape(__VERSION__) + "\"";
+#endif
+    rv += ", \"samples\": " + string::fromInt(opt.samples);
+    rv += ", \"sample_time_ms\": " + string::fromInt(opt.sampleTimeMs);
+    rv += "},\n  \"benchmarks\": [";
+
+    for(int i=0;i<results.size();i++)
+    {
+        const benchResult &res = results[i];
+        rv += i ? ",\n    {" : "\n    {";
+        rv += "\"name\": \"" + jsonEscape(res.name) + "\"";
+        if(!res.skipped.isEmpty())
+        {
+            rv += ", \"skipped\": \"" + jsonEscape(res.skipped) + "\"}";
+            continue;
+        }
+        rv += ", \"iterations\": " + string::fromInt(int64(res.iterations));
+        rv += ", \"samples\": " + string::fromInt(res.samples);
+        rv += ", \"ns_per_iter\": {\"median\": " + jsonNumber(res.median) +
+              ", \"mean\": " + jsonNumber(res.mean) +
+              ", \"stddev\": " + jsonNumber(res.stddev) +
+              ", \"min\": " + jsonNumber(res.min) +
+              ", \"max\": " + jsonNumber(res.max) + "}";
+        if(res.bytesPerSecond>0.0)
+            rv += ", \"bytes_per_second\": " + jsonNumber(res.bytesPerSecond);
+        if(res.itemsPerSecond>0.0)
+            rv += ", \"items_per_second\": " + jsonNumber(res.itemsPerSecond);
+
+        array<string> keys = res.counters.keys();
+        if(keys.size())
+        {
+            rv += ", \"counters\": {";
+            for(int j=0;j<keys.size();j++)
+            {
+                if(j) rv += ", ";
+                rv += "\"" + jsonEscape(keys[j]) + "\": " + jsonNumber(res.counters[keys[j]]);
+            }
+            rv += "}";
+        }
+        rv += "}";
+    }
+
+    rv += "\n  ]\n}\n";
+    return rv;
+}
+
+bool benchRunner::parseArgs(int argc, char **argv, benchOptions &opt)
+{
+    for(int i=1;i<argc;i++)
+    {
+        string arg = argv[i];
+        bool has_val = i+1<argc;
+
+        if(arg=="--filter" && has_val) opt.filter = argv[++i];
+        else if(arg=="--json" && has_val) opt.json = argv[++i];
+        else if(arg=="--cpu" && has_val) opt.cpu = atoi(argv[++i]);
+        else if(arg=="--samples" && has_val) opt.samples = atoi(argv[++i]);
+        else if(arg=="--time" && has_val) opt.sampleTimeMs = atoi(argv[++i]);
+        else if(arg=="--warmup" && has_val) opt.warmupMs = atoi(argv[++i]);
+        else if(arg=="--list") opt.list = true;
+        else if(arg=="--quiet") opt.quiet = true;
+        else
+        {
+            printf("usage: %s [--filter substr] [--json file] [--cpu n] [--samples n]\n"
+                   "          [--time ms_per_sample] [--warmup ms] [--list] [--quiet]\n",argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int benchRunner::main(int argc, char **argv)
+{
+    benchOptions opt;
+    if(!parseArgs(argc,argv,opt))
+        return 1;
+
+    if(opt.list)
+    {
+        array<benchEntry> &list = benchList();
+        for(int i=0;i<list.size();i++)
+        {
+            if(opt.filter.isEmpty() || list[i].name.indexOf(opt.filter)>=0)
+                printf("%s\n",list[i].name());
+        }
+        return 0;
+    }
+
+    array<benchResult> results = run(opt);
+
+    if(!opt.json.isEmpty())
+    {
+        string json = toJson(results,opt);
+        alt::file hand(opt.json);
+        if(!hand.create() || hand.write(json(),json.size())!=json.size())
+        {
+            printf("failed to write %s\n",opt.json());
+            return 1;
+        }
+        hand.close();
+    }
+
+    return 0;
+}
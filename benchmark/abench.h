@@ -0,0 +1,180 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+#ifndef ABENCH_H
+#define ABENCH_H
+
+#include "../atypes.h"
+#include "../astring.h"
+#include "../at_array.h"
+#include "../at_hash.h"
+#include "../atime.h"
+
+#include <functional>
+
+// Микробенчмарки: прогрев, подбор числа итераций под заданное время замера,
+// серия замеров со статистикой, привязка к ядру и вывод в JSON для сравнения прогонов.
+//
+//  ALT_BENCHMARK(hash_insert)
+//  {
+//      for(uint64 i=0;i<state.iterations();i++) ...
+//  }
+
+namespace alt {
+
+    template<typename T>
+    __inline void benchKeep(const T &val)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        __asm__ __volatile__ ("" : : "r,m" (val) : "memory");
+    #else
+        const volatile char *ptr = (const volatile char*)&val;
+        (void)*ptr;
+    #endif
+    }
+
+    __inline void benchClobber()
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        __asm__ __volatile__ ("" : : : "memory");
+    #else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    #endif
+    }
+
+    class benchState
+    {
+    public:
+        benchState(uint64 count) : count(count) {}
+
+        uint64 iterations() const {return count;}
+
+        //подготовка данных внутри замера не учитывается
+        void pauseTiming()
+        {
+            paused_at = time::nStamp();
+        }
+        void resumeTiming()
+        {
+            paused += time::nStamp()-paused_at;
+        }
+
+        //объем за весь вызов (все итерации)
+        void setBytes(uint64 val) {bytes = val;}
+        void setItems(uint64 val) {items = val;}
+
+        //произвольная величина в отчет, например коэффициент сжатия
+        void setCounter(const string &name, real val) {counters[name] = val;}
+
+        void skip(const string &reason) {skipped = reason;}
+
+    private:
+        friend class benchRunner;
+
+        uint64 count;
+        uint64 paused = 0;
+        uint64 paused_at = 0;
+        uint64 bytes = 0;
+        uint64 items = 0;
+        hash<string,real> counters;
+        string skipped;
+    };
+
+    struct benchResult
+    {
+        string name;
+        uint64 iterations = 0; //в одном замере
+        int samples = 0;
+
+        //нс на итерацию по замерам
+        real mean = 0.0;
+        real median = 0.0;
+        real stddev = 0.0;
+        real min = 0.0;
+        real max = 0.0;
+
+        real bytesPerSecond = 0.0;
+        real itemsPerSecond = 0.0;
+        hash<string,real> counters;
+        string skipped;
+    };
+
+    struct benchOptions
+    {
+        string filter;          //подстрока имени
+        int samples = 10;
+        int sampleTimeMs = 50;  //целевая длительность одного замера
+        int warmupMs = 100;
+        int cpu = -1;           //ядро для привязки, -1 - без привязки
+        string json;            //файл отчета
+        bool list = false;
+        bool quiet = false;
+    };
+
+    class benchRunner
+    {
+    public:
+        typedef std::function<void(benchState&)> benchFunction;
+
+        static bool add(const char *name, benchFunction fun);
+
+        static bool parseArgs(int argc, char **argv, benchOptions &opt);
+        static array<benchResult> run(const benchOptions &opt);
+        static benchResult run(const string &name, benchFunction fun, const benchOptions &opt);
+
+        static string toJson(const array<benchResult> &results, const benchOptions &opt);
+        static string toText(const benchResult &res);
+
+        static bool pinCpu(int cpu);
+
+        static int main(int argc, char **argv);
+
+    private:
+
+        static uint64 measure(benchFunction &fun, uint64 count, benchState *out = nullptr);
+    };
+
+    struct benchRegistrar
+    {
+        benchRegistrar(const char *name, benchRunner::benchFunction fun)
+        {
+            benchRunner::add(name,fun);
+        }
+    };
+
+} // namespace alt
+
+#define ALT_BENCHMARK(fun) \
+    static void fun(alt::benchState &state); \
+    static alt::benchRegistrar alt_bench_registrar_##fun(#fun,fun); \
+    static void fun(alt::benchState &state)
+
+#define ALT_BENCHMARK_NAMED(name,fun) \
+    static void fun(alt::benchState &state); \
+    static alt::benchRegistrar alt_bench_registrar_##fun(name,fun); \
+    static void fun(alt::benchState &state)
+
+#endif // ABENCH_H
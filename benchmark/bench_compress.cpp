@@ -0,0 +1,112 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Скорость и степень сжатия compress/arch на текстоподобных данных.
+
+#include "abench.h"
+#include "../compress/arch.h"
+
+#include <string.h>
+
+using namespace alt;
+
+static const int compressBlock = 64*1024;
+
+//слова с повторами и шумом - что-то между логом и исходником
+static const byteArray& compressData()
+{
+    static byteArray data;
+    if(!data.size())
+    {
+        static const char *words[] = {"int ","return ","for(","i=0;","i<size;","i++)","{\n","}\n",
+                                      "value","data[i]","+= ","alt::","string ","array<","> ","// "};
+        uint32 x = 17;
+        while(data.size()<compressBlock)
+        {
+            x ^= x<<13; x ^= x>>17; x ^= x<<5;
+            const char *word = words[x&15];
+            data.append(word,int(strlen(word)));
+            if(!(x&0x700))
+                data.append(uint8(x>>24));
+        }
+        data.resize(compressBlock);
+    }
+    return data;
+}
+
+typedef byteArray (*compressProc)(const void *data, int size);
+
+static void compressBench(benchState &state, compressProc proc)
+{
+    const byteArray &data = compressData();
+    byteArray packed;
+    for(uint64 i=0;i<state.iterations();i++)
+        packed = proc(data(),data.size());
+    state.setBytes(state.iterations()*data.size());
+    state.setCounter("ratio",packed.size() ? real(data.size())/real(packed.size()) : 0.0);
+}
+
+static void decompressBench(benchState &state, compressProc proc)
+{
+    state.pauseTiming();
+    const byteArray &data = compressData();
+    byteArray packed = proc(data(),data.size());
+    state.resumeTiming();
+
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += _arch_data_block_decompress(packed(),packed.size(),data.size()).size();
+    benchKeep(len);
+
+    if(len!=state.iterations()*data.size())
+        state.skip("decompressed size mismatch");
+    state.setBytes(state.iterations()*data.size());
+}
+
+ALT_BENCHMARK_NAMED("compress/rle", compress_rle)
+{
+    compressBench(state,_arch_data_block_compress_rle);
+}
+
+ALT_BENCHMARK_NAMED("compress/fast", compress_fast)
+{
+    compressBench(state,_arch_data_block_compress_fast);
+}
+
+ALT_BENCHMARK_NAMED("compress/best", compress_best)
+{
+    compressBench(state,_arch_data_block_compress_best);
+}
+
+ALT_BENCHMARK_NAMED("decompress/fast", decompress_fast)
+{
+    decompressBench(state,_arch_data_block_compress_fast);
+}
+
+ALT_BENCHMARK_NAMED("decompress/best", decompress_best)
+{
+    decompressBench(state,_arch_data_block_compress_best);
+}
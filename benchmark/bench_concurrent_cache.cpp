@@ -0,0 +1,130 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Масштабирование чтения concurrentCache по числу потоков: одинаковая нагрузка
+// на поток, рост items/s относительно варианта 1t показывает масштабирование.
+
+#include "abench.h"
+#include "../at_concurrent_cache.h"
+#include "../athread.h"
+
+using namespace alt;
+
+static const int cacheKeyCount = 1<<16;
+static const int cacheMaxThreads = 8;
+
+struct cacheBenchContext
+{
+    concurrentCache<uint32,uint64> *cache;
+    uint32 seed;
+    uint64 count;
+    uint64 found;
+};
+
+static int cacheReader(void *data)
+{
+    cacheBenchContext *ctx = (cacheBenchContext*)data;
+    uint32 x = ctx->seed;
+    uint64 found = 0;
+    for(uint64 i=0;i<ctx->count;i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        uint64 val;
+        if(ctx->cache->get(x&(cacheKeyCount-1),val)) found += val;
+    }
+    ctx->found = found;
+    return 0;
+}
+
+static concurrentCache<uint32,uint64>& benchCache()
+{
+    static concurrentCache<uint32,uint64> *cache = nullptr;
+    if(!cache)
+    {
+        cache = new concurrentCache<uint32,uint64>(cacheKeyCount,256);
+        for(uint32 i=0;i<cacheKeyCount;i++) cache->insert(i,i);
+    }
+    return *cache;
+}
+
+//потоки создаются один раз, чтобы их запуск не попадал в замер
+static thread** cachePool()
+{
+    static thread *pool[cacheMaxThreads-1] = {};
+    for(int i=0;i<cacheMaxThreads-1;i++)
+    {
+        if(!pool[i])
+            pool[i] = new thread(cacheReader);
+    }
+    return pool;
+}
+
+//iterations() чтений в каждом из threads потоков, включая вызывающий
+static void runReaders(benchState &state, int threads)
+{
+    concurrentCache<uint32,uint64> &cache = benchCache();
+    thread **pool = cachePool();
+
+    cacheBenchContext ctx[cacheMaxThreads];
+    for(int i=0;i<threads;i++)
+    {
+        ctx[i].cache = &cache;
+        ctx[i].seed = 0x9e3779b1u*(i+1);
+        ctx[i].count = state.iterations();
+        ctx[i].found = 0;
+    }
+    for(int i=1;i<threads;i++)
+        pool[i-1]->run(&ctx[i]);
+    cacheReader(&ctx[0]);
+    for(int i=1;i<threads;i++)
+        pool[i-1]->wait();
+
+    uint64 found = 0;
+    for(int i=0;i<threads;i++)
+        found += ctx[i].found;
+    benchKeep(found);
+    state.setItems(state.iterations()*threads);
+}
+
+ALT_BENCHMARK_NAMED("concurrentCache/get_1t", cache_concurrent_get_1)
+{
+    runReaders(state,1);
+}
+
+ALT_BENCHMARK_NAMED("concurrentCache/get_2t", cache_concurrent_get_2)
+{
+    runReaders(state,2);
+}
+
+ALT_BENCHMARK_NAMED("concurrentCache/get_4t", cache_concurrent_get_4)
+{
+    runReaders(state,4);
+}
+
+ALT_BENCHMARK_NAMED("concurrentCache/get_8t", cache_concurrent_get_8)
+{
+    runReaders(state,8);
+}
@@ -0,0 +1,161 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Вставка и поиск в контейнерах: array, hash, keyCache, concurrentCache.
+
+#include "abench.h"
+#include "../at_priority_cache.h"
+#include "../at_concurrent_cache.h"
+
+using namespace alt;
+
+static uint32 benchRandom(uint32 &x)
+{
+    x ^= x<<13; x ^= x>>17; x ^= x<<5;
+    return x;
+}
+
+ALT_BENCHMARK_NAMED("array/append", array_append)
+{
+    array<int> arr;
+    for(uint64 i=0;i<state.iterations();i++)
+        arr.append(int(i));
+    benchKeep(arr());
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("hash/insert_1k", hash_insert_1k)
+{
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        hash<uint32,uint32> tab;
+        for(int j=0;j<1024;j++)
+            tab.insert(benchRandom(x),j);
+        benchKeep(tab.size());
+    }
+    state.setItems(state.iterations()*1024);
+}
+
+static hash<uint32,uint32>& lookupTable()
+{
+    static hash<uint32,uint32> tab;
+    if(!tab.size())
+    {
+        for(uint32 i=0;i<(1<<16);i++)
+            tab.insert(i*2654435761u,i);
+    }
+    return tab;
+}
+
+ALT_BENCHMARK_NAMED("hash/lookup_64k_hit", hash_lookup_hit)
+{
+    hash<uint32,uint32> &tab = lookupTable();
+    uint32 x = 7;
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int ind = tab.indexOf((benchRandom(x)&0xffff)*2654435761u);
+        sum += ind;
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("hash/lookup_64k_miss", hash_lookup_miss)
+{
+    hash<uint32,uint32> &tab = lookupTable();
+    uint32 x = 7;
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int ind = tab.indexOf((benchRandom(x)&0xffff)*2654435761u+1);
+        sum += ind;
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+template<typename POLICY>
+static void keyCacheFind(benchState &state)
+{
+    //рабочее множество на 25% больше емкости
+    state.pauseTiming();
+    keyCache<uint32,uint64,POLICY> cache(1<<14);
+    for(uint32 i=0;i<(1<<14);i++)
+        cache.insert(i,i);
+    state.resumeTiming();
+
+    uint32 x = 3;
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        uint32 key = benchRandom(x)%(5<<12);
+        uint64 *val = cache.find(key);
+        if(val) sum += *val;
+        else cache.insert(key,key);
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+    state.setCounter("hit_ratio",cache.stats().hitRatio());
+}
+
+ALT_BENCHMARK_NAMED("keyCache/lru_find", keycache_lru)
+{
+    keyCacheFind<cacheLRU>(state);
+}
+
+ALT_BENCHMARK_NAMED("keyCache/arc_find", keycache_arc)
+{
+    keyCacheFind<cacheARC>(state);
+}
+
+ALT_BENCHMARK_NAMED("keyCache/tinylfu_find", keycache_tinylfu)
+{
+    keyCacheFind<cacheTinyLFU>(state);
+}
+
+ALT_BENCHMARK_NAMED("concurrentCache/get", concurrent_cache_get)
+{
+    static concurrentCache<uint32,uint64> *cache = nullptr;
+    if(!cache)
+    {
+        cache = new concurrentCache<uint32,uint64>(1<<16,64);
+        for(uint32 i=0;i<(1<<16);i++)
+            cache->insert(i,i);
+    }
+
+    uint32 x = 5;
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        uint64 val;
+        if(cache->get(benchRandom(x)&0xffff,val))
+            sum += val;
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Последовательные запись и чтение через alt::file. Чтение идет из кеша страниц,
+// так что это оценка накладных расходов обертки и системных вызовов, а не диска.
+
+#include "abench.h"
+#include "../afile.h"
+
+using namespace alt;
+
+static const int fileBlock = 64*1024;
+static const int64 fileLimit = 64*1024*1024;
+
+static string benchFileName()
+{
+    return "alt_bench_file.tmp";
+}
+
+ALT_BENCHMARK_NAMED("file/write_64k", file_write)
+{
+    array<uint8> block;
+    block.resize(fileBlock).fill(0x5a);
+
+    state.pauseTiming();
+    alt::file hand(benchFileName());
+    if(!hand.create())
+    {
+        state.skip("can't create " + benchFileName());
+        return;
+    }
+    state.resumeTiming();
+
+    int64 written = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        if(written>=fileLimit)
+        {
+            hand.seek(0);
+            written = 0;
+        }
+        written += hand.write(block(),fileBlock);
+    }
+
+    state.pauseTiming();
+    hand.close();
+    alt::file::remove(benchFileName());
+    state.resumeTiming();
+
+    state.setBytes(state.iterations()*fileBlock);
+}
+
+ALT_BENCHMARK_NAMED("file/read_64k", file_read)
+{
+    const int64 size = 16*1024*1024;
+    array<uint8> block;
+    block.resize(fileBlock).fill(0xa5);
+
+    state.pauseTiming();
+    alt::file hand(benchFileName());
+    if(!hand.create())
+    {
+        state.skip("can't create " + benchFileName());
+        return;
+    }
+    for(int64 i=0;i<size;i+=fileBlock)
+        hand.write(block(),fileBlock);
+    hand.seek(0);
+    state.resumeTiming();
+
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        if(hand.pos()>=size)
+            hand.seek(0);
+        sum += hand.read(block(),fileBlock);
+    }
+    benchKeep(sum);
+
+    state.pauseTiming();
+    hand.close();
+    alt::file::remove(benchFileName());
+    state.resumeTiming();
+
+    state.setBytes(state.iterations()*fileBlock);
+}
@@ -0,0 +1,78 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Выдача буферов: перебор sharedArrays против классов размеров bufferPool
+// при 256 одновременно удерживаемых буферах (конвейер кадров).
+
+#include "abench.h"
+#include "../athread.h"
+
+using namespace alt;
+
+static const int heldBuffers = 256;
+static const uintz frameSize = 4096;
+
+ALT_BENCHMARK_NAMED("pool/sharedArrays_256_held", pool_shared_arrays)
+{
+    sharedArrays arrays;
+    sharedArrayRef *held = new sharedArrayRef[heldBuffers];
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int ind = arrays.findIndex(frameSize);
+        arrays.getPointer(ind)[0] = uint8(i);
+        held[i%heldBuffers] = arrays.getReference(ind);
+    }
+    delete []held;
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("pool/bufferPool_256_held", pool_buffer_pool)
+{
+    bufferPool pool;
+    sharedArrayRef *held = new sharedArrayRef[heldBuffers];
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        sharedArrayRef buff = pool.acquire(frameSize);
+        buff.data()[0] = uint8(i);
+        held[i%heldBuffers] = buff;
+    }
+    delete []held;
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("pool/bufferPool_mixed_sizes", pool_buffer_pool_mixed)
+{
+    bufferPool pool;
+    sharedArrayRef *held = new sharedArrayRef[heldBuffers];
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        sharedArrayRef buff = pool.acquire(uintz(64)<<(i&7));
+        buff.data()[0] = uint8(i);
+        held[i%heldBuffers] = buff;
+    }
+    delete []held;
+    state.setItems(state.iterations());
+}
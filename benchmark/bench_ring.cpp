@@ -0,0 +1,113 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Пропускная способность кольцевого буфера: поштучно, блоками и между двумя потоками.
+
+#include "abench.h"
+#include "../at_ring.h"
+#include "../athread.h"
+
+using namespace alt;
+
+ALT_BENCHMARK_NAMED("ring/push_get", ring_push_get)
+{
+    ring<uint32> buff(1024);
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        buff.Push(uint32(i));
+        sum += buff.Get();
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("ring/block_4k", ring_block)
+{
+    const int block = 4096;
+    ring<uint8> buff(1<<16);
+    uint8 src[block], dst[block];
+    for(int i=0;i<block;i++)
+        src[i] = uint8(i);
+
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        buff.WriteBlock(src,block);
+        buff.Read(dst,block);
+    }
+    benchKeep(dst[block-1]);
+    state.setBytes(state.iterations()*block);
+}
+
+struct ringBenchContext
+{
+    ring<uint64> *buff;
+    uint64 count;
+    uint64 sum;
+};
+
+static int ringConsumer(void *data)
+{
+    ringBenchContext *ctx = (ringBenchContext*)data;
+    uint64 sum = 0;
+    for(uint64 i=0;i<ctx->count;)
+    {
+        if(!ctx->buff->Size())
+        {
+            alt::sleep(0);
+            continue;
+        }
+        sum += ctx->buff->Get();
+        i++;
+    }
+    ctx->sum = sum;
+    return 0;
+}
+
+ALT_BENCHMARK_NAMED("ring/spsc_2threads", ring_spsc)
+{
+    static thread *consumer = nullptr;
+    if(!consumer)
+        consumer = new thread(ringConsumer);
+
+    ring<uint64> buff(1<<12);
+    ringBenchContext ctx = {&buff,state.iterations(),0};
+    consumer->run(&ctx);
+
+    for(uint64 i=0;i<state.iterations();)
+    {
+        if(!buff.Push(i))
+        {
+            alt::sleep(0);
+            continue;
+        }
+        i++;
+    }
+    consumer->wait();
+
+    benchKeep(ctx.sum);
+    state.setItems(state.iterations());
+}
@@ -0,0 +1,525 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Операции alt::string: сборка, поиск, замена, преобразование чисел и регистра.
+
+#include "abench.h"
+#include "../aatom.h"
+#include "../astring_builder.h"
+#include "../amultisearch.h"
+
+using namespace alt;
+
+static string benchText(int size)
+{
+    static const char *words[] = {"alpha","beta","gamma","delta","epsilon","zeta","eta","theta"};
+    string rv(size+16,true);
+    uint32 x = 11;
+    while(rv.size()<size)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        rv += words[x&7];
+        rv += " ";
+    }
+    return rv.left(size);
+}
+
+//смешанный текст: латиница, кириллица, греческий
+static string benchTextUtf8(int size)
+{
+    static const char *words[] = {"alpha","Альфа","бета","Gamma","дельта","ЭПСИЛОН","ζήτα","theta"};
+    string rv(size+16,true);
+    uint32 x = 11;
+    while(rv.size()<size)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        rv += words[x&7];
+        rv += " ";
+    }
+    return rv;
+}
+
+ALT_BENCHMARK_NAMED("string/append_char", string_append_char)
+{
+    string str;
+    for(uint64 i=0;i<state.iterations();i++)
+        str.append(char('a'+(i&15)));
+    benchKeep(str());
+    state.setBytes(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/concat_small", string_concat_small)
+{
+    string a = "key", b = "value";
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string tmp = a + "=" + b;
+        len += tmp.size();
+    }
+    benchKeep(len);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/copy_short", string_copy_short)
+{
+    string src = "short-id";
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string tmp(src);
+        tmp.append('x');
+        len += tmp.size();
+    }
+    benchKeep(len);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/indexOf_4k", string_indexof)
+{
+    string hay = benchText(4096) + "needle";
+    string needle = "needle";
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += hay.indexOf(needle);
+    benchKeep(sum);
+    state.setBytes(state.iterations()*hay.size());
+}
+
+ALT_BENCHMARK_NAMED("string/indexOf_char_4k", string_indexof_char)
+{
+    string hay = benchText(4096) + "#";
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += hay.indexOf('#');
+    benchKeep(sum);
+    state.setBytes(state.iterations()*hay.size());
+}
+
+ALT_BENCHMARK_NAMED("string/replace_4k", string_replace)
+{
+    string src = benchText(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string tmp = src;
+        tmp.replace("gamma","GAMMA");
+        len += tmp.size();
+    }
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/replace_grow_4k", string_replace_grow)
+{
+    string src = benchText(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string tmp = src;
+        tmp.replaceAll("eta","<eta>");
+        len += tmp.size();
+    }
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/replaceChar_4k", string_replace_char)
+{
+    string src = benchText(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string tmp = src;
+        tmp.replaceChar(' ','_');
+        len += tmp.size();
+    }
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/findOneOfChar_4k", string_find_one_of)
+{
+    string hay = benchText(4096) + ";";
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += hay.findOneOfChar(0,",;:!?");
+    benchKeep(sum);
+    state.setBytes(state.iterations()*hay.size());
+}
+
+ALT_BENCHMARK_NAMED("string/findBackChar_4k", string_find_back_char)
+{
+    string hay = "#" + benchText(4096);
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += hay.findBackChar('#');
+    benchKeep(sum);
+    state.setBytes(state.iterations()*hay.size());
+}
+
+ALT_BENCHMARK_NAMED("string/toLower_4k", string_tolower)
+{
+    string src = benchText(4096);
+    for(int i=0;i<src.size();i+=3)
+        src()[i] = src[i]>='a' && src[i]<='z' ? src[i]-'a'+'A' : src[i];
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += src.toLower().size();
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/toLower_utf8_4k", string_tolower_utf8)
+{
+    string src = benchTextUtf8(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += src.toLower().size();
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/isValidUtf8_4k", string_valid_utf8)
+{
+    string src = benchTextUtf8(4096);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        cnt += src.isValidUtf8();
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/toUnicode16_4k", string_to_unicode16)
+{
+    string src = benchTextUtf8(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += src.toUnicode16().size();
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/toUnicode16_ascii_4k", string_to_unicode16_ascii)
+{
+    string src = benchText(4096);
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += src.toUnicode16().size();
+    benchKeep(len);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/fromUnicode16_4k", string_from_unicode16)
+{
+    array<charx> src = benchTextUtf8(4096).toUnicode16();
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += string::fromUnicode16(src()).size();
+    benchKeep(len);
+    state.setItems(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/split_4k", string_split)
+{
+    string src = benchText(4096);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        cnt += src.split(' ').size();
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*src.size());
+}
+
+ALT_BENCHMARK_NAMED("string/fromInt", string_fromint)
+{
+    uint64 len = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        len += string::fromInt(int64(i*2654435761u)).size();
+    benchKeep(len);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/fromReal", string_fromreal)
+{
+    uint64 len = 0;
+    real val = 0.1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        len += string::fromReal(val,10).size();
+        val += 1.37;
+    }
+    benchKeep(len);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/toInt", string_toint)
+{
+    string num = "-1234567890";
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += num.toInt<int64>();
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/toReal", string_toreal)
+{
+    string num = "-12345.678901";
+    real sum = 0.0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += num.toReal<real>();
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/fromReal_shortest", string_fromreal_shortest)
+{
+    uint64 len = 0;
+    real val = 0.1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        len += string::fromReal(val).size();
+        val += 1.37;
+    }
+    benchKeep(len);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/toInt_hex", string_toint_hex)
+{
+    string num = "0x7fe3a91c04d2";
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int64 val = 0;
+        num.tryInt(val);
+        sum += val;
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/toRealList_1k", string_toreal_list)
+{
+    string text;
+    for(int i=0;i<1000;i++)
+    {
+        if(i)text += ",";
+        text += string::fromReal(i*3.14159-1200.0,8);
+    }
+    real sum = 0.0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        array<real> list = string::toRealList<real>(text,',');
+        sum += list[list.size()-1];
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations()*1000);
+}
+
+ALT_BENCHMARK_NAMED("string/toIntegerList_1k", string_tointeger_list)
+{
+    string text;
+    for(int i=0;i<1000;i++)
+    {
+        if(i)text += ",";
+        text += string::fromInt(int64(i)*7919-3000000);
+    }
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        array<int64> list = string::toIntegerList<int64>(text,',');
+        sum += list[list.size()-1];
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations()*1000);
+}
+
+static array<string> benchKeys(int count)
+{
+    array<string> rv;
+    for(int i=0;i<count;i++)
+        rv.append("attribute_name_" + string::fromInt(i));
+    return rv;
+}
+
+ALT_BENCHMARK_NAMED("atom/intern_existing", atom_intern_existing)
+{
+    array<string> keys = benchKeys(1024);
+    for(int i=0;i<keys.size();i++)
+        atom tmp(keys[i]);
+    uint64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += atom(keys[i&1023]).id();
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("atom/hash_lookup", atom_hash_lookup)
+{
+    array<string> keys = benchKeys(1024);
+    array<atom> atoms;
+    hash<atom,int> map;
+    for(int i=0;i<keys.size();i++)
+    {
+        atoms.append(atom(keys[i]));
+        map[atoms.last()] = i;
+    }
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += map.value(map.indexOf(atoms[(i*7)&1023]));
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("atom/string_hash_lookup", atom_string_hash_lookup)
+{
+    array<string> keys = benchKeys(1024);
+    hash<string,int> map;
+    for(int i=0;i<keys.size();i++)
+        map[keys[i]] = i;
+    int64 sum = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        sum += map.value(map.indexOf(keys[(i*7)&1023]));
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("string/concat_report", string_concat_report)
+{
+    uint64 bytes = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        string rv;
+        for(int j=0;j<64;j++)
+            rv += string("item ")+string::fromInt(j)+": "+string::fromReal(j*0.25)+"\n";
+        bytes += rv.size();
+        benchKeep(rv);
+    }
+    state.setBytes(bytes);
+}
+
+ALT_BENCHMARK_NAMED("string/builder_report", string_builder_report)
+{
+    uint64 bytes = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        stringBuilder rv;
+        for(int j=0;j<64;j++)
+            rv.format("item {}: {}\n",j,j*0.25);
+        string out = rv.finish();
+        bytes += out.size();
+        benchKeep(out);
+    }
+    state.setBytes(bytes);
+}
+
+//ключевые слова из случайных букв, часть из них вставлена в текст
+static array<string> benchWords(int count)
+{
+    array<string> rv;
+    uint32 x = 7;
+    for(int i=0;i<count;i++)
+    {
+        string word;
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        int len = 4+(x&7);
+        for(int k=0;k<len;k++)
+        {
+            x ^= x<<13; x ^= x>>17; x ^= x<<5;
+            word.append(char('a'+x%26));
+        }
+        rv.append(word);
+    }
+    return rv;
+}
+
+static string benchWordText(const array<string> &words, int size)
+{
+    string rv = benchText(size);
+    for(int pos=0,i=0;pos+16<size;pos+=997,i+=13)
+    {
+        const string &word = words[i%words.size()];
+        alt::utils::memcpy(rv()+pos,word(),word.size());
+    }
+    return rv;
+}
+
+ALT_BENCHMARK_NAMED("search/indexOf_loop_1000_64k", search_indexof_loop)
+{
+    array<string> words = benchWords(1000);
+    string text = benchWordText(words,65536);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        for(int k=0;k<words.size();k++)
+        {
+            for(int pos=text.indexOf(words[k]);pos>=0;pos=text.indexOf(words[k],pos+1))
+                cnt++;
+        }
+    }
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*text.size());
+}
+
+ALT_BENCHMARK_NAMED("search/multi_1000_64k", search_multi)
+{
+    array<string> words = benchWords(1000);
+    string text = benchWordText(words,65536);
+    multiSearch matcher(words);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        cnt += matcher.findAll(text).size();
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*text.size());
+}
+
+ALT_BENCHMARK_NAMED("search/multi_caseless_1000_64k", search_multi_caseless)
+{
+    array<string> words = benchWords(1000);
+    string text = benchWordText(words,65536).toUpper();
+    multiSearch matcher(words,true);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        cnt += matcher.findAll(text).size();
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*text.size());
+}
+
+ALT_BENCHMARK_NAMED("search/multi_prefilter_64k", search_multi_prefilter)
+{
+    array<string> words;
+    words.append("zeta gamma");
+    words.append("xylophone");
+    words.append("quartz");
+    string text = benchText(65536);
+    multiSearch matcher(words);
+    uint64 cnt = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+        cnt += matcher.findAll(text).size();
+    benchKeep(cnt);
+    state.setBytes(state.iterations()*text.size());
+}
@@ -0,0 +1,225 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Примитивы синхронизации: futex-мьютекс и rwlock против pthread-семафора,
+// без конкуренции и при борьбе нескольких потоков за одну короткую секцию.
+
+#include "abench.h"
+#include "../athread.h"
+
+#include <functional>
+
+using namespace alt;
+
+static const int contendThreads = 4;
+
+struct syncBenchContext
+{
+    std::function<void(uint64)> body;
+    uint64 count;
+};
+
+static int syncWorker(void *data)
+{
+    syncBenchContext *ctx = (syncBenchContext*)data;
+    ctx->body(ctx->count);
+    return 0;
+}
+
+//glibc, пока процесс однопоточный, захватывает pthread-мьютекс без префикса lock,
+//поэтому рабочие создаются и до замеров без конкуренции
+static thread** syncPool()
+{
+    static thread *pool[contendThreads-1] = {};
+    for(int i=0;i<contendThreads-1;i++)
+    {
+        if(!pool[i])
+            pool[i] = new thread(syncWorker);
+    }
+    return pool;
+}
+
+//body(count) в contendThreads потоках, включая вызывающий
+static void runContended(benchState &state, std::function<void(uint64)> body)
+{
+    thread **pool = syncPool();
+
+    uint64 share = state.iterations()/contendThreads+1;
+    syncBenchContext ctx = {body,share};
+    for(int i=0;i<contendThreads-1;i++)
+        pool[i]->run(&ctx);
+    body(share);
+    for(int i=0;i<contendThreads-1;i++)
+        pool[i]->wait();
+
+    state.setItems(share*contendThreads);
+}
+
+ALT_BENCHMARK_NAMED("sync/semaphore_uncontended", sync_semaphore_single)
+{
+    syncPool();
+    semaphore lock;
+    uint64 counter = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        lock.lock();
+        counter++;
+        lock.unlock();
+    }
+    benchKeep(counter);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("sync/mutex_uncontended", sync_mutex_single)
+{
+    syncPool();
+    mutex lock;
+    uint64 counter = 0;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        lock.lock();
+        counter++;
+        lock.unlock();
+    }
+    benchKeep(counter);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("sync/semaphore_contended_4t", sync_semaphore_contended)
+{
+    semaphore lock;
+    uint64 counter = 0;
+    runContended(state,[&](uint64 count)
+    {
+        for(uint64 i=0;i<count;i++)
+        {
+            lock.lock();
+            counter++;
+            lock.unlock();
+        }
+    });
+    benchKeep(counter);
+}
+
+ALT_BENCHMARK_NAMED("sync/mutex_contended_4t", sync_mutex_contended)
+{
+    mutex lock;
+    uint64 counter = 0;
+    runContended(state,[&](uint64 count)
+    {
+        for(uint64 i=0;i<count;i++)
+        {
+            lock.lock();
+            counter++;
+            lock.unlock();
+        }
+    });
+    benchKeep(counter);
+}
+
+//чтение преобладает: одна запись на 64 операции
+ALT_BENCHMARK_NAMED("sync/semaphore_read_mostly_4t", sync_semaphore_read_mostly)
+{
+    semaphore lock;
+    uint64 table[16] = {};
+    runContended(state,[&](uint64 count)
+    {
+        uint64 sum = 0;
+        for(uint64 i=0;i<count;i++)
+        {
+            lock.lock();
+            if(!(i&63))
+                table[i&15]++;
+            else
+                sum += table[i&15];
+            lock.unlock();
+        }
+        benchKeep(sum);
+    });
+}
+
+ALT_BENCHMARK_NAMED("sync/rwlock_read_mostly_4t", sync_rwlock_read_mostly)
+{
+    rwlock lock;
+    uint64 table[16] = {};
+    runContended(state,[&](uint64 count)
+    {
+        uint64 sum = 0;
+        for(uint64 i=0;i<count;i++)
+        {
+            if(!(i&63))
+            {
+                lock.lock();
+                table[i&15]++;
+                lock.unlock();
+            }
+            else
+            {
+                lock.lockShared();
+                sum += table[i&15];
+                lock.unlockShared();
+            }
+        }
+        benchKeep(sum);
+    });
+}
+
+//передача эстафеты между двумя потоками
+ALT_BENCHMARK_NAMED("sync/condvar_pingpong", sync_condvar_pingpong)
+{
+    static thread *partner = nullptr;
+    if(!partner)
+        partner = new thread(syncWorker);
+
+    mutex lock;
+    condVar cv;
+    uint64 turn = 0;
+    syncBenchContext ctx;
+    ctx.count = state.iterations();
+    ctx.body = [&](uint64 count)
+    {
+        for(uint64 i=0;i<count;i++)
+        {
+            lockGuard<mutex> guard(lock);
+            cv.wait(lock,[&]{return turn&1;});
+            turn++;
+            cv.notifyOne();
+        }
+    };
+    partner->run(&ctx);
+
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        lockGuard<mutex> guard(lock);
+        cv.wait(lock,[&]{return !(turn&1);});
+        turn++;
+        cv.notifyOne();
+    }
+    partner->wait();
+
+    benchKeep(turn);
+    state.setItems(state.iterations());
+}
@@ -0,0 +1,118 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Правка документа 4 МБ: вставка в середину textBuffer против пересборки string,
+// поиск смещения строки и снимок.
+
+#include "abench.h"
+#include "../atext_buffer.h"
+
+using namespace alt;
+
+static const int docSize = 4<<20;
+
+static string benchDocument()
+{
+    string rv(docSize,false);
+    uint32 x = 3;
+    char *buff = rv();
+    for(int i=0;i<docSize;i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        buff[i] = (x&63)==0 ? '\n' : char('a'+x%26);
+    }
+    return rv;
+}
+
+ALT_BENCHMARK_NAMED("text/string_insert_middle_4m", text_string_insert)
+{
+    string doc = benchDocument();
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        int pos = int(x%doc.size());
+        doc = doc.left(pos)+"edit"+doc.right(pos);
+    }
+    benchKeep(doc.size());
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("text/buffer_insert_middle_4m", text_buffer_insert)
+{
+    textBuffer doc(benchDocument());
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        doc.insert(int64(x%doc.size()),"edit",4);
+    }
+    benchKeep(doc.size());
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("text/buffer_remove_4m", text_buffer_remove)
+{
+    textBuffer doc(benchDocument());
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        if(doc.size()<docSize/2)doc = textBuffer(benchDocument());
+        doc.remove(int64(x%doc.size()),4);
+    }
+    benchKeep(doc.size());
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("text/buffer_lineOffset_4m", text_buffer_line_offset)
+{
+    textBuffer doc(benchDocument());
+    int64 lines = doc.lineCount();
+    int64 sum = 0;
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        sum += doc.lineOffset(int64(x%lines));
+    }
+    benchKeep(sum);
+    state.setItems(state.iterations());
+}
+
+ALT_BENCHMARK_NAMED("text/buffer_snapshot_edit_4m", text_buffer_snapshot)
+{
+    textBuffer doc(benchDocument());
+    uint32 x = 1;
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        x ^= x<<13; x ^= x>>17; x ^= x<<5;
+        textBuffer snapshot = doc;
+        doc.insert(int64(x%doc.size()),"edit",4);
+        benchKeep(snapshot.size());
+    }
+    state.setItems(state.iterations());
+}
@@ -0,0 +1,107 @@
+/*****************************************************************************
+
+This is part of Alterlib - the free code collection under the MIT License
+------------------------------------------------------------------------------
+Copyright (C) 2006-2025 Maxim L. Grishin  (altmer@arts-union.ru)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*****************************************************************************/
+
+// Таймауты: постановка и отмена при 100 тыс. ожидающих таймеров -
+// колесо timerWheel против двоичной кучи с ленивой отменой.
+
+#include "abench.h"
+#include "../atimer.h"
+
+#include <queue>
+#include <vector>
+#include <unordered_set>
+
+using namespace alt;
+
+static const int pendingTimers = 100000;
+
+ALT_BENCHMARK_NAMED("timer/wheel_schedule_cancel_100k", timer_wheel_schedule_cancel)
+{
+    timerWheel wheel(1000);
+    std::vector<timerId> ids(pendingTimers);
+    for(int i=0;i<pendingTimers;i++)
+        ids[i] = wheel.schedule(1000000+i*10,[]() {});
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int ind = int(i%pendingTimers);
+        wheel.cancel(ids[ind]);
+        ids[ind] = wheel.schedule(1000000+(i&0xffff)*10,[]() {});
+    }
+    state.setItems(state.iterations());
+    benchKeep(wheel.size());
+}
+
+ALT_BENCHMARK_NAMED("timer/heap_schedule_cancel_100k", timer_heap_schedule_cancel)
+{
+    struct item
+    {
+        uint64 deadline;
+        uint64 id;
+        bool operator<(const item &val) const {return deadline>val.deadline;}
+    };
+    std::priority_queue<item> heap;
+    std::unordered_set<uint64> live;
+    std::vector<uint64> ids(pendingTimers);
+    uint64 next = 0;
+    for(int i=0;i<pendingTimers;i++)
+    {
+        ids[i] = ++next;
+        heap.push({time::uStamp()+1000000+i*10,ids[i]});
+        live.insert(ids[i]);
+    }
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        int ind = int(i%pendingTimers);
+        live.erase(ids[ind]);
+        ids[ind] = ++next;
+        heap.push({time::uStamp()+1000000+(i&0xffff)*10,ids[ind]});
+        live.insert(ids[ind]);
+        //отмененные выбрасываются, только дойдя до вершины
+        while(!heap.empty() && !live.count(heap.top().id))
+            heap.pop();
+    }
+    state.setItems(state.iterations());
+    benchKeep(heap.size());
+}
+
+ALT_BENCHMARK_NAMED("timer/wheel_fire", timer_wheel_fire)
+{
+    uint64 fired = 0;
+    uint64 now = time::uStamp();
+    timerWheel wheel(1000,nullptr,now);
+    for(uint64 i=0;i<state.iterations();i++)
+    {
+        wheel.schedule(i&1023,[&fired]() { fired++; });
+        if((i&1023)==1023)
+        {
+            now += 2000;
+            wheel.advance(now);
+        }
+    }
+    wheel.advance(now+2000000);
+    state.setItems(state.iterations());
+    benchKeep(fired);
+}
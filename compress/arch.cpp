@@ -29,6 +29,7 @@ SOFTWARE.
 #include "arch_prefix.h"
 #include "arch_arith.h"
 #include "arch_diction.h"
+#include "../atrace.h"
 
 #define ARCH_HEAD_UNCODED                   0
 
@@ -44,6 +45,7 @@ SOFTWARE.
 
 alt::byteArray _arch_data_block_compress_best(const void *data_p, int size)
 {
+    ALT_TRACE_SCOPE_CAT("compress","arch::compressBest");
     alt::byteArray result;
     MDWFormat delta_form;
     alt::byteArray delta, delta_dict, dict;
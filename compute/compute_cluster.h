@@ -3,6 +3,7 @@
 
 #include "../atypes.h"
 #include "../astring.h"
+#include "../astring_builder.h"
 #include "../at_hash.h"
 #include "../at_tensor.h"
 #include "../adelegate.h"
@@ -46,14 +47,16 @@ struct deviceInfo
 
     string toText()
     {
-        string rv = name + " [" + string::fromInt(index) + "] "+api_type+" "+api_version
-                +" (BLOCK:"+max_threads_per_dimension.toString()+"<="+string::fromInt(max_threads_total)
-                +",GRID:"+max_grid_size.toString() + ",WARP:"+string::fromInt(max_warp_size) + ",CORE:" + string::fromInt(total_cores)
-                +",RAM:"+string::fromInt(global_memory_size)+",SMEM:"+string::fromInt(shared_memory_size)
-                +",CMEM:"+string::fromInt(constant_memory_size)+")";
+        stringBuilder rv(256);
+        rv.format("{} [{}] {} {} (BLOCK:{}<={},GRID:{},WARP:{},CORE:{},RAM:{},SMEM:{},CMEM:{})",
+                  name, index, api_type, api_version,
+                  max_threads_per_dimension, max_threads_total,
+                  max_grid_size, max_warp_size, total_cores,
+                  global_memory_size, shared_memory_size, constant_memory_size);
         for(int i=0;i<api_related.size();i++)
-            rv += "\n\t"+api_related.key(i)+" = "+api_related.value(i).toString();
-        return rv+"\n";
+            rv.format("\n\t{} = {}", api_related.key(i), api_related.value(i));
+        rv << '\n';
+        return rv.finish();
     }
 };
 
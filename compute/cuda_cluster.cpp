@@ -1,4 +1,5 @@
 #include "cuda_cluster.h"
+#include "../atrace.h"
 
 #include <cuda.h>
 #include <cuda_runtime.h>
@@ -423,6 +424,7 @@ computeKernel cudaCluster::kernelCompile(int device, const string &name, const s
 
 retCode cudaCluster::kernelCall(const computeKernel &hand, dimensions<uint64> threads_block, dimensions<uint64> works_area)
 {
+    ALT_TRACE_SCOPE_CAT("compute","cudaCluster::kernelCall");
     if(last_error.error()) return last_error;
     cudaStuff *stuff = reinterpret_cast<cudaStuff*>(internal_data);
 
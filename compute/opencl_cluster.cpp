@@ -1,4 +1,5 @@
 #include "opencl_cluster.h"
+#include "../atrace.h"
 
 #include <CL/cl.h>
 
@@ -372,6 +373,7 @@ static void CL_CALLBACK  opencl_event_notify(cl_event event, cl_int event_comman
 
 retCode openclCluster::kernelCall(const computeKernel &hand, dimensions<uint64> threads_block, dimensions<uint64> works_area)
 {
+    ALT_TRACE_SCOPE_CAT("compute","openclCluster::kernelCall");
     if(last_error.error()) return last_error;
     openclStuff *stuff = reinterpret_cast<openclStuff*>(internal_data);
 
@@ -32,12 +32,14 @@ AGLFont::AGLFont(alt::string font, int block_limit)
 {
     //дефолтные настройки
     blocklimit=block_limit;
+    initBlocks();
     curr_color=alt::colorRGBA(255,255,255,255);
     curr_font=font;
 }
 AGLFont::AGLFont()
 {
     blocklimit=16;
+    initBlocks();
     #ifdef QT_WIDGETS_LIB
     QFont fnt("Courier",14);
     fnt.setBold(true);
@@ -197,21 +199,7 @@ bool AGLFont::spacingAbs()
 
 void AGLFont::clear()
 {
-    alt::array< alt::hash<int,aglFontBlock> > fparts=fonts.values();
-    for(int i=0;i<fparts.size();i++)
-    {
-        alt::array<aglFontBlock> blocks=fparts[i].values();
-        for(int j=0;j<blocks.size();j++)
-        {
-            alt::array<alt::GLTexture*> texs=blocks[j].textures;
-            for(int k=0;k<texs.size();k++)
-            {
-                delete texs[k];
-            }
-        }
-    }
-    fonts.clear();
-    cache.Clear();
+    blocks.clear();
 
     #ifndef QT_WIDGETS_LIB
     for(int i=0;i<fonts_data.size();i++)
@@ -229,6 +217,18 @@ AGLFont::~AGLFont()
     clear();
 }
 
+void AGLFont::initBlocks()
+{
+    blocks.setLimits(blocklimit);
+    blocks.onDrop([](const aglFontBlockKey&, aglFontBlock &block, alt::keyCache<aglFontBlockKey,aglFontBlock>::DropReason)
+    {
+        for(int k=0;k<block.textures.size();k++)
+        {
+            delete block.textures[k];
+        }
+    });
+}
+
 alt::vec2d<real32> AGLFont::printSize(const alt::string &val, int *lineCount)
 {
     alt::vec2d<real32> siz(0,0);
@@ -240,11 +240,7 @@ alt::vec2d<real32> AGLFont::printSize(const alt::string &val, int *lineCount)
     aglFontBlock *block;
 
     //создаем блоки
-    if(!fonts.contains(curr_font))createBlock(index);
-    if(!fonts[curr_font].contains(index))createBlock(index);
-
-    block=&fonts[curr_font][index];
-    cache.Update(block->cacheIndex);
+    block=fetchBlock(index);
 
     if(lineCount)*lineCount=1;
 
@@ -256,10 +252,7 @@ alt::vec2d<real32> AGLFont::printSize(const alt::string &val, int *lineCount)
         {
             index=(uval>>8);
             //создаем блоки
-            if(!fonts.contains(curr_font))createBlock(index);
-            if(!fonts[curr_font].contains(index))createBlock(index);
-            block=&fonts[curr_font][index];
-            cache.Update(block->cacheIndex);
+            block=fetchBlock(index);
         }
 
         //учитываем перенос строки
@@ -603,10 +596,7 @@ void AGLFont::printInQuad(const alt::string &val,
     aglFontBlock *block;
 
     //создаем символьные блоки, если нужно
-    if(!fonts.contains(curr_font))createBlock(index);
-    if(!fonts[curr_font].contains(index))createBlock(index);
-    block=&fonts[curr_font][index];
-    cache.Update(block->cacheIndex);
+    block=fetchBlock(index);
 
     //разрешим прозрачность
     glEnable(GL_ALPHA_TEST);
@@ -661,10 +651,7 @@ void AGLFont::printInQuad(const alt::string &val,
                 glDrawArrays(GL_TRIANGLES, 0, coords.size()>>1);
             }
 
-            if(!fonts.contains(curr_font))createBlock(index);
-            if(!fonts[curr_font].contains(index))createBlock(index);
-            block=&fonts[curr_font][index];
-            cache.Update(block->cacheIndex);
+            block=fetchBlock(index);
             tind=-1;
 
             vertexes.clear();
@@ -764,11 +751,7 @@ real32 AGLFont::print(const alt::string &val, const alt::vec2d<real32> &pnt, rea
     int tind=-1;
     aglFontBlock *block;
 
-    if(!fonts.contains(curr_font))createBlock(index);
-    if(!fonts[curr_font].contains(index))createBlock(index);
-
-    block=&fonts[curr_font][index];
-    cache.Update(block->cacheIndex);
+    block=fetchBlock(index);
 
     glColor4f(curr_color.rf(),curr_color.gf(),
               curr_color.bf(),curr_color.af());
@@ -797,10 +780,7 @@ real32 AGLFont::print(const alt::string &val, const alt::vec2d<real32> &pnt, rea
                 glTexCoordPointer(2, GL_FLOAT, 0, coords());
                 glDrawArrays(GL_TRIANGLES, 0, coords.size()>>1);
             }
-            if(!fonts.contains(curr_font))createBlock(index);
-            if(!fonts[curr_font].contains(index))createBlock(index);
-            block=&fonts[curr_font][index];
-            cache.Update(block->cacheIndex);
+            block=fetchBlock(index);
             tind=-1;
             vertexes.clear();
             coords.clear();
@@ -870,33 +850,19 @@ real32 AGLFont::print(const alt::string &val, const alt::vec2d<real32> &pnt, rea
     return xoff;
 }
 
-void AGLFont::checkBlocksLifeCicle()
+aglFontBlock* AGLFont::fetchBlock(int index)
 {
-    while(cache.Size()>blocklimit)
-    {
-        alt::pair<alt::string,int> el=cache.ForRemove();
-        cache.Delete(fonts[el.left()][el.right()].cacheIndex);
-
-        alt::array<alt::GLTexture*> texs=fonts[el.left()][el.right()].textures;
-        for(int k=0;k<texs.size();k++)
-        {
-            delete texs[k];
-        }
-        fonts[el.left()].remove(el.right());
-        if(!fonts[el.left()].size())
-        {
-            fonts.remove(el.left());
-        }
-    }
+    aglFontBlock *block=blocks.find(aglFontBlockKey(curr_font,index));
+    if(!block)block=createBlock(index);
+    return block;
 }
 
-void AGLFont::createBlock(int index)
+aglFontBlock* AGLFont::createBlock(int index)
 {
     onStartBlock();
 
     //блок
     aglFontBlock block;
-    checkBlocksLifeCicle();
     block.height=0;
     block.spacing=getSpacing();
     block.spacing_is_abs=spacingAbs();
@@ -954,8 +920,8 @@ void AGLFont::createBlock(int index)
 
     //запишем блок
     if(str_height>block.height)block.height=str_height;
-    block.cacheIndex=cache.Push(alt::pair<alt::string,int>(curr_font,index));
-    fonts[curr_font][index]=block;
+    aglFontBlock *rv=blocks.insert(aglFontBlockKey(curr_font,index),block);
 
     onEndBlock();
+    return rv;
 }
@@ -54,10 +54,27 @@ struct aglFontBlock
     real32 height;
     real32 spacing;
     bool spacing_is_abs;
+};
+
+struct aglFontBlockKey
+{
+    aglFontBlockKey(){index=0;}
+    aglFontBlockKey(const alt::string &fnt, int ind){font=fnt;index=ind;}
+
+    bool operator==(const aglFontBlockKey &val) const
+    {
+        return index==val.index && font==val.font;
+    }
 
-    uint32 cacheIndex;
+    alt::string font;
+    int index;
 };
 
+__inline uint32 aHash(const aglFontBlockKey &key)
+{
+    return alt::aHash(key.font)^(uint32(key.index)*0x9e3779b1);
+}
+
 class AGLFont
 {
 public:
@@ -130,13 +147,14 @@ protected:
     alt::colorRGBA curr_color;
     alt::string curr_font;
 
-    //создание и уничтожение блоков
-    void createBlock(int index);
-    void checkBlocksLifeCicle();
+    //создание и уничтожение блоков; указатель на блок действителен до следующего
+    //fetchBlock/createBlock - новый блок может вытеснить прежний из blocks
+    void initBlocks();
+    aglFontBlock* fetchBlock(int index);
+    aglFontBlock* createBlock(int index);
 
-    //формат строки: Type:Size
-    alt::hash<alt::string, alt::hash<int,aglFontBlock> > fonts;
-    alt::cache<alt::pair<alt::string,int> > cache;
+    //формат строки шрифта: Type:Size
+    alt::keyCache<aglFontBlockKey,aglFontBlock> blocks;
     int blocklimit;
 
     #ifndef QT_WIDGETS_LIB
@@ -23,6 +23,10 @@ namespace ui
         AWidgetTextures()
         {
             textures_used_at_draw_maximum = 0;
+            textures.onDrop([](const string&, alt::GLTexture* &tex, cache_type::DropReason)
+            {
+                delete tex;
+            });
         }
         ~AWidgetTextures()
         {
@@ -43,52 +47,43 @@ namespace ui
             if(textures_used_at_draw.size()>textures_used_at_draw_maximum)
                 textures_used_at_draw_maximum=textures_used_at_draw.size();
 
-            if(texcache.Size()>(textures_used_at_draw_maximum<<1))
-            {
-                int torem=texcache.Size()-(textures_used_at_draw_maximum<<1);
-                while(torem--)
-                {
-                    string tex=texcache.ForRemove();
-                    texcache.Delete(texcache.ForRemoveIndex());
-                    delete textures[tex].left();
-                    textures.remove(tex);
-                }
-            }
+            //вытесняем только между кадрами, чтобы не терять текстуры текущего
+            textures.trim(textures_used_at_draw_maximum<<1);
         }
 
         void clear()
         {
-            texcache.Clear();
-            for(int i=0;i<textures.size();i++)
-            {
-                delete textures.value(i).left();
-            }
             textures.clear();
         }
 
         alt::GLTexture* operator()(string id)
         {
             textures_used_at_draw.insert(id);
-            if(!textures.contains(id))
-            {
-                image img=loadImage(id);
-                alt::GLTexture *tmp = new alt::GLTexture(img(),img.width(),img.height(),0x8888);
-                textures.insert(id,pair<alt::GLTexture*,int>(tmp,texcache.Push(id)));
-            }
-            pair<alt::GLTexture*,int> tex=textures[id];
-            texcache.Update(tex.right());
-            return tex.left();
+            alt::GLTexture **tex = textures.find(id);
+            if(tex)
+                return *tex;
+
+            image img=loadImage(id);
+            alt::GLTexture *tmp = new alt::GLTexture(img(),img.width(),img.height(),0x8888);
+            textures.insert(id,tmp);
+            return tmp;
+        }
+
+        const cacheStats& stats() const
+        {
+            return textures.stats();
         }
 
     private:
+        typedef keyCache<string, alt::GLTexture*> cache_type;
+
         //процедура загрузки из ресурсов
         delegate<image,string> loadImage;
 
         //кеширование текстур
         set<string>  textures_used_at_draw;
         int textures_used_at_draw_maximum;
-        cache<string> texcache;
-        hash<string,pair<alt::GLTexture*,int> > textures;
+        cache_type textures;
     };
 
     class widget: public delegateBase